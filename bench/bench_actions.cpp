@@ -0,0 +1,111 @@
+//
+// Copyright (c) 2024, Daily
+//
+
+#include "bench_transport.h"
+
+#include <benchmark/benchmark.h>
+
+#include <functional>
+
+using namespace rtvi;
+
+namespace {
+
+nlohmann::json action_response(const std::string& id) {
+    return nlohmann::json {
+            {"label", "rtvi-ai"},
+            {"type", "action-response"},
+            {"id", id},
+            {"data", {{"result", true}}},
+    };
+}
+
+RTVIClientOptions client_options() {
+    RTVIClientOptions options;
+    options.callbacks = nullptr;
+    options.audio.staging = false;
+    return options;
+}
+
+// Registers an action and completes it with its response.
+void BM_ActionRoundTrip(benchmark::State& state) {
+    BenchTransport* transport;
+    auto client = make_bench_client(client_options(), &transport);
+    auto action = RTVIMessage::action("llm", "run", nlohmann::json::object());
+    uint64_t completed = 0;
+
+    for (auto _: state) {
+        client->send_action(action, [&](const nlohmann::json&) {
+            completed++;
+        });
+        client->on_transport_message(action_response(transport->last_id));
+    }
+    state.counters["completed"] = static_cast<double>(completed);
+}
+BENCHMARK(BM_ActionRoundTrip);
+
+// Same, with an action timeout to schedule and cancel.
+void BM_ActionRoundTripTimeout(benchmark::State& state) {
+    BenchTransport* transport;
+    auto client = make_bench_client(client_options(), &transport);
+    auto action = RTVIMessage::action("llm", "run", nlohmann::json::object());
+    RTVIActionOptions options;
+    options.timeout = std::chrono::seconds(10);
+
+    for (auto _: state) {
+        client->send_action(action, [](const nlohmann::json&) {}, options);
+        client->on_transport_message(action_response(transport->last_id));
+    }
+}
+BENCHMARK(BM_ActionRoundTripTimeout);
+
+// Actions written from a template and responses delivered as frames, with
+// a transport accepting JSON text.
+void BM_ActionTemplateRoundTrip(benchmark::State& state) {
+    BenchTransport* transport;
+    auto client = make_bench_client(client_options(), &transport, true);
+    RTVIActionTemplate action("llm", "run");
+    std::string placeholder(RTVI_ID_LENGTH, '0');
+    std::string response = action_response(placeholder).dump();
+    size_t id_offset = response.find(placeholder);
+    uint64_t completed = 0;
+
+    for (auto _: state) {
+        client->send_action(action, "{}", [&](const nlohmann::json&) {
+            completed++;
+        });
+        std::string frame = response;
+        frame.replace(id_offset, RTVI_ID_LENGTH, transport->last_id);
+        client->on_transport_frame(std::move(frame));
+    }
+    state.counters["completed"] = static_cast<double>(completed);
+}
+BENCHMARK(BM_ActionTemplateRoundTrip);
+
+// Pending action table shared by several threads, each inserting and
+// removing its own IDs.
+void BM_ActionTable(benchmark::State& state) {
+    static RTVIActionTable<std::function<void()>>* table;
+    if (state.thread_index() == 0) {
+        table = new RTVIActionTable<std::function<void()>>(
+                1024, static_cast<size_t>(state.range(0))
+        );
+    }
+
+    char id[RTVI_ID_LENGTH];
+    for (auto _: state) {
+        generate_random_id(id);
+        std::string_view key(id, RTVI_ID_LENGTH);
+        table->insert(key, [] {});
+        benchmark::DoNotOptimize(table->remove(key));
+    }
+
+    if (state.thread_index() == 0) {
+        state.SetItemsProcessed(state.iterations() * state.threads());
+        delete table;
+    }
+}
+BENCHMARK(BM_ActionTable)->Arg(1)->Arg(16)->ThreadRange(1, 16)->UseRealTime();
+
+}  // namespace
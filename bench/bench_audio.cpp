@@ -0,0 +1,171 @@
+//
+// Copyright (c) 2024, Daily
+//
+
+#include "bench_transport.h"
+
+#include <benchmark/benchmark.h>
+
+using namespace rtvi;
+
+namespace {
+
+// 10ms of 16kHz mono audio.
+constexpr size_t CHUNK_FRAMES = 160;
+
+const char* simd_name(RTVISimdLevel level) {
+    switch (level) {
+    case RTVISimdLevel::Scalar:
+        return "scalar";
+    case RTVISimdLevel::SSE2:
+        return "sse2";
+    case RTVISimdLevel::AVX2:
+        return "avx2";
+    case RTVISimdLevel::NEON:
+        return "neon";
+    }
+    return "";
+}
+
+RTVIClientOptions client_options(bool staging) {
+    RTVIClientOptions options;
+    options.callbacks = nullptr;
+    options.audio.staging = staging;
+    options.audio.jitter_buffer = false;
+    return options;
+}
+
+// User audio straight to the transport, or into the staging ring buffer.
+void BM_SendUserAudio(benchmark::State& state) {
+    auto client = make_bench_client(client_options(state.range(0)), nullptr);
+    std::vector<int16_t> chunk(CHUNK_FRAMES);
+
+    for (auto _: state) {
+        benchmark::DoNotOptimize(
+                client->send_user_audio(chunk.data(), chunk.size())
+        );
+    }
+    state.SetBytesProcessed(
+            state.iterations() * CHUNK_FRAMES * sizeof(int16_t)
+    );
+    state.SetLabel(state.range(0) ? "staging" : "pass-through");
+}
+BENCHMARK(BM_SendUserAudio)->Arg(0)->Arg(1);
+
+void BM_ReadBotAudio(benchmark::State& state) {
+    auto client = make_bench_client(client_options(state.range(0)), nullptr);
+    std::vector<int16_t> chunk(CHUNK_FRAMES);
+
+    for (auto _: state) {
+        benchmark::DoNotOptimize(
+                client->read_bot_audio(chunk.data(), chunk.size())
+        );
+    }
+    state.SetBytesProcessed(
+            state.iterations() * CHUNK_FRAMES * sizeof(int16_t)
+    );
+    state.SetLabel(state.range(0) ? "staging" : "pass-through");
+}
+BENCHMARK(BM_ReadBotAudio)->Arg(0)->Arg(1);
+
+void BM_FloatToInt16(benchmark::State& state) {
+    auto level = static_cast<RTVISimdLevel>(state.range(0));
+    if (!simd_supported(level)) {
+        state.SkipWithError("not supported");
+        return;
+    }
+    std::vector<float> in(state.range(1), 0.5f);
+    std::vector<int16_t> out(in.size());
+
+    for (auto _: state) {
+        float_to_int16(in.data(), out.data(), in.size(), level);
+        benchmark::DoNotOptimize(out.data());
+    }
+    state.SetItemsProcessed(state.iterations() * in.size());
+    state.SetLabel(simd_name(level));
+}
+BENCHMARK(BM_FloatToInt16)->ArgsProduct({{0, 1, 2, 3}, {160, 960}});
+
+void BM_Int16ToFloat(benchmark::State& state) {
+    auto level = static_cast<RTVISimdLevel>(state.range(0));
+    if (!simd_supported(level)) {
+        state.SkipWithError("not supported");
+        return;
+    }
+    std::vector<int16_t> in(state.range(1), 1000);
+    std::vector<float> out(in.size());
+
+    for (auto _: state) {
+        int16_to_float(in.data(), out.data(), in.size(), level);
+        benchmark::DoNotOptimize(out.data());
+    }
+    state.SetItemsProcessed(state.iterations() * in.size());
+    state.SetLabel(simd_name(level));
+}
+BENCHMARK(BM_Int16ToFloat)->ArgsProduct({{0, 1, 2, 3}, {160, 960}});
+
+// 10ms blocks between common device and transport rates.
+void BM_Resampler(benchmark::State& state) {
+    auto level = static_cast<RTVISimdLevel>(state.range(0));
+    if (!simd_supported(level)) {
+        state.SkipWithError("not supported");
+        return;
+    }
+    uint32_t in_rate = static_cast<uint32_t>(state.range(1));
+    uint32_t out_rate = static_cast<uint32_t>(state.range(2));
+    size_t in_frames = in_rate / 100;
+    RTVIResampler resampler(in_rate, out_rate, 1, in_frames, level);
+    std::vector<float> in(in_frames, 0.25f);
+    std::vector<float> out(resampler.max_out_frames(in_frames));
+
+    for (auto _: state) {
+        benchmark::DoNotOptimize(
+                resampler.process(in.data(), in.size(), out.data())
+        );
+    }
+    state.SetItemsProcessed(state.iterations() * in_frames);
+    state.SetLabel(simd_name(level));
+}
+BENCHMARK(BM_Resampler)
+        ->ArgsProduct({{0, 1, 2, 3}, {48000}, {16000, 24000}})
+        ->Args({0, 16000, 48000})
+        ->Args({2, 16000, 48000})
+        ->Args({0, 44100, 16000})
+        ->Args({2, 44100, 16000});
+
+// Full conversion from a stereo 48kHz float device to 16kHz mono int16.
+void BM_AudioConverter(benchmark::State& state) {
+    size_t in_frames = 480;
+    RTVIAudioConverter converter(
+            RTVIAudioFormat {48000, 2}, RTVIAudioFormat {16000, 1}, in_frames
+    );
+    std::vector<float> in(in_frames * 2, 0.25f);
+    std::vector<int16_t> out(converter.max_out_frames(in_frames));
+
+    for (auto _: state) {
+        benchmark::DoNotOptimize(
+                converter.convert(in.data(), in_frames, out.data())
+        );
+    }
+    state.SetItemsProcessed(state.iterations() * in_frames);
+}
+BENCHMARK(BM_AudioConverter);
+
+// Cost of latency tracking on every bot audio read, idle and while waiting
+// for the first (here silent) audio of a turn.
+void BM_LatencyBotAudio(benchmark::State& state) {
+    RTVILatencyTracker tracker {RTVILatencyOptions()};
+    if (state.range(0)) {
+        tracker.on_user_stopped_speaking();
+        tracker.mark(RTVILatencyStage::TTSStarted);
+    }
+    std::vector<int16_t> chunk(CHUNK_FRAMES);
+
+    for (auto _: state) {
+        tracker.on_bot_audio(chunk.data(), chunk.size());
+    }
+    state.SetLabel(state.range(0) ? "waiting" : "idle");
+}
+BENCHMARK(BM_LatencyBotAudio)->Arg(0)->Arg(1);
+
+}  // namespace
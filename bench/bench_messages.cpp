@@ -0,0 +1,248 @@
+//
+// Copyright (c) 2024, Daily
+//
+
+#include "bench_transport.h"
+
+#include <benchmark/benchmark.h>
+
+#include <thread>
+
+using namespace rtvi;
+
+namespace {
+
+struct BenchCallbacks : public RTVIEventCallbacks {
+    void on_bot_llm_text(const BotLLMTextData& data) override {
+        benchmark::DoNotOptimize(data.text.data());
+    }
+
+    void on_user_transcript(const UserTranscriptData& data) override {
+        benchmark::DoNotOptimize(data.text.data());
+    }
+
+    void on_generic_message(const nlohmann::json& message) override {
+        benchmark::DoNotOptimize(&message);
+    }
+};
+
+const char* FRAMES[] = {
+        R"({"id":"a1b2c3d4e5","label":"rtvi-ai","type":"bot-llm-text",)"
+        R"("data":{"text":" token"}})",
+        R"({"id":"a1b2c3d4e5","label":"rtvi-ai","type":"user-transcription",)"
+        R"("data":{"text":"Hello there, how are you doing today?",)"
+        R"("final":true,"timestamp":"2024-10-10T10:10:10.000Z",)"
+        R"("user_id":"user-123"}})",
+        R"({"id":"a1b2c3d4e5","label":"rtvi-ai",)"
+        R"("type":"bot-started-speaking"})",
+        R"({"id":"a1b2c3d4e5","label":"rtvi-ai","type":"custom-event",)"
+        R"("data":{"values":[1,2,3],"nested":{"key":"value"}}})",
+};
+
+const char* FRAME_NAMES[] = {
+        "bot-llm-text",
+        "user-transcription",
+        "bot-started-speaking",
+        "generic",
+};
+
+RTVIClientOptions client_options(RTVIEventCallbacks* callbacks) {
+    RTVIClientOptions options;
+    options.callbacks = callbacks;
+    options.audio.staging = false;
+    return options;
+}
+
+// Messages delivered as JSON objects, parsed by the transport.
+void BM_OnTransportMessage(benchmark::State& state) {
+    BenchCallbacks callbacks;
+    auto client = make_bench_client(client_options(&callbacks), nullptr);
+    const char* frame = FRAMES[state.range(0)];
+
+    for (auto _: state) {
+        client->on_transport_message(nlohmann::json::parse(frame));
+    }
+    state.SetLabel(FRAME_NAMES[state.range(0)]);
+}
+BENCHMARK(BM_OnTransportMessage)->DenseRange(0, 3);
+
+// Messages delivered as raw frames, only scanned by the client.
+void BM_OnTransportFrame(benchmark::State& state) {
+    BenchCallbacks callbacks;
+    RTVIClientOptions options = client_options(&callbacks);
+    options.message_arena_block_size = state.range(1) ? 4096 : 0;
+    auto client = make_bench_client(options, nullptr);
+    std::string frame = FRAMES[state.range(0)];
+
+    for (auto _: state) {
+        client->on_transport_frame(frame);
+    }
+    state.SetLabel(
+            std::string(FRAME_NAMES[state.range(0)]) +
+            (state.range(1) ? "/arena" : "")
+    );
+}
+BENCHMARK(BM_OnTransportFrame)->ArgsProduct({{0, 1, 2, 3}, {0, 1}});
+
+// Dispatch through the executor, including the thread hop.
+void BM_OnTransportFrameExecutor(benchmark::State& state) {
+    BenchCallbacks callbacks;
+    RTVIExecutorOptions executor_options;
+    executor_options.max_queue_size = 1 << 20;
+    RTVIExecutor executor(executor_options);
+    RTVIClientOptions options = client_options(&callbacks);
+    options.executor = &executor;
+    auto client = make_bench_client(options, nullptr);
+    std::string frame = FRAMES[0];
+
+    for (auto _: state) {
+        client->on_transport_frame(frame);
+    }
+}
+BENCHMARK(BM_OnTransportFrameExecutor);
+
+void BM_InboundMessageView(benchmark::State& state) {
+    std::string frame = FRAMES[1];
+
+    for (auto _: state) {
+        RTVIInboundMessage message(frame);
+        benchmark::DoNotOptimize(message.type());
+        benchmark::DoNotOptimize(message.data_string("text"));
+        benchmark::DoNotOptimize(message.data_string("user_id"));
+    }
+}
+BENCHMARK(BM_InboundMessageView);
+
+void BM_InboundMessageParse(benchmark::State& state) {
+    std::string frame = FRAMES[1];
+
+    for (auto _: state) {
+        auto message = nlohmann::json::parse(frame);
+        benchmark::DoNotOptimize(message["type"].get<std::string>());
+        benchmark::DoNotOptimize(message["data"]["text"].get<std::string>());
+        benchmark::DoNotOptimize(message["data"]["user_id"].get<std::string>());
+    }
+}
+BENCHMARK(BM_InboundMessageParse);
+
+nlohmann::json action_arguments() {
+    return nlohmann::json {
+            {"messages",
+             {{{"role", "user"}, {"content", "What's the weather like?"}}}},
+            {"run_immediately", true},
+    };
+}
+
+void BM_MessageBuild(benchmark::State& state) {
+    nlohmann::json arguments = action_arguments();
+
+    for (auto _: state) {
+        auto message =
+                RTVIMessage::action("llm", "append_to_messages", arguments);
+        benchmark::DoNotOptimize(message);
+    }
+}
+BENCHMARK(BM_MessageBuild);
+
+void BM_MessageBuildAndDump(benchmark::State& state) {
+    nlohmann::json arguments = action_arguments();
+
+    for (auto _: state) {
+        auto message =
+                RTVIMessage::action("llm", "append_to_messages", arguments);
+        benchmark::DoNotOptimize(message.dump());
+    }
+}
+BENCHMARK(BM_MessageBuildAndDump);
+
+void BM_MessageEncode(benchmark::State& state) {
+    auto format = static_cast<RTVIWireFormat>(state.range(0));
+    auto message = RTVIMessage::action(
+            "llm", "append_to_messages", action_arguments()
+    );
+    std::vector<uint8_t> buffer;
+
+    for (auto _: state) {
+        buffer.clear();
+        encode_message(message, format, buffer);
+        benchmark::DoNotOptimize(buffer.data());
+    }
+    state.counters["bytes"] = static_cast<double>(buffer.size());
+}
+BENCHMARK(BM_MessageEncode)
+        ->Arg(static_cast<int>(RTVIWireFormat::Json))
+        ->Arg(static_cast<int>(RTVIWireFormat::MessagePack))
+        ->Arg(static_cast<int>(RTVIWireFormat::Cbor));
+
+void BM_MessageDecode(benchmark::State& state) {
+    auto format = static_cast<RTVIWireFormat>(state.range(0));
+    auto message = RTVIMessage::action(
+            "llm", "append_to_messages", action_arguments()
+    );
+    std::vector<uint8_t> buffer;
+    encode_message(message, format, buffer);
+
+    for (auto _: state) {
+        benchmark::DoNotOptimize(
+                decode_message(format, buffer.data(), buffer.size())
+        );
+    }
+}
+BENCHMARK(BM_MessageDecode)
+        ->Arg(static_cast<int>(RTVIWireFormat::Json))
+        ->Arg(static_cast<int>(RTVIWireFormat::MessagePack))
+        ->Arg(static_cast<int>(RTVIWireFormat::Cbor));
+
+void BM_ActionTemplate(benchmark::State& state) {
+    RTVIActionTemplate action("llm", "append_to_messages");
+    std::string arguments = action_arguments().dump();
+    std::vector<uint8_t> buffer;
+    char id[RTVI_ID_LENGTH];
+
+    for (auto _: state) {
+        buffer.clear();
+        generate_random_id(id);
+        action.write_raw(
+                std::string_view(id, RTVI_ID_LENGTH), arguments, buffer
+        );
+        benchmark::DoNotOptimize(buffer.data());
+    }
+}
+BENCHMARK(BM_ActionTemplate);
+
+// Whole conversation turns played by a loopback bot as fast as possible, in
+// process or through a socket.
+void BM_LoopbackTurn(benchmark::State& state) {
+    BenchCallbacks callbacks;
+    RTVILoopbackTransportOptions transport_options;
+    transport_options.mode = static_cast<RTVILoopbackMode>(state.range(0));
+    transport_options.bot.time_scale = 0;
+    transport_options.bot.function_call_interval = 4;
+    auto transport =
+            std::make_unique<RTVILoopbackTransport>(transport_options);
+    RTVILoopbackTransport* loopback = transport.get();
+
+    RTVIClient client(client_options(&callbacks), std::move(transport));
+    loopback->set_observer(&client);
+    client.initialize();
+    client.connect();
+
+    uint64_t turns = 0;
+    for (auto _: state) {
+        turns++;
+        while (loopback->stats().turns < turns) {
+            std::this_thread::yield();
+        }
+    }
+    client.disconnect();
+
+    RTVILoopbackStats stats = loopback->stats();
+    state.counters["frames"] = benchmark::Counter(
+            static_cast<double>(stats.frames_sent),
+            benchmark::Counter::kIsRate
+    );
+    state.SetLabel(state.range(0) ? "socket" : "in-process");
+}
+BENCHMARK(BM_LoopbackTurn)->Arg(0)->Arg(1)->UseRealTime();
+
+}  // namespace
@@ -0,0 +1,125 @@
+//
+// Copyright (c) 2024, Daily
+//
+
+#include "rtvi.h"
+
+#include <benchmark/benchmark.h>
+
+#include <thread>
+
+using namespace rtvi;
+
+namespace {
+
+// Multi-threaded benchmarks run with an even number of threads: even threads
+// push and odd threads pop, the same number of items each, so consumers never
+// wait forever.
+
+void BM_RTVIQueue(benchmark::State& state) {
+    static RTVIQueue<uint64_t>* queue;
+    if (state.thread_index() == 0) {
+        queue = new RTVIQueue<uint64_t>();
+    }
+
+    bool producer = state.thread_index() % 2 == 0;
+    uint64_t value = 0;
+    for (auto _: state) {
+        if (producer) {
+            queue->push(value++);
+        } else {
+            benchmark::DoNotOptimize(queue->blocking_pop());
+        }
+    }
+
+    if (state.thread_index() == 0) {
+        state.SetItemsProcessed(state.iterations() * state.threads() / 2);
+        delete queue;
+    }
+}
+BENCHMARK(BM_RTVIQueue)->ThreadRange(2, 16)->UseRealTime();
+
+void BM_MpmcQueue(benchmark::State& state) {
+    static RTVIMpmcQueue<uint64_t>* queue;
+    if (state.thread_index() == 0) {
+        queue = new RTVIMpmcQueue<uint64_t>(1024);
+    }
+
+    bool producer = state.thread_index() % 2 == 0;
+    uint64_t value = 0;
+    for (auto _: state) {
+        if (producer) {
+            while (!queue->try_push(value)) {
+                std::this_thread::yield();
+            }
+            value++;
+        } else {
+            benchmark::DoNotOptimize(queue->pop());
+        }
+    }
+
+    if (state.thread_index() == 0) {
+        state.SetItemsProcessed(state.iterations() * state.threads() / 2);
+        delete queue;
+    }
+}
+BENCHMARK(BM_MpmcQueue)->ThreadRange(2, 16)->UseRealTime();
+
+// Uncontended push and pop from the same thread.
+void BM_RTVIQueueSingleThread(benchmark::State& state) {
+    RTVIQueue<uint64_t> queue;
+    uint64_t value = 0;
+
+    for (auto _: state) {
+        queue.push(value++);
+        benchmark::DoNotOptimize(queue.blocking_pop());
+    }
+}
+BENCHMARK(BM_RTVIQueueSingleThread);
+
+void BM_MpmcQueueSingleThread(benchmark::State& state) {
+    RTVIMpmcQueue<uint64_t> queue(1024);
+    uint64_t value = 0;
+
+    for (auto _: state) {
+        queue.try_push(value++);
+        benchmark::DoNotOptimize(queue.try_pop());
+    }
+}
+BENCHMARK(BM_MpmcQueueSingleThread);
+
+// Overflow handling of a bounded queue that is always full.
+void BM_RTVIQueueOverflow(benchmark::State& state) {
+    RTVIQueueOptions<uint64_t> options;
+    options.max_capacity = 64;
+    options.overflow_policy =
+            static_cast<RTVIQueueOverflowPolicy>(state.range(0));
+    options.coalesce_key = [](const uint64_t& value) { return value % 8; };
+    RTVIQueue<uint64_t> queue(options);
+    uint64_t value = 0;
+
+    for (auto _: state) {
+        queue.push(value++);
+    }
+}
+BENCHMARK(BM_RTVIQueueOverflow)
+        ->Arg(static_cast<int>(RTVIQueueOverflowPolicy::DropOldest))
+        ->Arg(static_cast<int>(RTVIQueueOverflowPolicy::DropNewest))
+        ->Arg(static_cast<int>(RTVIQueueOverflowPolicy::Coalesce));
+
+// 10ms chunks of 16kHz audio through the audio ring buffer.
+void BM_RingBuffer(benchmark::State& state) {
+    RTVIRingBuffer<int16_t> buffer(16000);
+    std::vector<int16_t> chunk(160);
+
+    for (auto _: state) {
+        buffer.write(chunk.data(), chunk.size());
+        benchmark::DoNotOptimize(buffer.read(chunk.data(), chunk.size()));
+    }
+    state.SetBytesProcessed(
+            state.iterations() * chunk.size() * sizeof(int16_t)
+    );
+}
+BENCHMARK(BM_RingBuffer);
+
+}  // namespace
@@ -0,0 +1,91 @@
+//
+// Copyright (c) 2024, Daily
+//
+
+#ifndef PIPECAT_BENCH_TRANSPORT_H
+#define PIPECAT_BENCH_TRANSPORT_H
+
+#include "rtvi.h"
+
+#include <atomic>
+#include <memory>
+#include <string>
+#include <string_view>
+
+// Transport that drops whatever it's sent and returns silence, so benchmarks
+// only measure the client.
+class BenchTransport : public rtvi::RTVITransport {
+   public:
+    explicit BenchTransport(bool json_text = false) : _json_text(json_text) {}
+
+    void initialize() override {}
+
+    void connect(const nlohmann::json&) override {}
+
+    void disconnect() override {}
+
+    void send_message(const nlohmann::json& message) override {
+        last_id = message["id"].get<std::string>();
+        messages++;
+    }
+
+    bool supports_wire_format(rtvi::RTVIWireFormat format) const override {
+        return _json_text && format == rtvi::RTVIWireFormat::Json;
+    }
+
+    void send_encoded_message(
+            rtvi::RTVIWireFormat,
+            const uint8_t* data,
+            size_t size
+    ) override {
+        // Messages are only encoded as JSON text here, and always start with
+        // the label, type and id.
+        std::string_view text(reinterpret_cast<const char*>(data), size);
+        size_t id = text.find("\"id\":\"");
+        if (id != std::string_view::npos) {
+            id += 6;
+            last_id.assign(text.substr(id, text.find('"', id) - id));
+        }
+        bytes += size;
+        messages++;
+    }
+
+    int32_t send_user_audio(const int16_t*, size_t num_frames) override {
+        return static_cast<int32_t>(num_frames);
+    }
+
+    int32_t read_bot_audio(int16_t* data, size_t num_frames) override {
+        std::fill(data, data + num_frames, 0);
+        return static_cast<int32_t>(num_frames);
+    }
+
+    bool nonblocking_audio() const override { return true; }
+
+    std::string last_id;
+    std::atomic<uint64_t> messages {0};
+    std::atomic<uint64_t> bytes {0};
+
+   private:
+    bool _json_text;
+};
+
+// Connected client using a BenchTransport (there's no connect endpoint, so
+// nothing goes to the network).
+inline std::unique_ptr<rtvi::RTVIClient> make_bench_client(
+        rtvi::RTVIClientOptions options,
+        BenchTransport** transport,
+        bool json_text = false
+) {
+    auto bench_transport = std::make_unique<BenchTransport>(json_text);
+    if (transport) {
+        *transport = bench_transport.get();
+    }
+    auto client = std::make_unique<rtvi::RTVIClient>(
+            options, std::move(bench_transport)
+    );
+    client->initialize();
+    client->connect();
+    return client;
+}
+
+#endif
@@ -0,0 +1,85 @@
+//
+// Copyright (c) 2024, Daily
+//
+
+#include "rtvi.h"
+
+#include <benchmark/benchmark.h>
+
+#include <random>
+
+using namespace rtvi;
+
+namespace {
+
+// The original generator, seeding a new engine from `std::random_device`
+// for every ID.
+std::string legacy_random_id() {
+    const std::string characters =
+            "0123456789ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz";
+    std::random_device rd;
+    std::mt19937 generator(rd());
+    std::uniform_int_distribution<size_t> distribution(
+            0, characters.size() - 1
+    );
+    std::string id;
+    for (size_t i = 0; i < RTVI_ID_LENGTH; ++i) {
+        id += characters[distribution(generator)];
+    }
+    return id;
+}
+
+void BM_LegacyRandomId(benchmark::State& state) {
+    for (auto _: state) {
+        benchmark::DoNotOptimize(legacy_random_id());
+    }
+}
+BENCHMARK(BM_LegacyRandomId)->ThreadRange(1, 8)->UseRealTime();
+
+void BM_RandomId(benchmark::State& state) {
+    for (auto _: state) {
+        benchmark::DoNotOptimize(generate_random_id());
+    }
+}
+BENCHMARK(BM_RandomId)->ThreadRange(1, 8)->UseRealTime();
+
+void BM_RandomIdBuffer(benchmark::State& state) {
+    char id[RTVI_ID_LENGTH];
+    for (auto _: state) {
+        generate_random_id(id);
+        benchmark::DoNotOptimize(id);
+    }
+}
+BENCHMARK(BM_RandomIdBuffer)->ThreadRange(1, 8)->UseRealTime();
+
+// The argument enables metrics at runtime. Without PIPECAT_METRICS these
+// measure an empty loop.
+void BM_MetricAdd(benchmark::State& state) {
+    RTVIMetrics::set_enabled(state.range(0));
+    for (auto _: state) {
+        RTVI_METRIC_ADD(MessagesSent, 1);
+    }
+    RTVIMetrics::set_enabled(false);
+}
+BENCHMARK(BM_MetricAdd)->Arg(0)->Arg(1)->ThreadRange(1, 8)->UseRealTime();
+
+void BM_MetricMessage(benchmark::State& state) {
+    RTVIMetrics::set_enabled(state.range(0));
+    for (auto _: state) {
+        RTVI_METRIC_MESSAGE("bot-tts-text");
+    }
+    RTVIMetrics::set_enabled(false);
+}
+BENCHMARK(BM_MetricMessage)->Arg(0)->Arg(1);
+
+void BM_MetricRecordSince(benchmark::State& state) {
+    RTVIMetrics::set_enabled(state.range(0));
+    for (auto _: state) {
+        auto start = RTVI_METRIC_NOW();
+        RTVI_METRIC_RECORD_SINCE(MessageCallback, start);
+    }
+    RTVIMetrics::set_enabled(false);
+}
+BENCHMARK(BM_MetricRecordSince)->Arg(0)->Arg(1);
+
+}  // namespace
@@ -5,13 +5,36 @@
 #ifndef RTVI_H
 #define RTVI_H
 
+#include "rtvi_action_table.h"
+#include "rtvi_arena.h"
+#include "rtvi_audio_format.h"
+#include "rtvi_audio_frame.h"
 #include "rtvi_callbacks.h"
 #include "rtvi_client.h"
+#include "rtvi_coroutine.h"
 #include "rtvi_exceptions.h"
+#include "rtvi_executor.h"
 #include "rtvi_helper.h"
+#include "rtvi_histogram.h"
+#include "rtvi_http_client.h"
+#include "rtvi_inbound_message.h"
+#include "rtvi_jitter_buffer.h"
+#include "rtvi_latency.h"
 #include "rtvi_llm_helper.h"
+#include "rtvi_loopback_transport.h"
+#include "rtvi_message_template.h"
 #include "rtvi_messages.h"
+#include "rtvi_metrics.h"
+#include "rtvi_mpmc_queue.h"
+#include "rtvi_reactor.h"
+#include "rtvi_replay_transport.h"
+#include "rtvi_ring_buffer.h"
+#include "rtvi_session_manager.h"
+#include "rtvi_session_recorder.h"
+#include "rtvi_text_aggregator.h"
+#include "rtvi_timer.h"
 #include "rtvi_transport.h"
 #include "rtvi_utils.h"
+#include "rtvi_wire_format.h"
 
 #endif
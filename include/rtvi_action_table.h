@@ -0,0 +1,248 @@
+//
+// Copyright (c) 2024, Daily
+//
+
+#ifndef RTVI_ACTION_TABLE_H
+#define RTVI_ACTION_TABLE_H
+
+#include "rtvi_utils.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string_view>
+#include <vector>
+
+namespace rtvi {
+
+// Longest action ID that an RTVIActionTable stores inline. Longer IDs (e.g.
+// UUIDs) are also supported, but they are copied to the heap.
+constexpr size_t RTVI_ACTION_ID_INLINE_LENGTH = 31;
+
+// Fixed-capacity hash table of pending actions keyed by action ID. Short IDs
+// are stored inline and all the slots are allocated upfront, so inserting and
+// removing never allocate (besides what `T` itself allocates). The table is
+// split in shards, each one with its own lock and open-addressing (linear
+// probing) slots, so threads sending actions and the thread receiving the
+// responses rarely contend.
+template<typename T>
+class RTVIActionTable {
+   public:
+    // Each shard can hold twice its share of `capacity`, so an uneven
+    // distribution of IDs doesn't fill a shard before the table is full.
+    // Shards have twice as many slots as entries to keep probing short.
+    RTVIActionTable(size_t capacity, size_t num_shards)
+        : _capacity(std::max<size_t>(capacity, 1)),
+          _num_shards(std::max<size_t>(num_shards, 1)),
+          _shard_capacity((_capacity + _num_shards - 1) / _num_shards * 2),
+          _shard_mask(next_power_of_two(_shard_capacity * 2) - 1),
+          _shards(new Shard[_num_shards]),
+          _size(0) {
+        for (size_t i = 0; i < _num_shards; ++i) {
+            _shards[i].slots.resize(_shard_mask + 1);
+        }
+    }
+
+    // Returns false if the ID is already present or the table is full.
+    bool insert(std::string_view id, T value) {
+        if (_size.fetch_add(1, std::memory_order_relaxed) >= _capacity) {
+            _size.fetch_sub(1, std::memory_order_relaxed);
+            return false;
+        }
+
+        uint64_t hash = hash_id(id);
+        Shard& shard = shard_for(hash);
+
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        size_t index;
+        if (shard.size >= _shard_capacity || find(shard, hash, id, index)) {
+            _size.fetch_sub(1, std::memory_order_relaxed);
+            return false;
+        }
+
+        // `find()` stops at the first free slot of the probe sequence.
+        Slot& slot = shard.slots[index];
+        slot.used = true;
+        slot.hash = hash;
+        slot.set_id(id);
+        slot.value = std::move(value);
+        shard.size++;
+        return true;
+    }
+
+    // Calls `f` with the value of the given ID while holding the shard lock.
+    // Returns false if the ID is not present.
+    template<typename F>
+    bool update(std::string_view id, F f) {
+        uint64_t hash = hash_id(id);
+        Shard& shard = shard_for(hash);
+
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        size_t index;
+        if (!find(shard, hash, id, index)) {
+            return false;
+        }
+        f(shard.slots[index].value);
+        return true;
+    }
+
+    std::optional<T> remove(std::string_view id) {
+        uint64_t hash = hash_id(id);
+        Shard& shard = shard_for(hash);
+
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        size_t index;
+        if (!find(shard, hash, id, index)) {
+            return std::nullopt;
+        }
+        std::optional<T> value(std::move(shard.slots[index].value));
+        erase(shard, index);
+        return value;
+    }
+
+    // Moves all the values out of the table.
+    void remove_all(std::vector<T>& values) {
+        for (size_t i = 0; i < _num_shards; ++i) {
+            Shard& shard = _shards[i];
+            std::lock_guard<std::mutex> lock(shard.mutex);
+            for (Slot& slot: shard.slots) {
+                if (slot.used) {
+                    values.push_back(std::move(slot.value));
+                    slot.clear();
+                }
+            }
+            _size.fetch_sub(shard.size, std::memory_order_relaxed);
+            shard.size = 0;
+        }
+    }
+
+    size_t size() const { return _size.load(std::memory_order_relaxed); }
+
+    size_t capacity() const { return _capacity; }
+
+   private:
+    struct Slot {
+        bool used = false;
+        uint8_t length = 0;
+        char id[RTVI_ACTION_ID_INLINE_LENGTH];
+        // Only used for IDs that don't fit inline, which are kept out of the
+        // slot so they don't make every slot bigger.
+        uint32_t long_length = 0;
+        uint64_t hash = 0;
+        std::unique_ptr<char[]> long_id;
+        T value;
+
+        std::string_view get_id() const {
+            if (length > RTVI_ACTION_ID_INLINE_LENGTH) {
+                return std::string_view(long_id.get(), long_length);
+            }
+            return std::string_view(id, length);
+        }
+
+        void set_id(std::string_view value) {
+            if (value.size() > RTVI_ACTION_ID_INLINE_LENGTH) {
+                length = RTVI_ACTION_ID_INLINE_LENGTH + 1;
+                long_length = static_cast<uint32_t>(value.size());
+                long_id.reset(new char[value.size()]);
+                std::memcpy(long_id.get(), value.data(), value.size());
+            } else {
+                length = static_cast<uint8_t>(value.size());
+                std::memcpy(id, value.data(), value.size());
+            }
+        }
+
+        void clear() {
+            used = false;
+            length = 0;
+            long_length = 0;
+            long_id.reset();
+            value = T();
+        }
+    };
+
+    struct alignas(RTVI_CACHE_LINE_SIZE) Shard {
+        std::mutex mutex;
+        std::vector<Slot> slots;
+        size_t size = 0;
+    };
+
+    static size_t next_power_of_two(size_t value) {
+        size_t result = 1;
+        while (result < value) {
+            result <<= 1;
+        }
+        return result;
+    }
+
+    static uint64_t hash_id(std::string_view id) {
+        // 64-bit FNV-1a. The low bits select the slot and the high bits the
+        // shard.
+        uint64_t result = 14695981039346656037ull;
+        for (char c: id) {
+            result ^= static_cast<uint8_t>(c);
+            result *= 1099511628211ull;
+        }
+        return result;
+    }
+
+    static bool matches(const Slot& slot, uint64_t hash, std::string_view id) {
+        return slot.hash == hash && slot.get_id() == id;
+    }
+
+    Shard& shard_for(uint64_t hash) {
+        return _shards[(hash >> 32) % _num_shards];
+    }
+
+    // Returns true and the index of the ID if found, otherwise false and the
+    // index of the first free slot.
+    bool find(
+            const Shard& shard,
+            uint64_t hash,
+            std::string_view id,
+            size_t& index
+    ) const {
+        index = hash & _shard_mask;
+        while (shard.slots[index].used) {
+            if (matches(shard.slots[index], hash, id)) {
+                return true;
+            }
+            index = (index + 1) & _shard_mask;
+        }
+        return false;
+    }
+
+    // Backward-shift deletion, so lookups never need tombstones.
+    void erase(Shard& shard, size_t index) {
+        size_t next = (index + 1) & _shard_mask;
+        while (shard.slots[next].used) {
+            // Move the entry back unless its home slot is between the hole and
+            // its current position.
+            size_t home = shard.slots[next].hash & _shard_mask;
+            size_t distance = (next - home) & _shard_mask;
+            if (distance >= ((next - index) & _shard_mask)) {
+                shard.slots[index] = std::move(shard.slots[next]);
+                index = next;
+            }
+            next = (next + 1) & _shard_mask;
+        }
+        shard.slots[index].clear();
+        shard.size--;
+        _size.fetch_sub(1, std::memory_order_relaxed);
+    }
+
+   private:
+    size_t _capacity;
+    size_t _num_shards;
+    size_t _shard_capacity;
+    size_t _shard_mask;
+    std::unique_ptr<Shard[]> _shards;
+    std::atomic<size_t> _size;
+};
+
+}  // namespace rtvi
+
+#endif
@@ -0,0 +1,124 @@
+//
+// Copyright (c) 2024, Daily
+//
+
+#ifndef RTVI_ARENA_H
+#define RTVI_ARENA_H
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace rtvi {
+
+struct RTVIArenaStats {
+    // Allocations served by the arena.
+    uint64_t allocations;
+    uint64_t allocated_bytes;
+    // Blocks requested from the heap. Flat once the arena is warmed up.
+    uint64_t heap_allocations;
+    // Bytes currently in use and owned by the arena.
+    size_t used_bytes;
+    size_t capacity_bytes;
+};
+
+// Monotonic (bump pointer) allocator. Memory is never freed individually;
+// instead the arena is rewound to a previous mark, or reset, and the blocks
+// are kept for reuse, so a warmed up arena doesn't touch the heap.
+//
+// Not thread-safe.
+class RTVIArena {
+   public:
+    struct Mark {
+        size_t block;
+        size_t offset;
+    };
+
+    explicit RTVIArena(size_t block_size = 4096);
+
+    RTVIArena(const RTVIArena&) = delete;
+    RTVIArena& operator=(const RTVIArena&) = delete;
+
+    void* allocate(size_t size, size_t alignment = alignof(std::max_align_t));
+
+    Mark mark() const { return Mark {_block, _offset}; }
+
+    // Releases everything allocated after `mark`.
+    void rewind(Mark mark);
+
+    void reset() { rewind(Mark {0, 0}); }
+
+    RTVIArenaStats stats() const;
+
+   private:
+    struct Block {
+        std::unique_ptr<char[]> data;
+        size_t size;
+    };
+
+   private:
+    size_t _block_size;
+    std::vector<Block> _blocks;
+    // Current block and offset into it.
+    size_t _block;
+    size_t _offset;
+
+    uint64_t _allocations;
+    uint64_t _allocated_bytes;
+    uint64_t _heap_allocations;
+};
+
+// Rewinds the arena when the scope ends. Scopes can be nested.
+class RTVIArenaScope {
+   public:
+    explicit RTVIArenaScope(RTVIArena& arena)
+        : _arena(arena), _mark(arena.mark()) {}
+
+    ~RTVIArenaScope() { _arena.rewind(_mark); }
+
+    RTVIArenaScope(const RTVIArenaScope&) = delete;
+    RTVIArenaScope& operator=(const RTVIArenaScope&) = delete;
+
+   private:
+    RTVIArena& _arena;
+    RTVIArena::Mark _mark;
+};
+
+// Standard allocator adapter, so containers can allocate from an arena.
+template<typename T>
+class RTVIArenaAllocator {
+   public:
+    typedef T value_type;
+
+    explicit RTVIArenaAllocator(RTVIArena& arena) : _arena(&arena) {}
+
+    template<typename U>
+    RTVIArenaAllocator(const RTVIArenaAllocator<U>& other)
+        : _arena(other.arena()) {}
+
+    T* allocate(size_t n) {
+        return static_cast<T*>(_arena->allocate(n * sizeof(T), alignof(T)));
+    }
+
+    void deallocate(T*, size_t) {}
+
+    RTVIArena* arena() const { return _arena; }
+
+    template<typename U>
+    bool operator==(const RTVIArenaAllocator<U>& other) const {
+        return _arena == other.arena();
+    }
+
+    template<typename U>
+    bool operator!=(const RTVIArenaAllocator<U>& other) const {
+        return _arena != other.arena();
+    }
+
+   private:
+    RTVIArena* _arena;
+};
+
+}  // namespace rtvi
+
+#endif
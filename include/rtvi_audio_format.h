@@ -0,0 +1,150 @@
+//
+// Copyright (c) 2024, Daily
+//
+
+#ifndef RTVI_AUDIO_FORMAT_H
+#define RTVI_AUDIO_FORMAT_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace rtvi {
+
+struct RTVIAudioFormat {
+    uint32_t sample_rate = 16000;
+    uint32_t num_channels = 1;
+
+    bool operator==(const RTVIAudioFormat& other) const {
+        return sample_rate == other.sample_rate &&
+               num_channels == other.num_channels;
+    }
+
+    bool operator!=(const RTVIAudioFormat& other) const {
+        return !(*this == other);
+    }
+};
+
+enum class RTVISimdLevel {
+    Scalar,
+    SSE2,
+    AVX2,
+    NEON,
+};
+
+// Best instruction set available in the running CPU.
+RTVISimdLevel simd_level();
+
+bool simd_supported(RTVISimdLevel level);
+
+// Sample format conversion. Float samples are in the [-1.0, 1.0] range and are
+// clamped when converted. The versions without a level use `simd_level()`.
+void float_to_int16(const float* in, int16_t* out, size_t num_samples);
+void float_to_int16(
+        const float* in,
+        int16_t* out,
+        size_t num_samples,
+        RTVISimdLevel level
+);
+
+void int16_to_float(const int16_t* in, float* out, size_t num_samples);
+void int16_to_float(
+        const int16_t* in,
+        float* out,
+        size_t num_samples,
+        RTVISimdLevel level
+);
+
+// Channel up/down-mix of interleaved samples. Downmixing to mono averages all
+// channels, upmixing repeats the input channels, and other downmixes keep the
+// first channels.
+void mix_channels(
+        const float* in,
+        uint32_t in_channels,
+        float* out,
+        uint32_t out_channels,
+        size_t num_frames
+);
+
+// Streaming polyphase resampler for interleaved float audio, using a windowed
+// sinc filter bank for the rational ratio between both sample rates.
+class RTVIResampler {
+   public:
+    RTVIResampler(
+            uint32_t in_rate,
+            uint32_t out_rate,
+            uint32_t num_channels,
+            size_t max_in_frames,
+            RTVISimdLevel level = simd_level()
+    );
+
+    // Upper bound of frames returned by `process()` for the given input.
+    size_t max_out_frames(size_t in_frames) const;
+
+    // `in_frames` must be at most `max_in_frames` and `out` must have room for
+    // `max_out_frames(in_frames)` frames. Returns the number of output frames.
+    size_t process(const float* in, size_t in_frames, float* out);
+
+    void reset();
+
+   private:
+    uint32_t _up;
+    uint32_t _down;
+    uint32_t _num_channels;
+    size_t _num_taps;
+    RTVISimdLevel _level;
+
+    // Per-phase filter taps, in input order so each output is a contiguous
+    // dot product.
+    std::vector<float> _taps;
+    // Planar input for each channel, prefixed with the filter history.
+    std::vector<std::vector<float>> _input;
+    // Position of the next output in upsampled units, relative to the start of
+    // the next input block.
+    size_t _time;
+};
+
+// Converts interleaved audio between two formats: sample format conversion,
+// channel mixing and resampling. All the memory is allocated upfront for
+// blocks of up to `max_in_frames`.
+class RTVIAudioConverter {
+   public:
+    RTVIAudioConverter(
+            const RTVIAudioFormat& in_format,
+            const RTVIAudioFormat& out_format,
+            size_t max_in_frames
+    );
+
+    const RTVIAudioFormat& in_format() const { return _in_format; }
+    const RTVIAudioFormat& out_format() const { return _out_format; }
+    size_t max_in_frames() const { return _max_in_frames; }
+
+    size_t max_out_frames(size_t in_frames) const;
+
+    // `in_frames` must be at most `max_in_frames()` and `out` must have room
+    // for `max_out_frames(in_frames)` frames. Returns the number of output
+    // frames.
+    size_t convert(const int16_t* in, size_t in_frames, int16_t* out);
+    size_t convert(const float* in, size_t in_frames, int16_t* out);
+    size_t convert(const int16_t* in, size_t in_frames, float* out);
+    size_t convert(const float* in, size_t in_frames, float* out);
+
+    void reset();
+
+   private:
+    const float* process(const float* in, size_t in_frames, size_t& out_frames);
+
+   private:
+    RTVIAudioFormat _in_format;
+    RTVIAudioFormat _out_format;
+    size_t _max_in_frames;
+    RTVIResampler _resampler;
+    bool _resample;
+    std::vector<float> _input;
+    std::vector<float> _mixed;
+    std::vector<float> _output;
+};
+
+}  // namespace rtvi
+
+#endif
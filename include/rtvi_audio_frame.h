@@ -0,0 +1,157 @@
+//
+// Copyright (c) 2024, Daily
+//
+
+#ifndef RTVI_AUDIO_FRAME_H
+#define RTVI_AUDIO_FRAME_H
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <utility>
+
+namespace rtvi {
+
+class RTVIAudioFramePool;
+
+// Audio buffer owned by a RTVIAudioFramePool. It holds up to `capacity()`
+// interleaved frames of `num_channels()` samples each, of which `num_frames()`
+// are valid.
+class RTVIAudioFrame {
+   public:
+    RTVIAudioFrame(const RTVIAudioFrame&) = delete;
+    RTVIAudioFrame& operator=(const RTVIAudioFrame&) = delete;
+
+    int16_t* data() { return _data; }
+    const int16_t* data() const { return _data; }
+
+    size_t capacity() const { return _capacity; }
+
+    size_t num_frames() const { return _num_frames; }
+    void set_num_frames(size_t num_frames) { _num_frames = num_frames; }
+
+    uint32_t num_channels() const { return _num_channels; }
+
+   private:
+    friend class RTVIAudioFramePool;
+    friend class RTVIAudioFrameRef;
+
+    RTVIAudioFrame() = default;
+
+    RTVIAudioFramePool* _pool = nullptr;
+    int16_t* _data = nullptr;
+    size_t _capacity = 0;
+    size_t _num_frames = 0;
+    uint32_t _num_channels = 0;
+    uint32_t _index = 0;
+    std::atomic<uint32_t> _refs {0};
+};
+
+// Reference-counted handle to a pooled frame. Copies share the frame, which
+// goes back to its pool (without any deallocation) when the last reference is
+// released.
+class RTVIAudioFrameRef {
+   public:
+    RTVIAudioFrameRef() = default;
+
+    RTVIAudioFrameRef(const RTVIAudioFrameRef& other) : _frame(other._frame) {
+        if (_frame) {
+            _frame->_refs.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+
+    RTVIAudioFrameRef(RTVIAudioFrameRef&& other) noexcept
+        : _frame(other._frame) {
+        other._frame = nullptr;
+    }
+
+    RTVIAudioFrameRef& operator=(RTVIAudioFrameRef other) noexcept {
+        std::swap(_frame, other._frame);
+        return *this;
+    }
+
+    ~RTVIAudioFrameRef() { reset(); }
+
+    void reset();
+
+    // Gives up ownership of the reference without releasing it. The frame
+    // must later be adopted back with `adopt()`.
+    RTVIAudioFrame* detach() {
+        RTVIAudioFrame* frame = _frame;
+        _frame = nullptr;
+        return frame;
+    }
+
+    static RTVIAudioFrameRef adopt(RTVIAudioFrame* frame) {
+        return RTVIAudioFrameRef(frame);
+    }
+
+    RTVIAudioFrame* get() const { return _frame; }
+    RTVIAudioFrame* operator->() const { return _frame; }
+    RTVIAudioFrame& operator*() const { return *_frame; }
+
+    explicit operator bool() const { return _frame != nullptr; }
+
+   private:
+    explicit RTVIAudioFrameRef(RTVIAudioFrame* frame) : _frame(frame) {}
+
+    RTVIAudioFrame* _frame = nullptr;
+};
+
+// Fixed set of preallocated audio frames. Acquiring and releasing frames is
+// lock-free and never allocates, so it can be done from real-time audio
+// callbacks. The pool must outlive all the references it hands out.
+class RTVIAudioFramePool {
+   public:
+    RTVIAudioFramePool(
+            size_t pool_size,
+            size_t frame_capacity,
+            uint32_t num_channels
+    );
+
+    RTVIAudioFramePool(const RTVIAudioFramePool&) = delete;
+    RTVIAudioFramePool& operator=(const RTVIAudioFramePool&) = delete;
+
+    // Returns an empty reference if all frames are in use.
+    RTVIAudioFrameRef acquire();
+
+    size_t available() const {
+        return _available.load(std::memory_order_relaxed);
+    }
+
+    size_t size() const { return _pool_size; }
+
+    size_t frame_capacity() const { return _frame_capacity; }
+
+    uint32_t num_channels() const { return _num_channels; }
+
+   private:
+    friend class RTVIAudioFrameRef;
+
+    void release(RTVIAudioFrame* frame);
+
+   private:
+    size_t _pool_size;
+    size_t _frame_capacity;
+    uint32_t _num_channels;
+
+    std::unique_ptr<int16_t[]> _samples;
+    std::unique_ptr<RTVIAudioFrame[]> _frames;
+
+    // Free list as a Treiber stack of frame indices. The head packs an ABA
+    // tag in the upper 32 bits and the top index in the lower 32 bits.
+    std::unique_ptr<std::atomic<uint32_t>[]> _next;
+    std::atomic<uint64_t> _head;
+    std::atomic<size_t> _available;
+};
+
+inline void RTVIAudioFrameRef::reset() {
+    if (_frame && _frame->_refs.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+        _frame->_pool->release(_frame);
+    }
+    _frame = nullptr;
+}
+
+}  // namespace rtvi
+
+#endif
@@ -5,16 +5,25 @@
 #ifndef RTVI_CALLBACKS_H
 #define RTVI_CALLBACKS_H
 
+#include "rtvi_exceptions.h"
+#include "rtvi_latency.h"
 #include "rtvi_messages.h"
 
 #include "json.hpp"
 
+#include <exception>
 #include <functional>
 
 namespace rtvi {
 
 typedef std::function<void(const nlohmann::json&)> RTVIActionCallback;
 
+typedef std::function<void(const RTVIActionException&)>
+        RTVIActionErrorCallback;
+
+// `error` is set if the client couldn't connect.
+typedef std::function<void(std::exception_ptr error)> RTVIConnectCallback;
+
 class RTVIEventCallbacks {
    public:
     virtual ~RTVIEventCallbacks() {}
@@ -37,12 +46,20 @@ class RTVIEventCallbacks {
     virtual void on_bot_llm_stopped() {}
     virtual void on_bot_llm_text(const BotLLMTextData&) {}
 
+    // Called instead of `on_bot_tts_text()` and `on_bot_llm_text()` if text
+    // aggregation is enabled (see RTVIClientOptions).
+    virtual void on_bot_tts_text_aggregated(const BotAggregatedTextData&) {}
+    virtual void on_bot_llm_text_aggregated(const BotAggregatedTextData&) {}
+
     virtual void on_user_started_speaking() {}
     virtual void on_user_stopped_speaking() {}
     virtual void on_user_transcript(const UserTranscriptData&) {}
 
     virtual void on_generic_message(const nlohmann::json&) {}
     virtual void on_message_error(const nlohmann::json&) {}
+
+    // Periodic latency snapshots, if enabled (see RTVIClientOptions).
+    virtual void on_latency_snapshot(const RTVILatencySnapshot&) {}
 };
 
 }  // namespace rtvi
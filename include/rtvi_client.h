@@ -5,20 +5,48 @@
 #ifndef RTVI_CLIENT_H
 #define RTVI_CLIENT_H
 
+#include "rtvi_action_table.h"
 #include "rtvi_callbacks.h"
+#include "rtvi_executor.h"
 #include "rtvi_helper.h"
+#include "rtvi_http_client.h"
+#include "rtvi_inbound_message.h"
+#include "rtvi_jitter_buffer.h"
+#include "rtvi_latency.h"
+#include "rtvi_message_template.h"
+#include "rtvi_metrics.h"
+#include "rtvi_mpmc_queue.h"
+#include "rtvi_reactor.h"
+#include "rtvi_ring_buffer.h"
+#include "rtvi_session_recorder.h"
+#include "rtvi_text_aggregator.h"
+#include "rtvi_timer.h"
 #include "rtvi_transport.h"
+#include "rtvi_utils.h"
+#include "rtvi_wire_format.h"
 
 #include "json.hpp"
 
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <future>
+#include <map>
 #include <memory>
 #include <mutex>
+#include <optional>
 #include <string>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
 #include <vector>
 
 namespace rtvi {
 
 struct RTVIClientEndpoints {
+    // If empty, no HTTP request is made and `RTVIClientParams::request` is
+    // passed to the transport as the connection info (e.g. for local or mock
+    // transports).
     std::string connect;
 };
 
@@ -28,9 +56,108 @@ struct RTVIClientParams {
     std::vector<std::string> headers;
 };
 
+struct RTVIClientAudioOptions {
+    // If enabled, user and bot audio are staged in lock-free ring buffers
+    // serviced by client threads, so `send_user_audio()` and
+    // `read_bot_audio()` never block on the transport. `send_user_audio()`
+    // then returns the number of frames staged, not sent. Bot audio is
+    // polled from the transport every `chunk_ms / 2` while there is none,
+    // which adds up to that much latency. Otherwise audio is passed straight
+    // through to the transport.
+    bool staging = false;
+    // Transport audio format, unless the transport provides its own.
+    uint32_t sample_rate = 16000;
+    uint32_t num_channels = 1;
+    // Format of the audio passed to `send_user_audio()` and returned by
+    // `read_bot_audio()`, if different from the transport format. Converting
+    // sample rates or channels requires staging.
+    std::optional<RTVIAudioFormat> device_format;
+    // Capacity of each ring buffer.
+    uint32_t buffer_ms = 1000;
+    // Frames handed out by `acquire_user_audio_frame()` if the transport
+    // doesn't provide its own pool.
+    uint32_t frame_pool_size = 64;
+    uint32_t frame_ms = 20;
+    // Amount of audio moved between the ring buffers and the transport.
+    uint32_t chunk_ms = 10;
+    // If enabled (and staging is enabled), bot audio goes through an adaptive
+    // jitter buffer with a target depth between the given bounds. The depth
+    // only adapts to jitter if the transport provides arrival times.
+    bool jitter_buffer = false;
+    uint32_t jitter_min_delay_ms = 20;
+    uint32_t jitter_max_delay_ms = 400;
+};
+
 struct RTVIClientOptions {
     RTVIClientParams params;
     RTVIEventCallbacks* callbacks;
+    RTVIClientAudioOptions audio;
+    // If set, callbacks and helpers are called from an executor instead of
+    // the transport thread. The executor can be shared: each client is
+    // assigned one of its threads, so clients are spread across them.
+    // Messages of a client are handled in the order they arrive, not just in
+    // order within each type, since events of different types depend on
+    // each other (e.g. `bot-llm-started` and the `bot-llm-text` after it).
+    // If the executor queue overflows, action responses, errors, function
+    // calls and the started/stopped events are never dropped. The executor
+    // must outlive the client.
+    RTVIExecutor* executor = nullptr;
+    // Message types that are safe to coalesce when the executor uses the
+    // coalesce overflow policy: a pending message is replaced by a newer one
+    // of the same type. Nothing is coalesced unless listed here.
+    std::vector<std::string> coalescable_messages;
+    // Actions waiting for a response are kept in a fixed-capacity table,
+    // split in shards so that threads sending actions rarely contend. Sending
+    // an action throws if the table is full. The table is allocated upfront,
+    // with about four slots per action.
+    size_t max_pending_actions = 256;
+    size_t action_table_shards = 4;
+    // Used to connect to the endpoint. If not set, all clients share
+    // `RTVIHttpClient::shared()` so connections are reused between sessions.
+    RTVIHttpClient* http_client = nullptr;
+    // If set, message dispatch and action timeouts run on the reactor (instead
+    // of the executor or the client threads), and so does audio staging if the
+    // transport has non-blocking audio. Usually set by RTVISessionManager.
+    // The reactor must outlive the client.
+    RTVIReactor* reactor = nullptr;
+    // If set, `bot-tts-text` and `bot-llm-text` tokens are accumulated for
+    // each turn and delivered in chunks to `on_bot_tts_text_aggregated()` and
+    // `on_bot_llm_text_aggregated()`.
+    std::optional<RTVITextAggregatorOptions> text_aggregation;
+    // If non-zero, strings decoded while dispatching a message are allocated
+    // from an arena with blocks of this size instead of the heap. There's one
+    // arena per dispatching thread and block size, rewound after each
+    // message.
+    size_t message_arena_block_size = 0;
+    // Wire formats to send messages with, in order of preference. The first
+    // one supported by the transport is used. Otherwise, or if empty,
+    // messages are passed to the transport as JSON objects.
+    std::vector<RTVIWireFormat> wire_formats;
+    // If set, the latency of each voice turn is tracked from the moment the
+    // user stops speaking until the first bot audio is read.
+    std::optional<RTVILatencyOptions> latency;
+    // If set, all messages and audio exchanged with the transport are
+    // recorded to a log that RTVIReplayTransport can play back. The log is
+    // complete when the client is destroyed.
+    std::optional<RTVISessionRecorderOptions> recording;
+};
+
+struct RTVIMessageStats {
+    uint64_t messages;
+    // Messages that needed a DOM (e.g. for helpers or generic messages).
+    uint64_t parsed_messages;
+    // Allocations served by the message arenas, and blocks they requested
+    // from the heap.
+    uint64_t arena_allocations;
+    uint64_t arena_heap_allocations;
+};
+
+struct RTVIActionOptions {
+    // Zero means the action never expires.
+    std::chrono::milliseconds timeout {0};
+    // Called if the action times out, is cancelled or the client disconnects
+    // before there's a response.
+    RTVIActionErrorCallback on_error;
 };
 
 class RTVIClient : public RTVITransportMessageObserver {
@@ -46,6 +173,13 @@ class RTVIClient : public RTVITransportMessageObserver {
 
     virtual void connect();
 
+    // Connects without blocking the caller. The endpoint request is driven by
+    // the HTTP client event loop and the transport is connected from one of
+    // its callback threads, where `callback` is called.
+    virtual void connect_async(RTVIConnectCallback callback);
+
+    std::future<void> connect_async();
+
     virtual void disconnect();
 
     virtual void send_action(const nlohmann::json& action);
@@ -53,10 +187,65 @@ class RTVIClient : public RTVITransportMessageObserver {
     virtual void
     send_action(const nlohmann::json& action, RTVIActionCallback callback);
 
+    virtual void send_action(
+            const nlohmann::json& action,
+            RTVIActionCallback callback,
+            const RTVIActionOptions& options
+    );
+
+    // Sends an action written from a pre-serialized template, which skips
+    // building a DOM if JSON is the negotiated wire format (otherwise only
+    // `arguments` is parsed). `arguments` must be valid JSON text.
+    void send_action(
+            const RTVIActionTemplate& action,
+            std::string_view arguments,
+            RTVIActionCallback callback,
+            const RTVIActionOptions& options = RTVIActionOptions {}
+    );
+
+    // The future holds the action response data, or a RTVIActionException.
+    std::future<nlohmann::json> send_action_async(
+            const nlohmann::json& action,
+            std::chrono::milliseconds timeout = std::chrono::milliseconds(0)
+    );
+
+    // Returns false if the action is not pending anymore.
+    bool cancel_action(const std::string& action_id);
+
+    bool is_connected() const { return _connected; }
+
+    // Work done for this client by its reactor, if any.
+    const RTVIReactorLoad& reactor_load() const { return _reactor_load; }
+
     virtual int32_t send_user_audio(const int16_t* frames, size_t num_frames);
 
+    // Returns the number of frames of bot audio read. With the jitter buffer,
+    // `frames` is always filled (underruns are concealed) but only the bot
+    // audio is counted.
     virtual int32_t read_bot_audio(int16_t* frames, size_t num_frames);
 
+    virtual int32_t send_user_audio(const float* frames, size_t num_frames);
+
+    virtual int32_t read_bot_audio(float* frames, size_t num_frames);
+
+    // Zero-copy user audio. Acquire a frame, fill it and commit it. Frames
+    // come from the transport pool if it has one, otherwise from a client pool.
+    // Returns an empty reference if all frames are in use.
+    RTVIAudioFrameRef acquire_user_audio_frame();
+
+    int32_t commit_user_audio_frame(RTVIAudioFrameRef frame);
+
+    // Zero-copy bot audio. This bypasses staging so it's only available if
+    // audio staging is disabled.
+    RTVIAudioFrameRef read_bot_audio_frame();
+
+    // Only available if the jitter buffer is enabled.
+    std::optional<RTVIJitterBufferStats> bot_audio_stats() const;
+
+    // Only available if an executor is used. The stats cover all the clients
+    // sharing the executor.
+    std::optional<RTVIExecutorStats> executor_stats() const;
+
     virtual void register_helper(
             const std::string& service,
             std::shared_ptr<RTVIHelper> helper
@@ -64,32 +253,190 @@ class RTVIClient : public RTVITransportMessageObserver {
 
     virtual void unregister_helper(const std::string& service);
 
+    RTVIMessageStats message_stats() const;
+
+    // Only available if latency tracking is enabled.
+    std::optional<RTVILatencySnapshot> latency_snapshot() const;
+
+    // Format messages are sent with, if the transport supports any of the
+    // requested ones.
+    std::optional<RTVIWireFormat> wire_format() const { return _wire_format; }
+
     // RTVITransportMessageObserver
     void on_transport_message(const nlohmann::json& message);
+    void on_transport_frame(std::string frame);
+    void on_transport_encoded_frame(
+            RTVIWireFormat format,
+            const uint8_t* data,
+            size_t size
+    );
 
    private:
+    typedef void (RTVIClient::*MessageHandler)(const RTVIInboundMessage&);
+
+    // Helpers supporting each message type, in service order.
+    struct HelperIndex {
+        std::deque<std::string> types;
+        std::unordered_map<
+                std::string_view,
+                std::vector<std::shared_ptr<RTVIHelper>>>
+                helpers;
+    };
+
+    static MessageHandler find_message_handler(std::string_view type);
+
     nlohmann::json connect_to_endpoint(
             const std::string& url,
             const nlohmann::json& body,
             const std::vector<std::string>& headers
     ) const;
-    void on_action_response(const nlohmann::json& response);
+    static nlohmann::json
+    parse_endpoint_response(const RTVIHttpResponse& response);
+    static std::vector<std::string>
+    endpoint_headers(const std::vector<std::string>& headers);
+    RTVIHttpClient& http_client() const;
+    void connect_transport(const nlohmann::json& info);
+
+    bool fail_action(
+            const std::string& action_id,
+            RTVIActionError error,
+            const std::string& reason
+    );
+    void fail_all_actions(RTVIActionError error, const std::string& reason);
+
+    template<typename F>
+    void track_action(
+            std::string_view id,
+            RTVIActionCallback callback,
+            const RTVIActionOptions& options,
+            F send
+    );
+    void send_message(const nlohmann::json& message);
+    void send_message_text(const std::vector<uint8_t>& text);
+    void on_inbound_message(RTVIInboundMessage message);
+    RTVIExecutorTaskKind executor_task_kind(std::string_view type) const;
+    void dispatch_message(
+            RTVIInboundMessage& message,
+            std::chrono::steady_clock::time_point received
+    );
+    void handle_message(const RTVIInboundMessage& message);
+    void rebuild_helper_index();
+
+    // Built-in message handlers
+    void on_action_response(const RTVIInboundMessage& message);
+    void on_error_response(const RTVIInboundMessage& message);
+    void on_error(const RTVIInboundMessage& message);
+    void on_bot_ready(const RTVIInboundMessage& message);
+    void on_bot_started_speaking(const RTVIInboundMessage& message);
+    void on_bot_stopped_speaking(const RTVIInboundMessage& message);
+    void on_bot_transcript(const RTVIInboundMessage& message);
+    void on_bot_tts_started(const RTVIInboundMessage& message);
+    void on_bot_tts_stopped(const RTVIInboundMessage& message);
+    void on_bot_tts_text(const RTVIInboundMessage& message);
+    void on_bot_llm_started(const RTVIInboundMessage& message);
+    void on_bot_llm_stopped(const RTVIInboundMessage& message);
+    void on_bot_llm_text(const RTVIInboundMessage& message);
+    void on_user_started_speaking(const RTVIInboundMessage& message);
+    void on_user_stopped_speaking(const RTVIInboundMessage& message);
+    void on_user_transcript(const RTVIInboundMessage& message);
+
+    void start_audio();
+    void stop_audio();
+    void release_user_frames();
+    template<typename T>
+    int32_t convert_user_audio(const T* frames, size_t num_frames);
+    size_t write_user_audio(const int16_t* frames, size_t num_frames);
+    bool use_reactor_audio() const;
+    bool pump_user_audio();
+    bool user_audio_pending() const;
+    bool pump_bot_audio();
+    void user_audio_loop();
+    void bot_audio_loop();
+    void reactor_audio_loop();
+
+    RTVITimerId
+    schedule_timer(std::chrono::milliseconds delay, std::function<void()> task);
+    void cancel_timer(RTVITimerId id);
+    void schedule_latency_snapshot(uint64_t generation);
+    void stop_latency_snapshots();
 
    private:
     std::atomic<bool> _initialized;
     std::atomic<bool> _connected;
+    std::mutex _connect_mutex;
+    std::condition_variable _connect_condition;
+    bool _connecting;
 
     std::mutex _mutex;
     RTVIClientOptions _options;
     std::unique_ptr<RTVITransport> _transport;
+    std::optional<RTVIWireFormat> _wire_format;
+
+    // Selects the executor thread of the client.
+    uint32_t _executor_key;
+    RTVIReactorLoad _reactor_load;
+
+    // Latency tracking. Declared before the timer so it outlives snapshots
+    // still running when the client is destroyed.
+    std::unique_ptr<RTVILatencyTracker> _latency;
+    std::mutex _latency_mutex;
+    RTVITimerId _latency_timer;
+    // Bumped to stop the snapshots scheduled so far from rescheduling.
+    uint64_t _latency_generation;
 
     // RTVI action-response
-    std::mutex _actions_mutex;
-    std::map<std::string, RTVIActionCallback> _action_callbacks;
+    struct PendingAction {
+        RTVIActionCallback callback;
+        RTVIActionErrorCallback error_callback;
+        RTVITimerId timer;
+        // Only set if metrics are enabled.
+        std::chrono::steady_clock::time_point sent;
+    };
+
+    RTVIActionTable<PendingAction> _pending_actions;
+    RTVITimer _action_timer;
+
+    std::atomic<uint64_t> _messages;
+    std::atomic<uint64_t> _parsed_messages;
+    std::atomic<uint64_t> _arena_allocations;
+    std::atomic<uint64_t> _arena_heap_allocations;
+
+    // Text aggregation
+    std::unique_ptr<RTVITextAggregator> _tts_text;
+    std::unique_ptr<RTVITextAggregator> _llm_text;
+
+    std::unique_ptr<RTVISessionRecorder> _recorder;
 
     // RTVI helpers
     std::mutex _helpers_mutex;
     std::map<std::string, std::shared_ptr<RTVIHelper>> _helpers;
+    // Rebuilt when helpers change and read without locking.
+    RTVIAtomicSharedPtr<const HelperIndex> _helper_index;
+
+    // Audio staging
+    RTVIAudioFormat _transport_format;
+    RTVIAudioFormat _device_format;
+    std::unique_ptr<RTVIAudioConverter> _user_converter;
+    std::unique_ptr<RTVIAudioConverter> _bot_converter;
+    std::vector<int16_t> _user_converted;
+    std::vector<int16_t> _bot_converted;
+    std::atomic<bool> _audio_running;
+    // Signaled when user audio is staged, or when staging stops.
+    RTVIEventCount _user_audio_ready;
+    std::unique_ptr<RTVIAudioRingBuffer> _user_audio;
+    std::unique_ptr<RTVIAudioFramePool> _user_frame_pool;
+    // Committed user frames, whose references are owned by the queue.
+    std::unique_ptr<RTVIRingBuffer<RTVIAudioFrame*>> _user_frames;
+    std::unique_ptr<RTVIAudioRingBuffer> _bot_audio;
+    std::unique_ptr<RTVIJitterBuffer> _bot_jitter_buffer;
+    // Scratch buffers of the audio loops.
+    std::vector<int16_t> _user_chunk;
+    std::vector<int16_t> _bot_chunk;
+    std::vector<int16_t> _bot_chunk_converted;
+    std::thread _user_audio_thread;
+    std::thread _bot_audio_thread;
+    // Only used from the reactor thread.
+    RTVITimerId _audio_pump_timer;
 };
 
 }  // namespace rtvi
@@ -0,0 +1,85 @@
+//
+// Copyright (c) 2024, Daily
+//
+
+#ifndef RTVI_COROUTINE_H
+#define RTVI_COROUTINE_H
+
+#include "rtvi_client.h"
+
+#include "json.hpp"
+
+#include <chrono>
+#include <exception>
+
+// Only available when compiling with coroutine support (e.g. C++20), which
+// the library itself doesn't need.
+#if defined(__cpp_impl_coroutine) && __has_include(<coroutine>)
+#include <coroutine>
+
+namespace rtvi {
+
+class RTVIActionAwaitable {
+   public:
+    RTVIActionAwaitable(
+            RTVIClient& client,
+            const nlohmann::json& action,
+            std::chrono::milliseconds timeout
+    )
+        : _client(client), _action(action), _timeout(timeout) {}
+
+    bool await_ready() const noexcept { return false; }
+
+    void await_suspend(std::coroutine_handle<> handle) {
+        // The coroutine (and this awaitable) might be gone as soon as it's
+        // resumed, which can happen before `send_action()` returns.
+        nlohmann::json action = std::move(_action);
+        _client.send_action(
+                action,
+                [this, handle](const nlohmann::json& data) {
+                    _result = data;
+                    handle.resume();
+                },
+                RTVIActionOptions {
+                        .timeout = _timeout,
+                        .on_error =
+                                [this, handle](const RTVIActionException& ex) {
+                                    _error = std::make_exception_ptr(ex);
+                                    handle.resume();
+                                },
+                }
+        );
+    }
+
+    nlohmann::json await_resume() {
+        if (_error) {
+            std::rethrow_exception(_error);
+        }
+        return std::move(_result);
+    }
+
+   private:
+    RTVIClient& _client;
+    nlohmann::json _action;
+    std::chrono::milliseconds _timeout;
+    nlohmann::json _result;
+    std::exception_ptr _error;
+};
+
+// Sends an action and suspends the coroutine until there's a response, which
+// is the result of `co_await`. Throws RTVIActionException if the action
+// fails. The coroutine is resumed from the thread delivering the response, or
+// from the timer thread if the action times out.
+inline RTVIActionAwaitable co_send_action(
+        RTVIClient& client,
+        const nlohmann::json& action,
+        std::chrono::milliseconds timeout = std::chrono::milliseconds(0)
+) {
+    return RTVIActionAwaitable(client, action, timeout);
+}
+
+}  // namespace rtvi
+
+#endif
+
+#endif
@@ -19,6 +19,24 @@ class RTVIException : public std::exception {
     std::string _message;
 };
 
+enum class RTVIActionError {
+    Timeout,
+    Cancelled,
+    Disconnected,
+};
+
+// Reported when an action doesn't get a response.
+class RTVIActionException : public RTVIException {
+   public:
+    RTVIActionException(RTVIActionError error, const std::string& msg)
+        : RTVIException(msg), _error(error) {}
+
+    RTVIActionError error() const { return _error; }
+
+   private:
+    RTVIActionError _error;
+};
+
 }  // namespace rtvi
 
 #endif
@@ -0,0 +1,154 @@
+//
+// Copyright (c) 2024, Daily
+//
+
+#ifndef RTVI_EXECUTOR_H
+#define RTVI_EXECUTOR_H
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace rtvi {
+
+// What the overflow policy may do with a task.
+enum class RTVIExecutorTaskKind {
+    // Never dropped. It's queued even if the queue is full.
+    Required,
+    Droppable,
+    // Droppable, and can also be replaced by a newer task with the same
+    // coalesce key.
+    Coalescable,
+};
+
+// Applies when a task is submitted to a full queue, and only ever drops or
+// replaces droppable tasks.
+enum class RTVIExecutorOverflowPolicy {
+    // Drop the oldest droppable pending task of the worker.
+    DropOldest,
+    // Drop the task being submitted.
+    DropNewest,
+    // Replace the most recent coalescable pending task with the same coalesce
+    // key, or drop the oldest droppable pending task if there is none.
+    Coalesce,
+};
+
+struct RTVIExecutorOptions {
+    uint32_t num_threads = 1;
+    // Maximum number of pending tasks per thread (0 for no limit). Required
+    // tasks are queued even beyond it.
+    size_t max_queue_size = 1024;
+    RTVIExecutorOverflowPolicy overflow_policy =
+            RTVIExecutorOverflowPolicy::DropOldest;
+    // Called from the worker thread with the exception thrown by a task.
+    // Exceptions are always caught (and counted), so a failing task never
+    // stops its worker.
+    std::function<void(std::exception_ptr error)> on_error;
+};
+
+struct RTVIExecutorStats {
+    size_t queue_depth;
+    uint64_t submitted;
+    uint64_t executed;
+    // Tasks that threw.
+    uint64_t failed;
+    uint64_t dropped;
+    uint64_t coalesced;
+    // Time from submission until a task starts running.
+    uint64_t total_queue_delay_us;
+    uint64_t max_queue_delay_us;
+    // Time spent running tasks.
+    uint64_t total_run_time_us;
+    uint64_t max_run_time_us;
+};
+
+// Runs tasks on a set of dedicated threads. Tasks are assigned to a thread
+// based on their key, so tasks with the same key run in submission order
+// (except for coalesced tasks, which take the place of the task they
+// replace). With a single thread all tasks run in submission order.
+// Executors can be shared, e.g. by several clients using different keys.
+class RTVIExecutor {
+   public:
+    typedef std::function<void()> Task;
+
+    explicit RTVIExecutor(const RTVIExecutorOptions& options);
+
+    virtual ~RTVIExecutor();
+
+    // Returns false if the task was dropped.
+    bool submit(
+            uint32_t key,
+            Task task,
+            RTVIExecutorTaskKind kind = RTVIExecutorTaskKind::Droppable,
+            uint32_t coalesce_key = 0
+    );
+
+    // Waits until the tasks submitted with `key` so far have run (or have
+    // been discarded by `stop()`). Must not be called from a worker thread.
+    void flush(uint32_t key);
+
+    // Pending tasks are discarded, unless `run_pending` is set, in which case
+    // the workers run them before exiting.
+    void stop(bool run_pending = false);
+
+    RTVIExecutorStats stats() const;
+
+   private:
+    struct Entry {
+        RTVIExecutorTaskKind kind;
+        uint32_t coalesce_key;
+        Task task;
+        std::chrono::steady_clock::time_point submitted;
+    };
+
+    struct Worker {
+        std::mutex mutex;
+        std::condition_variable condition;
+        std::deque<Entry> queue;
+        std::thread thread;
+    };
+
+    enum class Overflow {
+        Queue,
+        Coalesced,
+        Dropped,
+    };
+
+    Overflow make_room(Worker* worker, Entry& entry);
+    void run(Worker* worker);
+    void run_task(Task& task);
+
+   private:
+    RTVIExecutorOptions _options;
+    std::vector<std::unique_ptr<Worker>> _workers;
+    enum class State {
+        Running,
+        // Stopped, but the workers run the pending tasks before exiting.
+        Draining,
+        Stopped,
+    };
+
+    std::atomic<State> _state;
+
+    std::atomic<uint64_t> _submitted;
+    std::atomic<uint64_t> _executed;
+    std::atomic<uint64_t> _failed;
+    std::atomic<uint64_t> _dropped;
+    std::atomic<uint64_t> _coalesced;
+    std::atomic<uint64_t> _total_queue_delay_us;
+    std::atomic<uint64_t> _max_queue_delay_us;
+    std::atomic<uint64_t> _total_run_time_us;
+    std::atomic<uint64_t> _max_run_time_us;
+};
+
+}  // namespace rtvi
+
+#endif
@@ -0,0 +1,67 @@
+//
+// Copyright (c) 2024, Daily
+//
+
+#ifndef RTVI_HISTOGRAM_H
+#define RTVI_HISTOGRAM_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace rtvi {
+
+// A high dynamic range histogram of integer values between 1 and
+// `highest_value`, which keeps the given number of significant digits (1 to
+// 5) for all of them. Buckets double in size and are split in linear
+// sub-buckets, so recording is a few bit operations and memory is fixed
+// (e.g. about 26KB for an hour in microseconds with 2 digits).
+//
+// Larger values are recorded as `highest_value`. Not thread-safe.
+class RTVIHistogram {
+   public:
+    RTVIHistogram(uint64_t highest_value, int significant_digits);
+
+    void record(uint64_t value, uint64_t count = 1);
+
+    // Adds all the values of a histogram with the same layout.
+    void merge(const RTVIHistogram& other);
+
+    void reset();
+
+    uint64_t count() const { return _count; }
+
+    uint64_t min() const { return _count > 0 ? _min : 0; }
+
+    uint64_t max() const { return _max; }
+
+    uint64_t sum() const { return _sum; }
+
+    double mean() const;
+
+    // The value below which the given percentage of values fall, within the
+    // histogram precision. Zero if empty.
+    uint64_t percentile(double percentile) const;
+
+    uint64_t highest_value() const { return _highest_value; }
+
+   private:
+    size_t index_of(uint64_t value) const;
+    uint64_t highest_equivalent_value(size_t index) const;
+
+   private:
+    uint64_t _highest_value;
+    uint32_t _sub_bucket_count_magnitude;
+    uint32_t _sub_bucket_half_count_magnitude;
+    uint64_t _sub_bucket_half_count;
+    uint64_t _sub_bucket_mask;
+    std::vector<uint64_t> _counts;
+    uint64_t _count;
+    uint64_t _min;
+    uint64_t _max;
+    uint64_t _sum;
+};
+
+}  // namespace rtvi
+
+#endif
@@ -0,0 +1,149 @@
+//
+// Copyright (c) 2024, Daily
+//
+
+#ifndef RTVI_HTTP_CLIENT_H
+#define RTVI_HTTP_CLIENT_H
+
+#include "rtvi_executor.h"
+
+#include <atomic>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace rtvi {
+
+struct RTVIHttpClientOptions {
+    // Idle request handles kept for reuse. Blocking requests reuse the
+    // connections kept by their handle, so this also bounds the connections
+    // kept alive for them.
+    size_t max_idle_handles = 8;
+    // Negotiate HTTP/2 over TLS, falling back to HTTP/1.1.
+    bool http2 = true;
+    long connect_timeout_ms = 10000;
+    long timeout_ms = 30000;
+    // Threads running the callbacks of asynchronous requests.
+    uint32_t callback_threads = 2;
+};
+
+struct RTVIHttpClientStats {
+    uint64_t requests;
+    uint64_t failed_requests;
+    // Requests sent over an existing connection.
+    uint64_t reused_connections;
+    uint64_t new_connections;
+    // Time spent resolving names, connecting and doing TLS handshakes for new
+    // connections.
+    uint64_t total_dns_time_us;
+    uint64_t total_connect_time_us;
+    uint64_t total_handshake_time_us;
+    uint64_t total_request_time_us;
+};
+
+struct RTVIHttpResponse {
+    long status = 0;
+    std::string body;
+};
+
+// `error` is set if the request couldn't be performed.
+typedef std::function<void(std::exception_ptr error, RTVIHttpResponse response)>
+        RTVIHttpCallback;
+
+// HTTP client sharing DNS, TLS sessions and cookies between all requests, and
+// reusing connections, so requests to the same host don't pay for new
+// handshakes. It's thread-safe.
+class RTVIHttpClient {
+   public:
+    explicit RTVIHttpClient(
+            const RTVIHttpClientOptions& options = RTVIHttpClientOptions()
+    );
+
+    virtual ~RTVIHttpClient();
+
+    // Process-wide client used by default by all RTVIClient instances.
+    static RTVIHttpClient& shared();
+
+    // Throws an RTVIException if the request can't be performed. HTTP errors
+    // are returned as a regular response.
+    RTVIHttpResponse post(
+            const std::string& url,
+            const std::string& body,
+            const std::vector<std::string>& headers
+    );
+
+    // Asynchronous version of `post()`. All asynchronous requests are driven
+    // by a single event loop thread (started on first use), and the callback
+    // is called from one of the callback threads. Pending requests fail when
+    // the client is destroyed.
+    void post_async(
+            const std::string& url,
+            const std::string& body,
+            const std::vector<std::string>& headers,
+            RTVIHttpCallback callback
+    );
+
+    std::future<RTVIHttpResponse> post_async(
+            const std::string& url,
+            const std::string& body,
+            const std::vector<std::string>& headers
+    );
+
+    RTVIHttpClientStats stats() const;
+
+   private:
+    struct AsyncRequest;
+
+    // Gives a handle back to the client when a request is done, even if the
+    // request fails.
+    class HandleLease;
+
+    // Handles are CURL* and CURLSH*, libcurl is not a public dependency.
+    void* acquire_handle();
+    void release_handle(void* handle);
+    void setup_handle(void* handle);
+    void update_stats(void* handle, bool success);
+
+    void start_event_loop();
+    void stop_event_loop();
+    void run_event_loop();
+    void finish_request(void* handle, int result, bool stopping);
+
+   private:
+    RTVIHttpClientOptions _options;
+
+    void* _share;
+    // One lock for each kind of shared data (curl_lock_data).
+    std::mutex _share_locks[8];
+
+    std::mutex _handles_mutex;
+    std::vector<void*> _idle_handles;
+
+    std::atomic<uint64_t> _requests;
+    std::atomic<uint64_t> _failed_requests;
+    std::atomic<uint64_t> _reused_connections;
+    std::atomic<uint64_t> _new_connections;
+    std::atomic<uint64_t> _total_dns_time_us;
+    std::atomic<uint64_t> _total_connect_time_us;
+    std::atomic<uint64_t> _total_handshake_time_us;
+    std::atomic<uint64_t> _total_request_time_us;
+
+    // Asynchronous requests.
+    void* _multi;
+    std::mutex _loop_mutex;
+    std::thread _loop_thread;
+    bool _loop_stopped;
+    std::vector<AsyncRequest*> _new_requests;
+    std::unique_ptr<RTVIExecutor> _callback_executor;
+    uint32_t _next_callback_key;
+};
+
+}  // namespace rtvi
+
+#endif
@@ -0,0 +1,97 @@
+//
+// Copyright (c) 2024, Daily
+//
+
+#ifndef RTVI_INBOUND_MESSAGE_H
+#define RTVI_INBOUND_MESSAGE_H
+
+#include "rtvi_arena.h"
+
+#include "json.hpp"
+
+#include <forward_list>
+#include <optional>
+#include <string>
+#include <string_view>
+
+namespace rtvi {
+
+// A message received from the transport.
+//
+// Messages created from a raw frame are scanned once to locate the top-level
+// `type`, `id` and `data` fields, and `data` fields are then found on demand.
+// Strings are returned as views into the frame, unless they have escape
+// sequences, in which case they are decoded into storage owned by the
+// message (or into an arena, see `set_arena()`). A DOM is only built if
+// `json()` is called.
+//
+// Views are valid as long as the message is. Messages are not thread-safe.
+class RTVIInboundMessage {
+   public:
+    // Throws RTVIException if the frame is not a JSON object.
+    explicit RTVIInboundMessage(std::string frame);
+
+    explicit RTVIInboundMessage(nlohmann::json message);
+
+    // Refers to `message` instead of copying it, so it must outlive the
+    // returned message unless `detach()` is called.
+    static RTVIInboundMessage borrow(const nlohmann::json& message);
+
+    // Copies the borrowed DOM, if any, so the message can outlive it.
+    void detach();
+
+    // Empty if missing or not a string.
+    std::string_view type() const;
+
+    std::string_view id() const;
+
+    std::optional<std::string_view> data_string(std::string_view key) const;
+
+    std::optional<bool> data_bool(std::string_view key) const;
+
+    // The `data` field, or null if missing. Only `data` is parsed.
+    nlohmann::json data() const;
+
+    // The whole message, parsed on first use. Throws
+    // nlohmann::json::parse_error if the frame is not valid JSON.
+    const nlohmann::json& json() const;
+
+    // Whether a DOM has been built (or the message was created from one).
+    bool has_json() const { return _borrowed || _json.has_value(); }
+
+    // Strings decoded from now on are allocated from `arena` instead of the
+    // heap, so they are only valid until the arena is rewound.
+    void set_arena(RTVIArena* arena) { _arena = arena; }
+
+   private:
+    RTVIInboundMessage() = default;
+
+    // Location of a value in the frame, including quotes for strings.
+    struct Span {
+        size_t offset = 0;
+        size_t length = 0;
+        bool found = false;
+    };
+
+    std::string_view view(const Span& span) const;
+    std::optional<std::string_view> data_value(std::string_view key) const;
+    std::optional<std::string_view> string_value(std::string_view value) const;
+    const std::string* json_string(const char* key) const;
+    const nlohmann::json& dom() const;
+
+   private:
+    std::string _frame;
+    Span _type;
+    Span _id;
+    Span _data;
+    mutable std::optional<nlohmann::json> _json;
+    const nlohmann::json* _borrowed = nullptr;
+    RTVIArena* _arena = nullptr;
+    // Strings with escape sequences, decoded on demand. A list so views stay
+    // valid as it grows (and so it doesn't allocate until it's used).
+    mutable std::forward_list<std::string> _decoded;
+};
+
+}  // namespace rtvi
+
+#endif
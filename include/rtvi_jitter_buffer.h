@@ -0,0 +1,124 @@
+//
+// Copyright (c) 2024, Daily
+//
+
+#ifndef RTVI_JITTER_BUFFER_H
+#define RTVI_JITTER_BUFFER_H
+
+#include "rtvi_ring_buffer.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <optional>
+#include <vector>
+
+namespace rtvi {
+
+struct RTVIJitterBufferOptions {
+    uint32_t sample_rate = 16000;
+    uint32_t num_channels = 1;
+    uint32_t capacity_ms = 1000;
+    // Bounds for the adaptive target depth.
+    uint32_t min_delay_ms = 20;
+    uint32_t max_delay_ms = 400;
+};
+
+struct RTVIJitterBufferStats {
+    // Audio currently buffered.
+    uint32_t depth_ms;
+    // Depth the buffer is currently adapting to.
+    uint32_t target_ms;
+    // Smoothed inter-arrival jitter (RFC 3550).
+    double jitter_ms;
+    // Packets that arrived while an underrun was being concealed.
+    uint64_t late_packets;
+    // Frames synthesized to conceal underruns.
+    uint64_t lost_frames;
+    // Frames removed by time compression to reduce latency.
+    uint64_t compressed_frames;
+    // Frames dropped because the buffer was full.
+    uint64_t dropped_frames;
+    uint64_t underruns;
+};
+
+// Adaptive jitter buffer for bot audio. The transport side calls `put()` with
+// each packet as it arrives and the playback side calls `get()`, each from a
+// single (possibly different) thread without locking.
+//
+// Arrival jitter is tracked on the `put()` side, if packets come with their
+// arrival time, and used by `get()` to adapt the target depth. Underruns are
+// concealed by fading out the last played audio and cause a rebuffer, while
+// excess depth is time-compressed away by crossfading.
+class RTVIJitterBuffer {
+   public:
+    explicit RTVIJitterBuffer(const RTVIJitterBufferOptions& options);
+
+    // Producer side. Returns the number of frames buffered. Jitter is only
+    // measured if `arrival` is given, since the time `put()` is called at
+    // usually says more about polling than about the network.
+    size_t put(
+            const int16_t* frames,
+            size_t num_frames,
+            std::optional<std::chrono::steady_clock::time_point> arrival =
+                    std::nullopt
+    );
+
+    // Consumer side. Always fills `num_frames` (with concealment or silence if
+    // needed), but only returns the number of frames that were buffered, so
+    // it's less than `num_frames` on underruns.
+    size_t get(int16_t* frames, size_t num_frames);
+
+    // Producer side, must only be called when the producer is not running.
+    // The consumer drops the audio buffered so far and resets its own state
+    // on its next `get()`.
+    void reset();
+
+    RTVIJitterBufferStats stats() const;
+
+   private:
+    size_t ms_to_frames(double ms) const;
+    double frames_to_ms(size_t frames) const;
+
+    void reset_consumer();
+    void update_target(size_t num_frames);
+    void conceal(int16_t* frames, size_t num_frames);
+    size_t read_compressed(int16_t* frames, size_t num_frames, size_t excess);
+    void remember(const int16_t* frames, size_t num_frames);
+
+   private:
+    RTVIJitterBufferOptions _options;
+    RTVIAudioRingBuffer _buffer;
+
+    // Producer state.
+    bool _has_arrival;
+    std::chrono::steady_clock::time_point _last_arrival;
+    double _last_packet_ms;
+    std::atomic<double> _jitter_ms;
+    std::atomic<double> _packet_ms;
+
+    // Set by `reset()`, with the number of samples to drop.
+    std::atomic<bool> _reset_pending;
+    std::atomic<size_t> _stale_samples;
+
+    // Consumer state.
+    bool _buffering;
+    size_t _target_frames;
+    double _underrun_boost_ms;
+    size_t _conceal_position;
+    bool _fade_in;
+    std::vector<int16_t> _history;
+    std::vector<int16_t> _scratch;
+
+    std::atomic<bool> _concealing;
+    std::atomic<size_t> _target_frames_snapshot;
+    std::atomic<uint64_t> _late_packets;
+    std::atomic<uint64_t> _lost_frames;
+    std::atomic<uint64_t> _compressed_frames;
+    std::atomic<uint64_t> _dropped_frames;
+    std::atomic<uint64_t> _underruns;
+};
+
+}  // namespace rtvi
+
+#endif
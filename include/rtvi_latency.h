@@ -0,0 +1,134 @@
+//
+// Copyright (c) 2024, Daily
+//
+
+#ifndef RTVI_LATENCY_H
+#define RTVI_LATENCY_H
+
+#include "rtvi_histogram.h"
+#include "rtvi_inbound_message.h"
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <vector>
+
+namespace rtvi {
+
+// Stages of a voice turn, measured from `user-stopped-speaking`.
+enum class RTVILatencyStage {
+    // Final `user-transcription`.
+    TranscriptFinal,
+    // `bot-llm-started`.
+    LLMStarted,
+    // First `bot-llm-text`.
+    LLMFirstToken,
+    // `bot-tts-started`.
+    TTSStarted,
+    // `bot-started-speaking`.
+    BotStartedSpeaking,
+    // First non-silent sample returned by `read_bot_audio()`.
+    FirstAudio,
+};
+
+constexpr size_t RTVI_LATENCY_STAGE_COUNT = 6;
+
+const char* latency_stage_name(RTVILatencyStage stage);
+
+struct RTVILatencyOptions {
+    // If non-zero, `on_latency_snapshot()` is called this often while
+    // connected, from the timer thread (or the reactor).
+    std::chrono::milliseconds snapshot_interval {0};
+    // If enabled, periodic snapshots only cover their own interval.
+    bool reset_on_snapshot = false;
+    // Longer latencies are recorded as this.
+    std::chrono::milliseconds max_latency {60000};
+    // Precision of the histograms.
+    int significant_digits = 2;
+};
+
+// All times are in microseconds.
+struct RTVILatencyStageStats {
+    uint64_t count;
+    uint64_t min_us;
+    uint64_t mean_us;
+    uint64_t p50_us;
+    uint64_t p90_us;
+    uint64_t p99_us;
+    uint64_t max_us;
+};
+
+struct RTVILatencySnapshot {
+    // Turns that got bot audio.
+    uint64_t turns;
+    // Turns where the user spoke again before there was any bot audio.
+    uint64_t interrupted_turns;
+    // Indexed by RTVILatencyStage.
+    std::array<RTVILatencyStageStats, RTVI_LATENCY_STAGE_COUNT> stages;
+    // Stages of the last turn that got bot audio, or -1 for stages it didn't
+    // have.
+    std::array<int64_t, RTVI_LATENCY_STAGE_COUNT> last_turn_us;
+};
+
+// Tracks the latency of each voice turn: the time from the moment the user
+// stops speaking until each stage of the bot response, and ultimately until
+// the first bot audio is played. Only the first occurrence of a stage in a
+// turn counts, and stages seen before the user stops speaking are ignored.
+//
+// Bot audio is only checked once TTS has started (or the bot has started
+// speaking), so audio left over from a previous turn isn't counted.
+//
+// Thread-safe. `on_bot_audio()` is meant to be called on every read and only
+// does any work while waiting for the first audio of a turn.
+class RTVILatencyTracker {
+   public:
+    typedef std::chrono::steady_clock::time_point TimePoint;
+
+    explicit RTVILatencyTracker(const RTVILatencyOptions& options);
+
+    // Call when a message is received, before any queueing.
+    void
+    on_message(const RTVIInboundMessage& message, TimePoint now = clock_now());
+
+    void on_bot_audio(const int16_t* samples, size_t num_samples) {
+        if (_waiting_for_audio.load(std::memory_order_relaxed)) {
+            on_bot_audio(samples, num_samples, clock_now());
+        }
+    }
+
+    void
+    on_bot_audio(const int16_t* samples, size_t num_samples, TimePoint now);
+
+    void on_user_started_speaking(TimePoint now = clock_now());
+
+    void on_user_stopped_speaking(TimePoint now = clock_now());
+
+    void mark(RTVILatencyStage stage, TimePoint now = clock_now());
+
+    RTVILatencySnapshot snapshot(bool reset = false);
+
+    void reset();
+
+   private:
+    static TimePoint clock_now() { return std::chrono::steady_clock::now(); }
+
+    void end_turn();
+
+   private:
+    std::mutex _mutex;
+    std::vector<RTVIHistogram> _histograms;
+    uint64_t _turns;
+    uint64_t _interrupted_turns;
+    std::array<int64_t, RTVI_LATENCY_STAGE_COUNT> _last_turn;
+
+    // Current turn.
+    bool _active;
+    TimePoint _turn_start;
+    std::array<int64_t, RTVI_LATENCY_STAGE_COUNT> _turn;
+    std::atomic<bool> _waiting_for_audio;
+};
+
+}  // namespace rtvi
+
+#endif
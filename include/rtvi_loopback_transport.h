@@ -0,0 +1,219 @@
+//
+// Copyright (c) 2024, Daily
+//
+
+#ifndef RTVI_LOOPBACK_TRANSPORT_H
+#define RTVI_LOOPBACK_TRANSPORT_H
+
+#include "rtvi_ring_buffer.h"
+#include "rtvi_transport.h"
+
+#include "json.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace rtvi {
+
+struct RTVILoopbackEvent {
+    // Time since the previous event.
+    std::chrono::microseconds delay {0};
+    // Sent to the client as is, if not empty.
+    std::string frame;
+    // Frames of bot audio (a tone) made available to the client.
+    uint32_t audio_frames = 0;
+};
+
+struct RTVILoopbackBotOptions {
+    // Number of turns to run, or zero to run until stopped.
+    uint32_t turns = 0;
+    // Delays are multiplied by this, so 1 is real time, 0.5 twice as fast and
+    // 0 sends everything as fast as possible.
+    double time_scale = 1.0;
+    // Pause before the user starts speaking on each turn.
+    std::chrono::milliseconds turn_interval {1000};
+    std::string user_text = "Hello! What's the weather like in San Francisco?";
+    std::string bot_text =
+            "It's sunny and 72 degrees in San Francisco right now. "
+            "Is there anything else I can help you with?";
+    double user_words_per_second = 3.0;
+    double llm_tokens_per_second = 50.0;
+    double tts_words_per_second = 3.0;
+    // Every this many turns the bot calls a function before answering. Zero
+    // disables function calls.
+    uint32_t function_call_interval = 0;
+    std::string function_name = "get_weather";
+    nlohmann::json function_args = {{"location", "San Francisco"}};
+    RTVIAudioFormat audio_format;
+    // Bot audio the client hasn't read yet is dropped beyond this.
+    uint32_t audio_buffer_ms = 1000;
+    // Returns the result of each action. By default actions return `true`.
+    std::function<nlohmann::json(const nlohmann::json& data)> on_action;
+    // If not empty, replaces the generated turns.
+    std::vector<RTVILoopbackEvent> script;
+};
+
+struct RTVILoopbackStats {
+    uint64_t turns;
+    uint64_t frames_sent;
+    uint64_t frames_received;
+    uint64_t actions;
+    uint64_t function_call_results;
+    uint64_t bot_audio_frames;
+    uint64_t bot_audio_dropped;
+    uint64_t user_audio_frames;
+};
+
+// A fake bot playing conversation turns from its own thread: user
+// transcriptions, optional function calls, LLM tokens and TTS text and
+// audio, paced at the configured rates. It also answers `client-ready`,
+// actions and config requests.
+class RTVILoopbackBot {
+   public:
+    // Receives frames from the bot thread.
+    typedef std::function<void(std::string frame)> Sink;
+
+    explicit RTVILoopbackBot(const RTVILoopbackBotOptions& options);
+
+    ~RTVILoopbackBot();
+
+    void start(Sink sink);
+
+    void stop();
+
+    // Handles a frame sent by the client. Responses are sent from the bot
+    // thread.
+    void receive(std::string frame);
+
+    // Returns the number of frames read, without blocking.
+    size_t read_audio(int16_t* data, size_t num_frames);
+
+    // Whether all the turns have been played.
+    bool finished() const { return _finished; }
+
+    RTVILoopbackStats stats() const;
+
+    const RTVILoopbackBotOptions& options() const { return _options; }
+
+    // The events of a generated turn, e.g. to build a script from.
+    static std::vector<RTVILoopbackEvent> conversation_turn(
+            const RTVILoopbackBotOptions& options,
+            bool function_call
+    );
+
+   private:
+    void run();
+    void handle(const std::string& frame);
+    void send(std::string frame);
+    void send_message(const nlohmann::json& message);
+    void write_audio(uint32_t num_frames);
+    std::chrono::nanoseconds scaled(std::chrono::microseconds delay) const;
+
+   private:
+    RTVILoopbackBotOptions _options;
+    std::vector<RTVILoopbackEvent> _turn;
+    std::vector<RTVILoopbackEvent> _function_call_turn;
+    Sink _sink;
+
+    std::mutex _mutex;
+    std::condition_variable _condition;
+    std::deque<std::string> _inbox;
+    bool _stopped;
+    std::thread _thread;
+
+    RTVIRingBuffer<int16_t> _audio;
+    // One second of a tone, played in a loop. Only used from the bot thread.
+    std::vector<int16_t> _tone;
+    size_t _tone_position;
+
+    std::atomic<bool> _finished;
+    std::atomic<uint64_t> _turns;
+    std::atomic<uint64_t> _frames_sent;
+    std::atomic<uint64_t> _frames_received;
+    std::atomic<uint64_t> _actions;
+    std::atomic<uint64_t> _function_call_results;
+    std::atomic<uint64_t> _bot_audio_frames;
+    std::atomic<uint64_t> _bot_audio_dropped;
+};
+
+enum class RTVILoopbackMode {
+    // Frames are passed between threads of this process.
+    InProcess,
+    // Frames go through a local socket pair, so the cost of a socket is
+    // included. Audio is always passed in-process. Not available on Windows.
+    Socket,
+};
+
+struct RTVILoopbackTransportOptions {
+    RTVILoopbackMode mode = RTVILoopbackMode::InProcess;
+    RTVILoopbackBotOptions bot;
+};
+
+// A transport connected to an RTVILoopbackBot, to run and measure a client
+// without a network or a bot service. Frames are passed to the observer
+// with `on_transport_frame()` and messages are sent as JSON text.
+class RTVILoopbackTransport : public RTVITransport {
+   public:
+    explicit RTVILoopbackTransport(
+            const RTVILoopbackTransportOptions& options,
+            RTVITransportMessageObserver* observer = nullptr
+    );
+
+    ~RTVILoopbackTransport();
+
+    // Usually the client, which is created after the transport. Must be set
+    // before connecting.
+    void set_observer(RTVITransportMessageObserver* observer) {
+        _observer = observer;
+    }
+
+    RTVILoopbackBot& bot() { return _bot; }
+
+    RTVILoopbackStats stats() const;
+
+    // RTVITransport
+    void initialize() override;
+    void connect(const nlohmann::json& info) override;
+    void disconnect() override;
+    void send_message(const nlohmann::json& message) override;
+    bool supports_wire_format(RTVIWireFormat format) const override;
+    void send_encoded_message(
+            RTVIWireFormat format,
+            const uint8_t* data,
+            size_t size
+    ) override;
+    int32_t send_user_audio(const int16_t* frames, size_t num_frames) override;
+    int32_t read_bot_audio(int16_t* data, size_t num_frames) override;
+    bool nonblocking_audio() const override { return true; }
+    std::optional<RTVIAudioFormat> audio_format() override;
+
+   private:
+    void send_text(std::string text);
+    void read_frames(int fd, std::function<void(std::string)> f);
+
+   private:
+    RTVILoopbackTransportOptions _options;
+    RTVITransportMessageObserver* _observer;
+    RTVILoopbackBot _bot;
+    std::atomic<bool> _connected;
+    std::atomic<uint64_t> _user_audio_frames;
+
+    // Socket mode. The client end is `_sockets[0]` and the bot end
+    // `_sockets[1]`, and each end has a thread reading from it.
+    int _sockets[2];
+    std::mutex _client_write_mutex;
+    std::mutex _bot_write_mutex;
+    std::thread _client_reader;
+    std::thread _bot_reader;
+};
+
+}  // namespace rtvi
+
+#endif
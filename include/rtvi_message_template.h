@@ -0,0 +1,58 @@
+//
+// Copyright (c) 2024, Daily
+//
+
+#ifndef RTVI_MESSAGE_TEMPLATE_H
+#define RTVI_MESSAGE_TEMPLATE_H
+
+#include "json.hpp"
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace rtvi {
+
+// Appends `value` as a quoted and escaped JSON string.
+void append_json_string(std::string_view value, std::vector<uint8_t>& out);
+
+// Pre-serialized action with a fixed service and action name, where only the
+// ID and the arguments change:
+//
+//   {"label":"rtvi-ai","type":"action","data":{"service":"<service>",
+//    "action":"<action>","arguments":<arguments>},"id":"<id>"}
+//
+// Actions are appended to the given buffer, which can be reused.
+class RTVIActionTemplate {
+   public:
+    RTVIActionTemplate(std::string_view service, std::string_view action);
+
+    // `arguments` must be valid JSON text.
+    void write_raw(
+            std::string_view id,
+            std::string_view arguments,
+            std::vector<uint8_t>& out
+    ) const;
+
+    void write(
+            std::string_view id,
+            const nlohmann::json& arguments,
+            std::vector<uint8_t>& out
+    ) const;
+
+    // The same action as a DOM, for when it can't be sent as JSON text.
+    // Throws nlohmann::json::parse_error if `arguments` is not valid JSON.
+    nlohmann::json
+    to_json(std::string_view id, std::string_view arguments) const;
+
+   private:
+    std::string _service;
+    std::string _action;
+    // Everything up to the arguments.
+    std::string _head;
+};
+
+}  // namespace rtvi
+
+#endif
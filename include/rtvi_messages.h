@@ -9,6 +9,9 @@
 
 #include "json.hpp"
 
+#include <string>
+#include <string_view>
+
 namespace rtvi {
 
 struct UserTranscriptData {
@@ -30,6 +33,16 @@ struct BotTTSTextData {
     std::string text;
 };
 
+// Views into the bot turn buffer, only valid during the callback.
+struct BotAggregatedTextData {
+    // Text since the previous callback.
+    std::string_view text;
+    // All the text of the turn so far, including `text`.
+    std::string_view turn;
+    // Set on the last callback of the turn.
+    bool final;
+};
+
 struct RTVIMessage {
     static nlohmann::json message(const std::string& type) {
         return nlohmann::json {
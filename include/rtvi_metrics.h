@@ -0,0 +1,208 @@
+//
+// Copyright (c) 2024, Daily
+//
+
+#ifndef RTVI_METRICS_H
+#define RTVI_METRICS_H
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+// Metrics are only compiled in if RTVI_METRICS is defined (the PIPECAT_METRICS
+// CMake option), and then only collected after `RTVIMetrics::set_enabled()`.
+// Otherwise the RTVI_METRIC_* macros below are no-ops.
+#if defined(RTVI_METRICS)
+#define RTVI_METRICS_ENABLED() ::rtvi::RTVIMetrics::enabled()
+#else
+#define RTVI_METRICS_ENABLED() false
+#endif
+
+#define RTVI_METRIC_ADD(counter, value)                                       \
+    do {                                                                      \
+        if (RTVI_METRICS_ENABLED()) {                                         \
+            ::rtvi::RTVIMetrics::add(                                         \
+                    ::rtvi::RTVIMetricCounter::counter, (value)               \
+            );                                                                \
+        }                                                                     \
+    } while (0)
+
+#define RTVI_METRIC_MESSAGE(type)                                             \
+    do {                                                                      \
+        if (RTVI_METRICS_ENABLED()) {                                         \
+            ::rtvi::RTVIMetrics::add_message(type);                           \
+        }                                                                     \
+    } while (0)
+
+// A start time for RTVI_METRIC_RECORD_SINCE, or a zero time point if metrics
+// are disabled.
+#define RTVI_METRIC_NOW()                                                     \
+    (RTVI_METRICS_ENABLED() ? std::chrono::steady_clock::now()                \
+                            : std::chrono::steady_clock::time_point())
+
+#define RTVI_METRIC_RECORD_SINCE(duration, start)                             \
+    do {                                                                      \
+        if (RTVI_METRICS_ENABLED() &&                                         \
+            (start) != std::chrono::steady_clock::time_point()) {             \
+            ::rtvi::RTVIMetrics::record(                                      \
+                    ::rtvi::RTVIMetricDuration::duration,                     \
+                    std::chrono::steady_clock::now() - (start)                \
+            );                                                                \
+        }                                                                     \
+    } while (0)
+
+namespace rtvi {
+
+enum class RTVIMetricCounter {
+    MessagesSent,
+    ActionsSent,
+    ActionsCompleted,
+    ActionsFailed,
+    UserAudioFrames,
+    BotAudioFrames,
+    // Bot audio reads that got fewer frames than requested.
+    BotAudioUnderruns,
+    QueuePushed,
+    QueuePopped,
+    QueueDropped,
+    // Values currently in all RTVIQueue instances (a gauge).
+    QueueDepth,
+};
+
+constexpr size_t RTVI_METRIC_COUNTER_COUNT = 11;
+
+enum class RTVIMetricDuration {
+    // From the arrival of a message until its handling starts, so it includes
+    // any queueing in the executor or the reactor.
+    MessageDispatch,
+    // Time spent handling a message, including the application callbacks.
+    MessageCallback,
+    // From sending an action until its response arrives.
+    ActionRoundTrip,
+};
+
+constexpr size_t RTVI_METRIC_DURATION_COUNT = 3;
+
+// Durations are bucketed by powers of two: bucket `i` has the values in
+// (2^(i-1), 2^i] nanoseconds, and bucket 0 has everything up to 1ns.
+constexpr size_t RTVI_METRIC_BUCKET_COUNT = 64;
+
+struct RTVIMetricHistogram {
+    uint64_t count;
+    uint64_t sum_ns;
+    std::array<uint64_t, RTVI_METRIC_BUCKET_COUNT> buckets;
+};
+
+struct RTVIMetricsSnapshot {
+    std::chrono::system_clock::time_point start_time;
+    std::chrono::system_clock::time_point time;
+    // Indexed by RTVIMetricCounter.
+    std::array<int64_t, RTVI_METRIC_COUNTER_COUNT> counters;
+    // Received messages by type, only the ones that were received. Types
+    // without a client handler are counted as "other".
+    std::vector<std::pair<std::string_view, uint64_t>> messages_received;
+    // Indexed by RTVIMetricDuration.
+    std::array<RTVIMetricHistogram, RTVI_METRIC_DURATION_COUNT> durations;
+};
+
+// Process-wide metrics. Every thread writes to its own block of counters
+// without any lock or atomic read-modify-write, and `snapshot()` adds up the
+// blocks of all threads. Blocks of threads that exit are reused.
+class RTVIMetrics {
+   public:
+    static bool enabled() { return _enabled.load(std::memory_order_relaxed); }
+
+    static void set_enabled(bool enabled);
+
+    static void add(RTVIMetricCounter counter, int64_t value);
+
+    static void add_message(std::string_view type);
+
+    static void
+    record(RTVIMetricDuration duration, std::chrono::nanoseconds value);
+
+    static RTVIMetricsSnapshot snapshot();
+
+   private:
+    static inline std::atomic<bool> _enabled {false};
+};
+
+const char* metric_counter_name(RTVIMetricCounter counter);
+
+const char* metric_duration_name(RTVIMetricDuration duration);
+
+// Prometheus text exposition format.
+std::string format_prometheus(const RTVIMetricsSnapshot& snapshot);
+
+// A single-line OTLP/JSON `ExportMetricsServiceRequest`, as read by the
+// OpenTelemetry Collector `otlpjsonfile` receiver. Durations are exponential
+// histograms (scale 0) in nanoseconds.
+std::string format_otlp_json(
+        const RTVIMetricsSnapshot& snapshot,
+        const std::string& service_name
+);
+
+enum class RTVIMetricsFormat {
+    Prometheus,
+    OtlpJson,
+};
+
+struct RTVIMetricsExporterOptions {
+    RTVIMetricsFormat format = RTVIMetricsFormat::Prometheus;
+    // A file path, "unix:<path>" for a Unix domain socket or
+    // "tcp:<host>:<port>". Prometheus files are replaced on every export (as
+    // the node exporter textfile collector expects) and OTLP files are
+    // appended to, one line per export. Sockets get one payload per
+    // connection.
+    std::string destination;
+    // Zero only exports on `export_now()`.
+    std::chrono::milliseconds interval {10000};
+    std::string service_name = "pipecat-client";
+};
+
+// Periodically writes the metrics snapshot from its own thread. Failed
+// exports are counted and retried on the next interval.
+class RTVIMetricsExporter {
+   public:
+    explicit RTVIMetricsExporter(const RTVIMetricsExporterOptions& options);
+
+    ~RTVIMetricsExporter();
+
+    void start();
+
+    // Stops the export thread after a final export.
+    void stop();
+
+    // Throws RTVIException if the destination can't be written.
+    void export_now();
+
+    uint64_t failed_exports() const { return _failed_exports; }
+
+   private:
+    void run();
+
+    void write_file(const std::string& payload);
+
+    void write_socket(const std::string& payload);
+
+   private:
+    RTVIMetricsExporterOptions _options;
+    std::thread _thread;
+    std::mutex _export_mutex;
+    std::mutex _mutex;
+    std::condition_variable _condition;
+    bool _running;
+    std::atomic<uint64_t> _failed_exports;
+};
+
+}  // namespace rtvi
+
+#endif
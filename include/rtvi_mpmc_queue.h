@@ -0,0 +1,301 @@
+//
+// Copyright (c) 2024, Daily
+//
+
+#ifndef RTVI_MPMC_QUEUE_H
+#define RTVI_MPMC_QUEUE_H
+
+#include "rtvi_utils.h"
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <optional>
+#include <utility>
+
+namespace rtvi {
+
+// Lets threads wait for a condition without taking a lock in the fast path.
+// Waiters first call `prepare_wait()`, check the condition again, and then
+// either `cancel_wait()` or `wait()`. Notifying is a single atomic load when
+// nobody is waiting. It's backed by a futex on Linux.
+class RTVIEventCount {
+   public:
+    typedef uint32_t Key;
+
+    RTVIEventCount() : _epoch(0), _waiters(0) {}
+
+    Key prepare_wait() {
+        _waiters.fetch_add(1, std::memory_order_seq_cst);
+        return _epoch.load(std::memory_order_seq_cst);
+    }
+
+    void cancel_wait() { _waiters.fetch_sub(1, std::memory_order_seq_cst); }
+
+    void wait(Key key);
+
+    // Returns false if the deadline is reached before being notified.
+    bool wait_until(Key key, std::chrono::steady_clock::time_point deadline);
+
+    void notify_one() { notify(false); }
+
+    void notify_all() { notify(true); }
+
+   private:
+    void notify(bool all);
+    void wake(bool all);
+
+   private:
+    std::atomic<uint32_t> _epoch;
+    std::atomic<uint32_t> _waiters;
+#if !defined(__linux__)
+    std::mutex _mutex;
+    std::condition_variable _condition;
+#endif
+};
+
+// Bounded lock-free multi-producer/multi-consumer queue (Dmitry Vyukov's
+// design). Each slot has a sequence number telling producers and consumers
+// whether it's their turn, so they only contend on the slot they claim.
+// Values are moved in and out. Pops can block, pushes fail if the queue is
+// full.
+//
+// The capacity is rounded up to the next power of two.
+template<typename T>
+class RTVIMpmcQueue {
+   public:
+    explicit RTVIMpmcQueue(size_t capacity)
+        : _capacity(next_power_of_two(std::max<size_t>(capacity, 2))),
+          _mask(_capacity - 1),
+          _slots(new Slot[_capacity]),
+          _stop(false) {
+        for (size_t i = 0; i < _capacity; ++i) {
+            _slots[i].sequence.store(i, std::memory_order_relaxed);
+        }
+    }
+
+    ~RTVIMpmcQueue() {
+        while (try_pop()) {
+        }
+    }
+
+    RTVIMpmcQueue(const RTVIMpmcQueue&) = delete;
+    RTVIMpmcQueue& operator=(const RTVIMpmcQueue&) = delete;
+
+    // Returns false if the queue is full, in which case `value` is left
+    // untouched.
+    bool try_push(T&& value) {
+        size_t position;
+        if (claim(_enqueue_position, 0, 1, position) == 0) {
+            return false;
+        }
+        publish_push(position, std::move(value));
+        _not_empty.notify_one();
+        return true;
+    }
+
+    bool try_push(const T& value) {
+        T copy(value);
+        return try_push(std::move(copy));
+    }
+
+    // Moves up to `count` values from `values` and returns how many were
+    // pushed, claiming all the slots at once.
+    size_t try_push_batch(T* values, size_t count) {
+        size_t position;
+        size_t claimed = claim(_enqueue_position, 0, count, position);
+        for (size_t i = 0; i < claimed; ++i) {
+            publish_push(position + i, std::move(values[i]));
+        }
+        if (claimed > 0) {
+            _not_empty.notify_all();
+        }
+        return claimed;
+    }
+
+    std::optional<T> try_pop() {
+        size_t position;
+        if (claim(_dequeue_position, 1, 1, position) == 0) {
+            return std::nullopt;
+        }
+        return publish_pop(position);
+    }
+
+    // Moves up to `max_count` values to `values` and returns how many were
+    // popped.
+    size_t try_pop_batch(T* values, size_t max_count) {
+        size_t position;
+        size_t claimed = claim(_dequeue_position, 1, max_count, position);
+        for (size_t i = 0; i < claimed; ++i) {
+            values[i] = publish_pop(position + i);
+        }
+        return claimed;
+    }
+
+    // Waits until there's a value or the queue is stopped.
+    std::optional<T> pop() {
+        return pop_until(std::chrono::steady_clock::time_point::max());
+    }
+
+    // Returns nothing if the queue is stopped or the timeout expires.
+    template<typename Rep, typename Period>
+    std::optional<T> pop_for(std::chrono::duration<Rep, Period> timeout) {
+        return pop_until(std::chrono::steady_clock::now() + timeout);
+    }
+
+    std::optional<T> pop_until(std::chrono::steady_clock::time_point deadline) {
+        std::optional<T> value;
+        wait_until(deadline, [this, &value] {
+            value = try_pop();
+            return value.has_value();
+        });
+        return value;
+    }
+
+    // Waits until there's at least one value (or the queue is stopped) and
+    // pops up to `max_count` values.
+    size_t pop_batch(T* values, size_t max_count) {
+        size_t count = 0;
+        wait_until(std::chrono::steady_clock::time_point::max(), [&] {
+            count = try_pop_batch(values, max_count);
+            return count > 0;
+        });
+        return count;
+    }
+
+    // Wakes up all the waiting consumers. Blocking pops don't wait anymore,
+    // but values can still be popped.
+    void stop() {
+        _stop.store(true, std::memory_order_seq_cst);
+        _not_empty.notify_all();
+    }
+
+    bool stopped() const { return _stop.load(std::memory_order_acquire); }
+
+    // Only approximate while other threads push or pop.
+    size_t size() const {
+        size_t enqueue = _enqueue_position.load(std::memory_order_acquire);
+        size_t dequeue = _dequeue_position.load(std::memory_order_acquire);
+        return enqueue > dequeue ? enqueue - dequeue : 0;
+    }
+
+    bool empty() const { return size() == 0; }
+
+    size_t capacity() const { return _capacity; }
+
+   private:
+    struct Slot {
+        std::atomic<size_t> sequence;
+        alignas(T) unsigned char storage[sizeof(T)];
+
+        T* value() { return std::launder(reinterpret_cast<T*>(storage)); }
+    };
+
+    static size_t next_power_of_two(size_t value) {
+        size_t result = 1;
+        while (result < value) {
+            result <<= 1;
+        }
+        return result;
+    }
+
+    // Claims up to `max_count` consecutive slots whose sequence is their
+    // position plus `offset` (0 for producers, 1 for consumers). Returns the
+    // number of slots claimed and the position of the first one.
+    size_t claim(
+            std::atomic<size_t>& cursor,
+            size_t offset,
+            size_t max_count,
+            size_t& position
+    ) {
+        position = cursor.load(std::memory_order_relaxed);
+        while (true) {
+            size_t count = 0;
+            while (count < max_count) {
+                Slot& slot = _slots[(position + count) & _mask];
+                size_t sequence = slot.sequence.load(std::memory_order_acquire);
+                if (sequence != position + count + offset) {
+                    break;
+                }
+                count++;
+            }
+
+            if (count == 0) {
+                // Either the queue is full (or empty), or another thread
+                // claimed the slot and `position` is stale.
+                Slot& slot = _slots[position & _mask];
+                size_t sequence = slot.sequence.load(std::memory_order_acquire);
+                auto diff = static_cast<std::ptrdiff_t>(
+                        sequence - (position + offset)
+                );
+                if (diff < 0) {
+                    return 0;
+                }
+                position = cursor.load(std::memory_order_relaxed);
+                continue;
+            }
+
+            if (cursor.compare_exchange_weak(
+                        position,
+                        position + count,
+                        std::memory_order_relaxed
+                )) {
+                return count;
+            }
+        }
+    }
+
+    void publish_push(size_t position, T&& value) {
+        Slot& slot = _slots[position & _mask];
+        new (slot.storage) T(std::move(value));
+        slot.sequence.store(position + 1, std::memory_order_release);
+    }
+
+    T publish_pop(size_t position) {
+        Slot& slot = _slots[position & _mask];
+        T value(std::move(*slot.value()));
+        slot.value()->~T();
+        slot.sequence.store(position + _capacity, std::memory_order_release);
+        return value;
+    }
+
+    // Calls `ready` until it returns true, waiting for pushes in between.
+    template<typename F>
+    void wait_until(std::chrono::steady_clock::time_point deadline, F ready) {
+        while (!ready()) {
+            RTVIEventCount::Key key = _not_empty.prepare_wait();
+            if (ready()) {
+                _not_empty.cancel_wait();
+                return;
+            }
+            if (_stop.load(std::memory_order_seq_cst)) {
+                _not_empty.cancel_wait();
+                return;
+            }
+            if (deadline == std::chrono::steady_clock::time_point::max()) {
+                _not_empty.wait(key);
+            } else if (!_not_empty.wait_until(key, deadline)) {
+                ready();
+                return;
+            }
+        }
+    }
+
+   private:
+    const size_t _capacity;
+    const size_t _mask;
+    std::unique_ptr<Slot[]> _slots;
+
+    alignas(RTVI_CACHE_LINE_SIZE) std::atomic<size_t> _enqueue_position {0};
+    alignas(RTVI_CACHE_LINE_SIZE) std::atomic<size_t> _dequeue_position {0};
+    alignas(RTVI_CACHE_LINE_SIZE) std::atomic<bool> _stop;
+    RTVIEventCount _not_empty;
+};
+
+}  // namespace rtvi
+
+#endif
@@ -0,0 +1,126 @@
+//
+// Copyright (c) 2024, Daily
+//
+
+#ifndef RTVI_REACTOR_H
+#define RTVI_REACTOR_H
+
+#include "rtvi_timer.h"
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace rtvi {
+
+// Work done by a reactor on behalf of one session.
+struct RTVIReactorLoad {
+    std::atomic<uint64_t> tasks {0};
+    std::atomic<uint64_t> busy_us {0};
+    // Tasks that threw.
+    std::atomic<uint64_t> failed {0};
+};
+
+struct RTVIReactorStats {
+    uint32_t index;
+    // CPU the reactor thread is pinned to, or -1.
+    int cpu;
+    uint64_t tasks;
+    uint64_t timers;
+    // Tasks and timers that threw. Exceptions are caught so they don't stop
+    // the reactor.
+    uint64_t failed;
+    // Time spent running tasks and timers since the reactor started.
+    uint64_t busy_us;
+    uint64_t uptime_us;
+    size_t queue_depth;
+    size_t pending_timers;
+};
+
+// Single thread running posted tasks and timers for many sessions. Tasks run
+// in the order they are posted.
+class RTVIReactor {
+   public:
+    typedef std::function<void()> Task;
+
+    // If `cpu` is not negative the reactor thread is pinned to that CPU (only
+    // supported on Linux).
+    explicit RTVIReactor(
+            uint32_t index = 0,
+            int cpu = -1,
+            std::chrono::milliseconds timer_resolution =
+                    std::chrono::milliseconds(1)
+    );
+
+    virtual ~RTVIReactor();
+
+    // The time spent running the task is accounted to `load`, if given.
+    // Returns false if the reactor is stopped.
+    bool post(Task task, RTVIReactorLoad* load = nullptr);
+
+    RTVITimerId schedule(
+            std::chrono::milliseconds delay,
+            Task task,
+            RTVIReactorLoad* load = nullptr
+    );
+
+    bool cancel(RTVITimerId id);
+
+    // Runs the task in the reactor thread and waits for it, or runs it right
+    // away if called from the reactor thread. Since tasks run in order, this
+    // also waits for all the tasks posted before. The task doesn't run if the
+    // reactor is stopped. An exception thrown by the task is rethrown to the
+    // caller.
+    void run_sync(Task task);
+
+    bool in_reactor_thread() const;
+
+    // Tasks already posted still run, but pending timers are discarded.
+    void stop();
+
+    uint32_t index() const { return _index; }
+
+    int cpu() const { return _cpu; }
+
+    RTVIReactorStats stats() const;
+
+    // CPUs this process is allowed to run on (its affinity mask on Linux,
+    // otherwise every hardware thread), in increasing order.
+    static std::vector<int> available_cpus();
+
+   private:
+    struct Entry {
+        Task task;
+        RTVIReactorLoad* load;
+    };
+
+    void run();
+    void run_task(Task& task, RTVIReactorLoad* load);
+
+   private:
+    uint32_t _index;
+    int _cpu;
+    std::chrono::steady_clock::time_point _start;
+
+    mutable std::mutex _mutex;
+    std::condition_variable _condition;
+    std::deque<Entry> _tasks;
+    RTVITimerWheel _wheel;
+    bool _stopped;
+    std::thread _thread;
+
+    std::atomic<uint64_t> _num_tasks;
+    std::atomic<uint64_t> _num_timers;
+    std::atomic<uint64_t> _num_failed;
+    std::atomic<uint64_t> _busy_us;
+};
+
+}  // namespace rtvi
+
+#endif
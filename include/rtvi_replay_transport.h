@@ -0,0 +1,110 @@
+//
+// Copyright (c) 2024, Daily
+//
+
+#ifndef RTVI_REPLAY_TRANSPORT_H
+#define RTVI_REPLAY_TRANSPORT_H
+
+#include "rtvi_ring_buffer.h"
+#include "rtvi_session_recorder.h"
+#include "rtvi_transport.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <thread>
+
+namespace rtvi {
+
+struct RTVIReplayTransportOptions {
+    // A log written by RTVISessionRecorder (see RTVIClientOptions).
+    std::string path;
+    // 1 replays the session at its original speed, 2 twice as fast, and so
+    // on. Zero replays it as fast as possible, so most bot audio is dropped
+    // unless it's read as fast.
+    double speed = 1.0;
+    // Bot audio waiting to be read. Audio that doesn't fit is dropped.
+    uint32_t audio_buffer_ms = 1000;
+};
+
+struct RTVIReplayStats {
+    uint64_t messages_replayed;
+    uint64_t bot_audio_frames;
+    uint64_t bot_audio_dropped;
+    // What the client sent, which is discarded.
+    uint64_t messages_sent;
+    uint64_t user_audio_frames;
+};
+
+// A transport that plays back a recorded session: received messages are
+// passed to the observer and bot audio is made available to
+// `read_bot_audio()` with their original timing (scaled by the speed), so
+// real traffic can be profiled offline. Messages and audio sent by the client
+// are discarded.
+//
+// The audio format is the one the session was recorded with. Not available
+// on Windows.
+class RTVIReplayTransport : public RTVITransport {
+   public:
+    explicit RTVIReplayTransport(
+            const RTVIReplayTransportOptions& options,
+            RTVITransportMessageObserver* observer = nullptr
+    );
+
+    ~RTVIReplayTransport();
+
+    // Usually the client, which is created after the transport. Must be set
+    // before connecting.
+    void set_observer(RTVITransportMessageObserver* observer) {
+        _observer = observer;
+    }
+
+    // True once the whole session has been replayed.
+    bool finished() const { return _finished; }
+
+    RTVIReplayStats stats() const;
+
+    // RTVITransport
+    void initialize() override;
+    void connect(const nlohmann::json& info) override;
+    void disconnect() override;
+    void send_message(const nlohmann::json& message) override;
+    bool supports_wire_format(RTVIWireFormat format) const override;
+    void send_encoded_message(
+            RTVIWireFormat format,
+            const uint8_t* data,
+            size_t size
+    ) override;
+    int32_t send_user_audio(const int16_t* frames, size_t num_frames) override;
+    int32_t read_bot_audio(int16_t* data, size_t num_frames) override;
+    bool nonblocking_audio() const override { return true; }
+    std::optional<RTVIAudioFormat> audio_format() override;
+
+   private:
+    void run();
+
+    void write_bot_audio(const RTVISessionRecord& record);
+
+   private:
+    RTVIReplayTransportOptions _options;
+    RTVITransportMessageObserver* _observer;
+    RTVISessionLog _log;
+    RTVIAudioRingBuffer _bot_audio;
+
+    std::thread _thread;
+    std::mutex _mutex;
+    std::condition_variable _condition;
+    bool _stopped;
+    std::atomic<bool> _finished;
+
+    std::atomic<uint64_t> _messages_replayed;
+    std::atomic<uint64_t> _bot_audio_frames;
+    std::atomic<uint64_t> _bot_audio_dropped;
+    std::atomic<uint64_t> _messages_sent;
+    std::atomic<uint64_t> _user_audio_frames;
+};
+
+}  // namespace rtvi
+
+#endif
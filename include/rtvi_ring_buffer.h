@@ -0,0 +1,152 @@
+//
+// Copyright (c) 2024, Daily
+//
+
+#ifndef RTVI_RING_BUFFER_H
+#define RTVI_RING_BUFFER_H
+
+#include "rtvi_utils.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <type_traits>
+
+namespace rtvi {
+
+// Wait-free single-producer/single-consumer ring buffer. One thread may call
+// `write()` while another thread calls `read()` without taking any lock. All
+// the storage is allocated in the constructor, so reading and writing never
+// allocate, which makes it safe to use from real-time audio callbacks.
+//
+// The capacity is rounded up to the next power of two.
+template<typename T>
+class RTVIRingBuffer {
+    static_assert(
+            std::is_trivially_copyable<T>::value,
+            "RTVIRingBuffer requires a trivially copyable type"
+    );
+
+   public:
+    explicit RTVIRingBuffer(size_t capacity)
+        : _capacity(next_power_of_two(capacity)),
+          _mask(_capacity - 1),
+          _buffer(new T[_capacity]) {}
+
+    RTVIRingBuffer(const RTVIRingBuffer&) = delete;
+    RTVIRingBuffer& operator=(const RTVIRingBuffer&) = delete;
+
+    // Producer side. Returns the number of elements written, which is less
+    // than `count` if there is not enough free space.
+    size_t write(const T* data, size_t count) {
+        const size_t write_index = _write_index.load(std::memory_order_relaxed);
+        if (_capacity - (write_index - _cached_read_index) < count) {
+            _cached_read_index = _read_index.load(std::memory_order_acquire);
+        }
+
+        size_t to_write =
+                std::min(count, _capacity - (write_index - _cached_read_index));
+        if (to_write == 0) {
+            return 0;
+        }
+
+        size_t offset = write_index & _mask;
+        size_t first = std::min(to_write, _capacity - offset);
+        std::memcpy(&_buffer[offset], data, first * sizeof(T));
+        std::memcpy(&_buffer[0], data + first, (to_write - first) * sizeof(T));
+
+        _write_index.store(write_index + to_write, std::memory_order_release);
+        return to_write;
+    }
+
+    // Consumer side. Returns the number of elements read, which is less than
+    // `count` if there is not enough data available.
+    size_t read(T* data, size_t count) {
+        size_t to_read = peek(data, count);
+        if (to_read > 0) {
+            _read_index.store(
+                    _read_index.load(std::memory_order_relaxed) + to_read,
+                    std::memory_order_release
+            );
+        }
+        return to_read;
+    }
+
+    // Consumer side. Like `read()` but without consuming the elements.
+    size_t peek(T* data, size_t count) {
+        const size_t read_index = _read_index.load(std::memory_order_relaxed);
+        if (_cached_write_index - read_index < count) {
+            _cached_write_index = _write_index.load(std::memory_order_acquire);
+        }
+
+        size_t to_read = std::min(count, _cached_write_index - read_index);
+        if (to_read == 0) {
+            return 0;
+        }
+
+        size_t offset = read_index & _mask;
+        size_t first = std::min(to_read, _capacity - offset);
+        std::memcpy(data, &_buffer[offset], first * sizeof(T));
+        std::memcpy(data + first, &_buffer[0], (to_read - first) * sizeof(T));
+
+        return to_read;
+    }
+
+    // Consumer side. Drops up to `count` elements without copying them.
+    size_t discard(size_t count) {
+        const size_t read_index = _read_index.load(std::memory_order_relaxed);
+        _cached_write_index = _write_index.load(std::memory_order_acquire);
+
+        size_t to_discard = std::min(count, _cached_write_index - read_index);
+        _read_index.store(read_index + to_discard, std::memory_order_release);
+        return to_discard;
+    }
+
+    // Consumer side. Drops all the available elements.
+    void clear() { discard(_capacity); }
+
+    // Number of elements that can be read. This is only a snapshot if called
+    // from the producer thread.
+    size_t size() const {
+        return _write_index.load(std::memory_order_acquire) -
+               _read_index.load(std::memory_order_acquire);
+    }
+
+    // Number of elements that can be written. This is only a snapshot if
+    // called from the consumer thread.
+    size_t free_space() const { return _capacity - size(); }
+
+    size_t capacity() const { return _capacity; }
+
+   private:
+    static size_t next_power_of_two(size_t value) {
+        size_t result = 1;
+        while (result < value) {
+            result <<= 1;
+        }
+        return result;
+    }
+
+   private:
+    // Written by the producer, read by the consumer.
+    alignas(RTVI_CACHE_LINE_SIZE) std::atomic<size_t> _write_index {0};
+    // Producer-local copy of `_read_index`.
+    size_t _cached_read_index {0};
+
+    // Written by the consumer, read by the producer.
+    alignas(RTVI_CACHE_LINE_SIZE) std::atomic<size_t> _read_index {0};
+    // Consumer-local copy of `_write_index`.
+    size_t _cached_write_index {0};
+
+    alignas(RTVI_CACHE_LINE_SIZE) const size_t _capacity;
+    const size_t _mask;
+    std::unique_ptr<T[]> _buffer;
+};
+
+typedef RTVIRingBuffer<int16_t> RTVIAudioRingBuffer;
+
+}  // namespace rtvi
+
+#endif
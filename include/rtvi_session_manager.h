@@ -0,0 +1,90 @@
+//
+// Copyright (c) 2024, Daily
+//
+
+#ifndef RTVI_SESSION_MANAGER_H
+#define RTVI_SESSION_MANAGER_H
+
+#include "rtvi_client.h"
+#include "rtvi_reactor.h"
+
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace rtvi {
+
+typedef uint64_t RTVISessionId;
+
+struct RTVISessionManagerOptions {
+    // Zero uses one reactor per CPU the process is allowed to run on.
+    uint32_t num_reactors = 0;
+    // Pin each reactor thread to its own CPU.
+    bool pin_reactors = true;
+    std::chrono::milliseconds timer_resolution {1};
+};
+
+struct RTVISessionStats {
+    RTVISessionId id;
+    uint32_t reactor;
+    bool connected;
+    // Work done by the session reactor for this session.
+    uint64_t tasks;
+    uint64_t busy_us;
+    // Tasks that threw (e.g. from an application callback).
+    uint64_t failed;
+};
+
+// Runs many clients on a fixed pool of reactor threads. Each session is
+// assigned to the reactor with the fewest sessions, which then runs its
+// message dispatch, action timeouts and, if the transport supports it, its
+// audio pumping (see RTVITransport::nonblocking_audio()).
+class RTVISessionManager {
+   public:
+    explicit RTVISessionManager(
+            const RTVISessionManagerOptions& options =
+                    RTVISessionManagerOptions()
+    );
+
+    virtual ~RTVISessionManager();
+
+    RTVISessionId create_session(
+            const RTVIClientOptions& options,
+            std::unique_ptr<RTVITransport> transport
+    );
+
+    // Returns null if the session doesn't exist.
+    std::shared_ptr<RTVIClient> session(RTVISessionId id) const;
+
+    // The client is destroyed once the last reference to it is released,
+    // which must not happen in a reactor thread.
+    void destroy_session(RTVISessionId id);
+
+    size_t num_sessions() const;
+
+    size_t num_reactors() const { return _reactors.size(); }
+
+    std::vector<RTVISessionStats> session_stats() const;
+
+    std::vector<RTVIReactorStats> reactor_stats() const;
+
+   private:
+    struct Session {
+        std::shared_ptr<RTVIClient> client;
+        uint32_t reactor;
+    };
+
+   private:
+    std::vector<std::unique_ptr<RTVIReactor>> _reactors;
+
+    mutable std::mutex _mutex;
+    std::map<RTVISessionId, Session> _sessions;
+    std::vector<size_t> _reactor_sessions;
+    RTVISessionId _next_id;
+};
+
+}  // namespace rtvi
+
+#endif
@@ -0,0 +1,149 @@
+//
+// Copyright (c) 2024, Daily
+//
+
+#ifndef RTVI_SESSION_RECORDER_H
+#define RTVI_SESSION_RECORDER_H
+
+#include "rtvi_audio_format.h"
+#include "rtvi_wire_format.h"
+
+#include "json.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace rtvi {
+
+enum class RTVISessionRecordType : uint8_t {
+    InboundMessage = 1,
+    OutboundMessage = 2,
+    // Audio in the transport format.
+    UserAudio = 3,
+    BotAudio = 4,
+};
+
+struct RTVISessionRecorderOptions {
+    std::string path;
+    // The log is preallocated to this size (sparsely, where supported) and
+    // records that don't fit are dropped.
+    size_t max_size = 256 * 1024 * 1024;
+    bool record_audio = true;
+};
+
+// Records a session to a memory-mapped, append-only log file: every message
+// and audio frame exchanged with the transport, with monotonic timestamps.
+// Appending only reserves space with a compare-and-swap and copies the
+// record, so it can be called from any thread.
+//
+// The log is complete once the recorder is destroyed. A log left by a process
+// that crashed can still be read up to the last record written.
+//
+// Not available on Windows.
+class RTVISessionRecorder {
+   public:
+    RTVISessionRecorder(
+            const RTVISessionRecorderOptions& options,
+            const RTVIAudioFormat& audio_format
+    );
+
+    ~RTVISessionRecorder();
+
+    RTVISessionRecorder(const RTVISessionRecorder&) = delete;
+    RTVISessionRecorder& operator=(const RTVISessionRecorder&) = delete;
+
+    void record_message(
+            RTVISessionRecordType type,
+            RTVIWireFormat format,
+            const uint8_t* data,
+            size_t size
+    );
+
+    void
+    record_message(RTVISessionRecordType type, const nlohmann::json& message);
+
+    void record_audio(
+            RTVISessionRecordType type,
+            const int16_t* frames,
+            size_t num_frames
+    );
+
+    uint64_t records() const { return _records; }
+
+    // Records that didn't fit in the log.
+    uint64_t dropped() const { return _dropped; }
+
+   private:
+    void append(
+            RTVISessionRecordType type,
+            RTVIWireFormat format,
+            const uint8_t* data,
+            size_t size
+    );
+
+   private:
+    RTVISessionRecorderOptions _options;
+    RTVIAudioFormat _audio_format;
+    std::chrono::steady_clock::time_point _start;
+    int _fd;
+    uint8_t* _data;
+    size_t _capacity;
+    std::atomic<uint64_t> _offset;
+    std::atomic<uint64_t> _records;
+    std::atomic<uint64_t> _dropped;
+};
+
+struct RTVISessionRecord {
+    RTVISessionRecordType type;
+    // Since the start of the recording.
+    std::chrono::nanoseconds time;
+    // Only meaningful for messages.
+    RTVIWireFormat format;
+    const uint8_t* data;
+    size_t size;
+
+    // Audio records have interleaved samples in the log audio format.
+    const int16_t* samples() const {
+        return reinterpret_cast<const int16_t*>(data);
+    }
+
+    size_t num_samples() const { return size / sizeof(int16_t); }
+};
+
+// Reads a log written by RTVISessionRecorder. The file is memory-mapped and
+// records point into it, so they are valid while the log is.
+class RTVISessionLog {
+   public:
+    explicit RTVISessionLog(const std::string& path);
+
+    ~RTVISessionLog();
+
+    RTVISessionLog(const RTVISessionLog&) = delete;
+    RTVISessionLog& operator=(const RTVISessionLog&) = delete;
+
+    std::chrono::system_clock::time_point start_time() const {
+        return _start_time;
+    }
+
+    const RTVIAudioFormat& audio_format() const { return _audio_format; }
+
+    // Returns false at the end of the log.
+    bool next(RTVISessionRecord& record);
+
+    void rewind();
+
+   private:
+    std::chrono::system_clock::time_point _start_time;
+    RTVIAudioFormat _audio_format;
+    const uint8_t* _data;
+    size_t _size;
+    size_t _end;
+    size_t _offset;
+};
+
+}  // namespace rtvi
+
+#endif
@@ -0,0 +1,119 @@
+//
+// Copyright (c) 2024, Daily
+//
+
+#ifndef RTVI_TEXT_AGGREGATOR_H
+#define RTVI_TEXT_AGGREGATOR_H
+
+#include "rtvi_messages.h"
+#include "rtvi_timer.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+
+namespace rtvi {
+
+struct RTVITextAggregatorOptions {
+    // Deliver text at sentence boundaries (a '.', '!' or '?' followed by
+    // whitespace, or a new line).
+    bool sentences = true;
+    // Also deliver text once it has been waiting this long. Zero disables
+    // it. With neither, every token is delivered.
+    std::chrono::milliseconds window {0};
+    // Initial capacity of the turn buffer, which is reused between turns.
+    size_t reserve = 4096;
+};
+
+// Schedules the flushes that deliver text once the window expires (e.g. on
+// the client timer). Without it, the window is only checked as new text
+// arrives.
+struct RTVITextAggregatorTimer {
+    std::function<RTVITimerId(
+            std::chrono::milliseconds delay,
+            std::function<void()> task
+    )>
+            schedule;
+    std::function<void(RTVITimerId id)> cancel;
+};
+
+// Accumulates streamed bot text (e.g. `bot-llm-text` tokens) for a turn in a
+// single reusable buffer and delivers it in coalesced chunks. The callback
+// gets views into a delivery buffer that each chunk is appended to once, so
+// tokens are never copied into their own strings. Views are only valid during
+// the callback.
+//
+// All methods can be called from any thread, including from the callback.
+// The callback is called without the aggregator locked, but never
+// concurrently, so chunks are delivered in order.
+class RTVITextAggregator {
+   public:
+    typedef std::function<void(const BotAggregatedTextData&)> Callback;
+
+    RTVITextAggregator(
+            const RTVITextAggregatorOptions& options,
+            Callback callback,
+            RTVITextAggregatorTimer timer = RTVITextAggregatorTimer()
+    );
+
+    virtual ~RTVITextAggregator();
+
+    // Starts a new turn, discarding any undelivered text.
+    void start();
+
+    void append(
+            std::string_view text,
+            std::chrono::steady_clock::time_point now =
+                    std::chrono::steady_clock::now()
+    );
+
+    // Delivers the rest of the turn, marked as final. Nothing is delivered if
+    // the turn is empty.
+    void stop();
+
+    // Discards any undelivered text and cancels the pending flush. Needs to
+    // be called before the timer goes away.
+    void discard();
+
+   private:
+    size_t find_sentence_boundary(size_t from) const;
+    void schedule_flush(std::chrono::steady_clock::time_point now);
+    void cancel_flush();
+    void flush();
+    void deliver();
+
+   private:
+    RTVITextAggregatorOptions _options;
+    Callback _callback;
+    RTVITextAggregatorTimer _timer;
+
+    std::mutex _mutex;
+    std::string _turn;
+    // End of the text ready to be delivered. Text after it is pending.
+    size_t _ready;
+    // End of the text taken for delivery.
+    size_t _taken;
+    // Whether the ready text ends the turn.
+    bool _end_turn;
+    // Changes when a new turn starts, to know when to reset the delivery
+    // buffer.
+    uint64_t _turn_id;
+    std::chrono::steady_clock::time_point _pending_since;
+    RTVITimerId _flush_timer;
+
+    // Held while delivering.
+    std::mutex _delivery_mutex;
+    std::atomic<std::thread::id> _delivery_thread;
+    // Text of the turn delivered so far.
+    std::string _delivery;
+    uint64_t _delivery_turn_id;
+};
+
+}  // namespace rtvi
+
+#endif
@@ -0,0 +1,147 @@
+//
+// Copyright (c) 2024, Daily
+//
+
+#ifndef RTVI_TIMER_H
+#define RTVI_TIMER_H
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace rtvi {
+
+typedef uint64_t RTVITimerId;
+
+constexpr RTVITimerId RTVI_INVALID_TIMER_ID = 0;
+
+constexpr std::chrono::milliseconds RTVI_TIMER_RESOLUTION {10};
+
+// Hashed timing wheel. Scheduling and cancelling timers are O(1) and
+// advancing only visits the slots of the elapsed ticks. It is not
+// thread-safe, see RTVITimer for a thread-safe version.
+class RTVITimerWheel {
+   public:
+    typedef std::function<void()> Callback;
+
+    RTVITimerWheel(
+            std::chrono::milliseconds resolution,
+            size_t num_slots,
+            std::chrono::steady_clock::time_point now =
+                    std::chrono::steady_clock::now()
+    );
+
+    RTVITimerId schedule(
+            std::chrono::milliseconds delay,
+            Callback callback,
+            std::chrono::steady_clock::time_point now =
+                    std::chrono::steady_clock::now()
+    );
+
+    // Returns false if the timer already expired or was cancelled.
+    bool cancel(RTVITimerId id);
+
+    // Moves the callbacks of the expired timers to `expired`, so they can be
+    // called without holding any lock. Returns the number of expired timers.
+    size_t advance(
+            std::chrono::steady_clock::time_point now,
+            std::vector<Callback>& expired
+    );
+
+    // Discards all the timers.
+    void clear();
+
+    // Time when the next tick needs to be processed.
+    std::chrono::steady_clock::time_point next_tick() const;
+
+    // Time when the next occupied slot needs to be processed, so waiting for
+    // it doesn't wake up on every tick. Timers a full turn or more away can
+    // make it earlier than their expiry, but never later.
+    std::chrono::steady_clock::time_point next_expiry() const;
+
+    size_t size() const { return _size; }
+
+    bool empty() const { return _size == 0; }
+
+   private:
+    static constexpr uint32_t INVALID_INDEX = UINT32_MAX;
+
+    struct Node {
+        uint32_t generation = 0;
+        uint32_t prev = INVALID_INDEX;
+        uint32_t next = INVALID_INDEX;
+        uint64_t expires = 0;
+        bool active = false;
+        Callback callback;
+    };
+
+    uint64_t tick_at(std::chrono::steady_clock::time_point time) const;
+    void link(uint32_t index);
+    void unlink(uint32_t index);
+    void release(uint32_t index);
+
+   private:
+    std::chrono::milliseconds _resolution;
+    std::chrono::steady_clock::time_point _start;
+    uint64_t _current_tick;
+    size_t _size;
+
+    std::vector<uint32_t> _slots;
+    std::vector<Node> _nodes;
+    uint32_t _free;
+};
+
+// Thread-safe timer running the callbacks of the expired timers in its own
+// thread. The thread is only started when the first timer is scheduled and it
+// only wakes up when timers may expire. Callbacks can stop or destroy the
+// timer.
+class RTVITimer {
+   public:
+    explicit RTVITimer(
+            std::chrono::milliseconds resolution = RTVI_TIMER_RESOLUTION,
+            size_t num_slots = 512
+    );
+
+    virtual ~RTVITimer();
+
+    RTVITimerId schedule(
+            std::chrono::milliseconds delay,
+            RTVITimerWheel::Callback callback
+    );
+
+    bool cancel(RTVITimerId id);
+
+    // Pending timers are discarded. If called from a callback, the thread
+    // exits once the callback returns instead of being joined.
+    void stop();
+
+   private:
+    // Shared with the thread, so it outlives the timer if the timer is
+    // destroyed from a callback.
+    struct State {
+        State(std::chrono::milliseconds resolution, size_t num_slots)
+            : wheel(resolution, num_slots), stopped(false) {}
+
+        std::mutex mutex;
+        std::condition_variable condition;
+        RTVITimerWheel wheel;
+        std::atomic<bool> stopped;
+    };
+
+    static void run(std::shared_ptr<State> state);
+
+   private:
+    std::shared_ptr<State> _state;
+    std::thread _thread;
+    bool _running;
+};
+
+}  // namespace rtvi
+
+#endif
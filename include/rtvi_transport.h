@@ -5,15 +5,39 @@
 #ifndef RTVI_TRANSPORT_H
 #define RTVI_TRANSPORT_H
 
+#include "rtvi_audio_format.h"
+#include "rtvi_audio_frame.h"
 #include "rtvi_callbacks.h"
+#include "rtvi_wire_format.h"
 
 #include "json.hpp"
 
+#include <chrono>
+#include <optional>
+#include <string>
+
 namespace rtvi {
 
 class RTVITransportMessageObserver {
    public:
     virtual void on_transport_message(const nlohmann::json& message) = 0;
+
+    // Transports receiving text frames should pass them as is, so observers
+    // can avoid parsing what they don't need. By default the frame is parsed
+    // and passed to `on_transport_message()`.
+    virtual void on_transport_frame(std::string frame) {
+        on_transport_message(nlohmann::json::parse(frame));
+    }
+
+    // Frames in any wire format. By default they are decoded and passed to
+    // `on_transport_message()`.
+    virtual void on_transport_encoded_frame(
+            RTVIWireFormat format,
+            const uint8_t* data,
+            size_t size
+    ) {
+        on_transport_message(decode_message(format, data, size));
+    }
 };
 
 class RTVITransport {
@@ -28,10 +52,57 @@ class RTVITransport {
 
     virtual void send_message(const nlohmann::json& message) = 0;
 
+    // Transports supporting other wire formats are passed messages already
+    // encoded with `send_encoded_message()` (see RTVIClientOptions). It's up
+    // to the transport to agree on a format with the other end.
+    virtual bool supports_wire_format(RTVIWireFormat) const { return false; }
+
+    virtual void send_encoded_message(
+            RTVIWireFormat format,
+            const uint8_t* data,
+            size_t size
+    ) {
+        send_message(decode_message(format, data, size));
+    }
+
     virtual int32_t
     send_user_audio(const int16_t* frames, size_t num_frames) = 0;
 
     virtual int32_t read_bot_audio(int16_t* data, size_t num_frames) = 0;
+
+    // When the audio last returned by `read_bot_audio()` arrived from the
+    // network, for transports that know it. Used to measure jitter.
+    virtual std::optional<std::chrono::steady_clock::time_point>
+    bot_audio_arrival_time() const {
+        return std::nullopt;
+    }
+
+    // Transports whose `send_user_audio()` and `read_bot_audio()` never block
+    // can have their audio moved by a shared reactor (see RTVIClientOptions)
+    // instead of dedicated client threads.
+    virtual bool nonblocking_audio() const { return false; }
+
+    // Format of the audio sent and received by the transport. If not
+    // provided, the client audio options are used.
+    virtual std::optional<RTVIAudioFormat> audio_format() {
+        return std::nullopt;
+    }
+
+    // Zero-copy audio. Transports can lend their own frame pool so user audio
+    // is captured directly into the buffers they send from.
+    virtual RTVIAudioFramePool* user_audio_pool() { return nullptr; }
+
+    // Transports supporting zero-copy should keep a reference to the frame
+    // until it's sent. By default the frame is copied by `send_user_audio()`.
+    virtual int32_t send_user_audio_frame(RTVIAudioFrameRef frame) {
+        return send_user_audio(frame->data(), frame->num_frames());
+    }
+
+    // Returns the next frame of bot audio, or an empty reference if there is
+    // none or if zero-copy is not supported.
+    virtual RTVIAudioFrameRef read_bot_audio_frame() {
+        return RTVIAudioFrameRef();
+    }
 };
 
 }  // namespace rtvi
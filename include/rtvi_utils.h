@@ -5,15 +5,35 @@
 #ifndef RTVI_UTILS_H
 #define RTVI_UTILS_H
 
+#include "rtvi_metrics.h"
+
+#include <algorithm>
 #include <atomic>
+#include <chrono>
 #include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
 #include <mutex>
 #include <optional>
-#include <queue>
 #include <string>
+#include <string_view>
+#include <vector>
 
 namespace rtvi {
 
+// Used to keep data written by different threads on different cache lines.
+constexpr size_t RTVI_CACHE_LINE_SIZE = 64;
+
+// Length of the IDs returned by `generate_random_id()`.
+constexpr size_t RTVI_ID_LENGTH = 10;
+
+// Writes a new ID of `RTVI_ID_LENGTH` alphanumeric characters (not
+// null-terminated). IDs never repeat within a process and are unpredictable
+// across processes. It's lock-free and doesn't allocate.
+void generate_random_id(char* buffer);
+
 std::string generate_random_id();
 
 // Simple hashing function so we can fake pattern matching and switch on strings
@@ -22,21 +42,145 @@ constexpr unsigned int hash(const char* s, int off = 0) {
     return !s[off] ? 5381 : (hash(s, off + 1) * 33) ^ s[off];
 }
 
+// 32-bit FNV-1a hash. Unlike `hash()` it's not recursive, so it's also cheap
+// for strings only known at runtime.
+constexpr uint32_t hash_fnv1a(std::string_view s) {
+    uint32_t result = 2166136261u;
+    for (char c: s) {
+        result ^= static_cast<uint8_t>(c);
+        result *= 16777619u;
+    }
+    return result;
+}
+
+// Shared pointer that can be read and replaced concurrently, so readers can
+// take read-copy-update snapshots of data without any extra locking.
+//
+// `load()` is lock-free: readers announce themselves in a counter while they
+// copy the current pointer. `store()` takes a mutex and retires the previous
+// pointer, which is only freed by a later `store()` (or the destructor) that
+// sees no readers. Meant for data that is read often and replaced rarely.
 template<typename T>
-class RTVIQueue {
+class RTVIAtomicSharedPtr {
    public:
-    RTVIQueue(size_t max_capacity = 0)
-        : _max_capacity(max_capacity), _stop(false) {}
+    RTVIAtomicSharedPtr() : _value(nullptr), _readers(0) {}
+
+    explicit RTVIAtomicSharedPtr(std::shared_ptr<T> value)
+        : _value(new std::shared_ptr<T>(std::move(value))), _readers(0) {}
+
+    ~RTVIAtomicSharedPtr() { delete _value.load(); }
+
+    RTVIAtomicSharedPtr(const RTVIAtomicSharedPtr&) = delete;
+    RTVIAtomicSharedPtr& operator=(const RTVIAtomicSharedPtr&) = delete;
+
+    std::shared_ptr<T> load() const {
+        _readers.fetch_add(1);
+        std::shared_ptr<T>* value = _value.load();
+        std::shared_ptr<T> result = value ? *value : nullptr;
+        _readers.fetch_sub(1, std::memory_order_release);
+        return result;
+    }
+
+    void store(std::shared_ptr<T> value) {
+        auto next = std::make_unique<std::shared_ptr<T>>(std::move(value));
 
-    void push(const T& value) {
         std::lock_guard<std::mutex> lock(_mutex);
-        if (_max_capacity > 0 && _queue.size() >= _max_capacity) {
-            _queue.pop();
+        std::unique_ptr<std::shared_ptr<T>> previous(
+                _value.exchange(next.release())
+        );
+        if (previous) {
+            _retired.push_back(std::move(previous));
+        }
+
+        // Readers that start from now on see the new pointer, so if there
+        // are none left all the retired ones can go.
+        if (_readers.load() == 0) {
+            _retired.clear();
         }
-        _queue.push(std::move(value));
-        _condition.notify_one();
     }
 
+   private:
+    std::atomic<std::shared_ptr<T>*> _value;
+    mutable std::atomic<uint32_t> _readers;
+    std::mutex _mutex;
+    std::vector<std::unique_ptr<std::shared_ptr<T>>> _retired;
+};
+
+enum class RTVIQueueOverflowPolicy {
+    // Drop the oldest queued value.
+    DropOldest,
+    // Drop the value being pushed.
+    DropNewest,
+    // Wait for space, up to the block timeout, and then drop the value being
+    // pushed.
+    Block,
+    // Replace the most recent queued value with the same key, or drop the
+    // oldest queued value if there is none.
+    Coalesce,
+};
+
+template<typename T>
+struct RTVIQueueOptions {
+    // Zero means unbounded.
+    size_t max_capacity = 0;
+    RTVIQueueOverflowPolicy overflow_policy =
+            RTVIQueueOverflowPolicy::DropOldest;
+    // Zero waits until there's space or the queue is stopped.
+    std::chrono::milliseconds block_timeout {0};
+    // Required by the coalesce policy.
+    std::function<uint64_t(const T&)> coalesce_key;
+    // `on_high_water` is called when the queue grows to `high_water_mark`
+    // values, and `on_low_water` when it then shrinks to `low_water_mark`, so
+    // producers can be throttled upstream. Both are called without holding
+    // any lock. A zero high-water mark disables them.
+    size_t high_water_mark = 0;
+    size_t low_water_mark = 0;
+    std::function<void(size_t size)> on_high_water;
+    std::function<void(size_t size)> on_low_water;
+};
+
+struct RTVIQueueStats {
+    size_t size;
+    // Largest size reached.
+    size_t max_size;
+    uint64_t pushed;
+    uint64_t popped;
+    // Values lost because the queue was full, including pushes that timed
+    // out while blocked.
+    uint64_t dropped;
+    uint64_t coalesced;
+    // Pushes that had to wait for space, and how many of them timed out.
+    uint64_t blocked;
+    uint64_t timeouts;
+};
+
+template<typename T>
+class RTVIQueue {
+   public:
+    RTVIQueue(size_t max_capacity = 0)
+        : RTVIQueue(make_options(max_capacity)) {}
+
+    explicit RTVIQueue(const RTVIQueueOptions<T>& options)
+        : _options(options),
+          _stop(false),
+          _above_high_water(false),
+          _max_size(0),
+          _pushed(0),
+          _popped(0),
+          _dropped(0),
+          _coalesced(0),
+          _blocked(0),
+          _timeouts(0) {}
+
+    ~RTVIQueue() {
+        RTVI_METRIC_ADD(QueueDepth, -static_cast<int64_t>(_queue.size()));
+    }
+
+    // Returns false if the value was dropped.
+    bool push(const T& value) { return push_value(T(value)); }
+
+    bool push(T&& value) { return push_value(std::move(value)); }
+
     std::optional<T> blocking_pop() {
         std::unique_lock<std::mutex> lock(_mutex);
         _condition.wait(lock, [this] { return _stop || !_queue.empty(); });
@@ -45,15 +189,29 @@ class RTVIQueue {
             return std::nullopt;
         }
 
-        T value = _queue.front();
-        _queue.pop();
-        return std::move(value);
+        T value = std::move(_queue.front());
+        _queue.pop_front();
+        _popped++;
+        RTVI_METRIC_ADD(QueuePopped, 1);
+        RTVI_METRIC_ADD(QueueDepth, -1);
+
+        bool low_water = crossed_low_water();
+        size_t size = _queue.size();
+        lock.unlock();
+
+        _not_full.notify_one();
+        if (low_water) {
+            _options.on_low_water(size);
+        }
+
+        return value;
     }
 
     void stop() {
         std::lock_guard<std::mutex> lock(_mutex);
         _stop = true;
         _condition.notify_all();
+        _not_full.notify_all();
     }
 
     size_t size() const {
@@ -66,12 +224,143 @@ class RTVIQueue {
         return _queue.empty();
     }
 
+    RTVIQueueStats stats() const {
+        std::lock_guard<std::mutex> lock(_mutex);
+        return RTVIQueueStats {
+                .size = _queue.size(),
+                .max_size = _max_size,
+                .pushed = _pushed,
+                .popped = _popped,
+                .dropped = _dropped,
+                .coalesced = _coalesced,
+                .blocked = _blocked,
+                .timeouts = _timeouts,
+        };
+    }
+
    private:
-    size_t _max_capacity;
+    static RTVIQueueOptions<T> make_options(size_t max_capacity) {
+        RTVIQueueOptions<T> options;
+        options.max_capacity = max_capacity;
+        return options;
+    }
+
+    bool push_value(T&& value) {
+        std::unique_lock<std::mutex> lock(_mutex);
+
+        if (full()) {
+            switch (_options.overflow_policy) {
+            case RTVIQueueOverflowPolicy::DropNewest:
+                _dropped++;
+                RTVI_METRIC_ADD(QueueDropped, 1);
+                return false;
+            case RTVIQueueOverflowPolicy::Block:
+                if (!wait_not_full(lock)) {
+                    _dropped++;
+                    RTVI_METRIC_ADD(QueueDropped, 1);
+                    return false;
+                }
+                break;
+            case RTVIQueueOverflowPolicy::Coalesce:
+                if (coalesce(value)) {
+                    return true;
+                }
+                [[fallthrough]];
+            case RTVIQueueOverflowPolicy::DropOldest:
+                _queue.pop_front();
+                _dropped++;
+                RTVI_METRIC_ADD(QueueDropped, 1);
+                RTVI_METRIC_ADD(QueueDepth, -1);
+                break;
+            }
+        }
+
+        _queue.push_back(std::move(value));
+        _pushed++;
+        RTVI_METRIC_ADD(QueuePushed, 1);
+        RTVI_METRIC_ADD(QueueDepth, 1);
+        _max_size = std::max(_max_size, _queue.size());
+
+        bool high_water = crossed_high_water();
+        size_t size = _queue.size();
+        lock.unlock();
+
+        _condition.notify_one();
+        if (high_water) {
+            _options.on_high_water(size);
+        }
+
+        return true;
+    }
+
+    bool full() const {
+        return _options.max_capacity > 0 &&
+               _queue.size() >= _options.max_capacity;
+    }
+
+    // Returns false if the queue is still full.
+    bool wait_not_full(std::unique_lock<std::mutex>& lock) {
+        _blocked++;
+
+        auto ready = [this] { return _stop || !full(); };
+        if (_options.block_timeout.count() == 0) {
+            _not_full.wait(lock, ready);
+        } else if (!_not_full.wait_for(lock, _options.block_timeout, ready)) {
+            _timeouts++;
+            return false;
+        }
+        return !full();
+    }
+
+    bool coalesce(T& value) {
+        if (!_options.coalesce_key) {
+            return false;
+        }
+
+        uint64_t key = _options.coalesce_key(value);
+        for (auto it = _queue.rbegin(); it != _queue.rend(); ++it) {
+            if (_options.coalesce_key(*it) == key) {
+                *it = std::move(value);
+                _coalesced++;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    bool crossed_high_water() {
+        if (_options.high_water_mark == 0 || _above_high_water ||
+            _queue.size() < _options.high_water_mark) {
+            return false;
+        }
+        _above_high_water = true;
+        return static_cast<bool>(_options.on_high_water);
+    }
+
+    bool crossed_low_water() {
+        if (!_above_high_water || _queue.size() > _options.low_water_mark) {
+            return false;
+        }
+        _above_high_water = false;
+        return static_cast<bool>(_options.on_low_water);
+    }
+
+   private:
+    RTVIQueueOptions<T> _options;
     std::atomic<bool> _stop;
-    std::queue<T> _queue;
+    std::deque<T> _queue;
     mutable std::mutex _mutex;
     std::condition_variable _condition;
+    std::condition_variable _not_full;
+
+    bool _above_high_water;
+    size_t _max_size;
+    uint64_t _pushed;
+    uint64_t _popped;
+    uint64_t _dropped;
+    uint64_t _coalesced;
+    uint64_t _blocked;
+    uint64_t _timeouts;
 };
 
 }  // namespace rtvi
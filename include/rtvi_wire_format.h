@@ -0,0 +1,36 @@
+//
+// Copyright (c) 2024, Daily
+//
+
+#ifndef RTVI_WIRE_FORMAT_H
+#define RTVI_WIRE_FORMAT_H
+
+#include "json.hpp"
+
+#include <cstdint>
+#include <vector>
+
+namespace rtvi {
+
+// Encodings of RTVI messages on the wire.
+enum class RTVIWireFormat {
+    Json,
+    MessagePack,
+    Cbor,
+};
+
+// Appends the encoded message to `out`, so transports can encode straight
+// into their send buffers. This doesn't allocate besides growing `out`.
+void encode_message(
+        const nlohmann::json& message,
+        RTVIWireFormat format,
+        std::vector<uint8_t>& out
+);
+
+// Throws nlohmann::json::parse_error if the data is malformed.
+nlohmann::json
+decode_message(RTVIWireFormat format, const uint8_t* data, size_t size);
+
+}  // namespace rtvi
+
+#endif
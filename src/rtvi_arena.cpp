@@ -0,0 +1,75 @@
+//
+// Copyright (c) 2024, Daily
+//
+
+#include "rtvi_arena.h"
+
+#include <algorithm>
+
+using namespace rtvi;
+
+RTVIArena::RTVIArena(size_t block_size)
+    : _block_size(std::max<size_t>(block_size, 64)),
+      _block(0),
+      _offset(0),
+      _allocations(0),
+      _allocated_bytes(0),
+      _heap_allocations(0) {}
+
+void* RTVIArena::allocate(size_t size, size_t alignment) {
+    _allocations++;
+    _allocated_bytes += size;
+
+    // Use the current block or the next ones kept from previous rounds.
+    while (_block < _blocks.size()) {
+        Block& block = _blocks[_block];
+        uintptr_t base = reinterpret_cast<uintptr_t>(block.data.get());
+        size_t offset =
+                ((base + _offset + alignment - 1) & ~(alignment - 1)) - base;
+        if (offset + size <= block.size) {
+            _offset = offset + size;
+            return block.data.get() + offset;
+        }
+        _block++;
+        _offset = 0;
+    }
+
+    // Blocks from `new[]` are aligned for any fundamental type, larger
+    // alignments need some slack.
+    size_t slack = alignment > alignof(std::max_align_t) ? alignment : 0;
+    size_t block_size = std::max(_block_size, size + slack);
+    _blocks.push_back(
+            Block {std::make_unique<char[]>(block_size), block_size}
+    );
+    _heap_allocations++;
+
+    Block& block = _blocks.back();
+    uintptr_t base = reinterpret_cast<uintptr_t>(block.data.get());
+    size_t offset = ((base + alignment - 1) & ~(alignment - 1)) - base;
+    _block = _blocks.size() - 1;
+    _offset = offset + size;
+    return block.data.get() + offset;
+}
+
+void RTVIArena::rewind(Mark mark) {
+    _block = mark.block;
+    _offset = mark.offset;
+}
+
+RTVIArenaStats RTVIArena::stats() const {
+    size_t used_bytes = _offset;
+    size_t capacity_bytes = 0;
+    for (size_t i = 0; i < _blocks.size(); ++i) {
+        capacity_bytes += _blocks[i].size;
+        if (i < _block) {
+            used_bytes += _blocks[i].size;
+        }
+    }
+    return RTVIArenaStats {
+            .allocations = _allocations,
+            .allocated_bytes = _allocated_bytes,
+            .heap_allocations = _heap_allocations,
+            .used_bytes = used_bytes,
+            .capacity_bytes = capacity_bytes,
+    };
+}
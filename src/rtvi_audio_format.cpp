@@ -0,0 +1,651 @@
+//
+// Copyright (c) 2024, Daily
+//
+
+#include "rtvi_audio_format.h"
+#include "rtvi_exceptions.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <numeric>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || \
+        defined(_M_IX86)
+#define RTVI_X86 1
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+#endif
+
+#if defined(__aarch64__) || defined(_M_ARM64)
+#define RTVI_NEON 1
+#include <arm_neon.h>
+#endif
+
+#if defined(RTVI_X86) && (defined(__GNUC__) || defined(__clang__))
+#define RTVI_TARGET_AVX2 __attribute__((target("avx2,fma")))
+#else
+#define RTVI_TARGET_AVX2
+#endif
+
+using namespace rtvi;
+
+// Taps per phase when not decimating. Decimation needs proportionally more.
+static const size_t BASE_TAPS = 16;
+// Filter cutoff relative to the Nyquist frequency of the lowest rate.
+static const double CUTOFF = 0.92;
+
+static const double PI = 3.14159265358979323846;
+
+static const float INT16_TO_FLOAT = 1.0f / 32768.0f;
+static const float FLOAT_TO_INT16 = 32767.0f;
+
+//
+// CPU detection
+//
+
+#if defined(RTVI_X86)
+static bool cpu_has_avx2() {
+#if defined(_MSC_VER)
+    int info[4];
+    __cpuid(info, 0);
+    if (info[0] < 7) {
+        return false;
+    }
+    __cpuid(info, 1);
+    bool osxsave = (info[2] & (1 << 27)) != 0;
+    bool fma = (info[2] & (1 << 12)) != 0;
+    if (!osxsave || !fma || (_xgetbv(0) & 0x6) != 0x6) {
+        return false;
+    }
+    __cpuidex(info, 7, 0);
+    return (info[1] & (1 << 5)) != 0;
+#else
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+#endif
+}
+#endif
+
+RTVISimdLevel rtvi::simd_level() {
+    static const RTVISimdLevel level = [] {
+#if defined(RTVI_X86)
+        return cpu_has_avx2() ? RTVISimdLevel::AVX2 : RTVISimdLevel::SSE2;
+#elif defined(RTVI_NEON)
+        return RTVISimdLevel::NEON;
+#else
+        return RTVISimdLevel::Scalar;
+#endif
+    }();
+    return level;
+}
+
+bool rtvi::simd_supported(RTVISimdLevel level) {
+    switch (level) {
+    case RTVISimdLevel::Scalar:
+        return true;
+    case RTVISimdLevel::SSE2:
+        return simd_level() == RTVISimdLevel::SSE2 ||
+               simd_level() == RTVISimdLevel::AVX2;
+    case RTVISimdLevel::AVX2:
+        return simd_level() == RTVISimdLevel::AVX2;
+    case RTVISimdLevel::NEON:
+        return simd_level() == RTVISimdLevel::NEON;
+    }
+    return false;
+}
+
+//
+// float -> int16
+//
+
+static void float_to_int16_scalar(const float* in, int16_t* out, size_t n) {
+    for (size_t i = 0; i < n; ++i) {
+        float value = std::min(std::max(in[i], -1.0f), 1.0f);
+        out[i] = static_cast<int16_t>(std::lrint(value * FLOAT_TO_INT16));
+    }
+}
+
+#if defined(RTVI_X86)
+static void float_to_int16_sse2(const float* in, int16_t* out, size_t n) {
+    const __m128 scale = _mm_set1_ps(FLOAT_TO_INT16);
+    const __m128 min = _mm_set1_ps(-1.0f);
+    const __m128 max = _mm_set1_ps(1.0f);
+
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m128 a = _mm_loadu_ps(in + i);
+        __m128 b = _mm_loadu_ps(in + i + 4);
+        a = _mm_mul_ps(_mm_min_ps(_mm_max_ps(a, min), max), scale);
+        b = _mm_mul_ps(_mm_min_ps(_mm_max_ps(b, min), max), scale);
+        __m128i packed =
+                _mm_packs_epi32(_mm_cvtps_epi32(a), _mm_cvtps_epi32(b));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i), packed);
+    }
+    float_to_int16_scalar(in + i, out + i, n - i);
+}
+
+RTVI_TARGET_AVX2
+static void float_to_int16_avx2(const float* in, int16_t* out, size_t n) {
+    const __m256 scale = _mm256_set1_ps(FLOAT_TO_INT16);
+    const __m256 min = _mm256_set1_ps(-1.0f);
+    const __m256 max = _mm256_set1_ps(1.0f);
+
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        __m256 a = _mm256_loadu_ps(in + i);
+        __m256 b = _mm256_loadu_ps(in + i + 8);
+        a = _mm256_mul_ps(_mm256_min_ps(_mm256_max_ps(a, min), max), scale);
+        b = _mm256_mul_ps(_mm256_min_ps(_mm256_max_ps(b, min), max), scale);
+        // Packing works per 128-bit lane, so restore the order afterwards.
+        __m256i packed = _mm256_packs_epi32(
+                _mm256_cvtps_epi32(a), _mm256_cvtps_epi32(b)
+        );
+        packed = _mm256_permute4x64_epi64(packed, 0xD8);
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + i), packed);
+    }
+    float_to_int16_scalar(in + i, out + i, n - i);
+}
+#endif
+
+#if defined(RTVI_NEON)
+static void float_to_int16_neon(const float* in, int16_t* out, size_t n) {
+    const float32x4_t scale = vdupq_n_f32(FLOAT_TO_INT16);
+    const float32x4_t min = vdupq_n_f32(-1.0f);
+    const float32x4_t max = vdupq_n_f32(1.0f);
+
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        float32x4_t a = vld1q_f32(in + i);
+        float32x4_t b = vld1q_f32(in + i + 4);
+        a = vmulq_f32(vminq_f32(vmaxq_f32(a, min), max), scale);
+        b = vmulq_f32(vminq_f32(vmaxq_f32(b, min), max), scale);
+        int16x8_t packed = vcombine_s16(
+                vqmovn_s32(vcvtnq_s32_f32(a)), vqmovn_s32(vcvtnq_s32_f32(b))
+        );
+        vst1q_s16(out + i, packed);
+    }
+    float_to_int16_scalar(in + i, out + i, n - i);
+}
+#endif
+
+void rtvi::float_to_int16(
+        const float* in,
+        int16_t* out,
+        size_t num_samples,
+        RTVISimdLevel level
+) {
+    switch (level) {
+#if defined(RTVI_X86)
+    case RTVISimdLevel::SSE2:
+        float_to_int16_sse2(in, out, num_samples);
+        break;
+    case RTVISimdLevel::AVX2:
+        float_to_int16_avx2(in, out, num_samples);
+        break;
+#endif
+#if defined(RTVI_NEON)
+    case RTVISimdLevel::NEON:
+        float_to_int16_neon(in, out, num_samples);
+        break;
+#endif
+    default:
+        float_to_int16_scalar(in, out, num_samples);
+        break;
+    }
+}
+
+void rtvi::float_to_int16(const float* in, int16_t* out, size_t num_samples) {
+    float_to_int16(in, out, num_samples, simd_level());
+}
+
+//
+// int16 -> float
+//
+
+static void int16_to_float_scalar(const int16_t* in, float* out, size_t n) {
+    for (size_t i = 0; i < n; ++i) {
+        out[i] = in[i] * INT16_TO_FLOAT;
+    }
+}
+
+#if defined(RTVI_X86)
+static void int16_to_float_sse2(const int16_t* in, float* out, size_t n) {
+    const __m128 scale = _mm_set1_ps(INT16_TO_FLOAT);
+
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + i));
+        // Sign-extend by placing each sample in the upper half and shifting.
+        __m128i lo = _mm_srai_epi32(_mm_unpacklo_epi16(v, v), 16);
+        __m128i hi = _mm_srai_epi32(_mm_unpackhi_epi16(v, v), 16);
+        _mm_storeu_ps(out + i, _mm_mul_ps(_mm_cvtepi32_ps(lo), scale));
+        _mm_storeu_ps(out + i + 4, _mm_mul_ps(_mm_cvtepi32_ps(hi), scale));
+    }
+    int16_to_float_scalar(in + i, out + i, n - i);
+}
+
+RTVI_TARGET_AVX2
+static void int16_to_float_avx2(const int16_t* in, float* out, size_t n) {
+    const __m256 scale = _mm256_set1_ps(INT16_TO_FLOAT);
+
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + i));
+        __m128i b =
+                _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + i + 8));
+        __m256 fa = _mm256_cvtepi32_ps(_mm256_cvtepi16_epi32(a));
+        __m256 fb = _mm256_cvtepi32_ps(_mm256_cvtepi16_epi32(b));
+        _mm256_storeu_ps(out + i, _mm256_mul_ps(fa, scale));
+        _mm256_storeu_ps(out + i + 8, _mm256_mul_ps(fb, scale));
+    }
+    int16_to_float_scalar(in + i, out + i, n - i);
+}
+#endif
+
+#if defined(RTVI_NEON)
+static void int16_to_float_neon(const int16_t* in, float* out, size_t n) {
+    const float32x4_t scale = vdupq_n_f32(INT16_TO_FLOAT);
+
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        int16x8_t v = vld1q_s16(in + i);
+        float32x4_t lo = vcvtq_f32_s32(vmovl_s16(vget_low_s16(v)));
+        float32x4_t hi = vcvtq_f32_s32(vmovl_s16(vget_high_s16(v)));
+        vst1q_f32(out + i, vmulq_f32(lo, scale));
+        vst1q_f32(out + i + 4, vmulq_f32(hi, scale));
+    }
+    int16_to_float_scalar(in + i, out + i, n - i);
+}
+#endif
+
+void rtvi::int16_to_float(
+        const int16_t* in,
+        float* out,
+        size_t num_samples,
+        RTVISimdLevel level
+) {
+    switch (level) {
+#if defined(RTVI_X86)
+    case RTVISimdLevel::SSE2:
+        int16_to_float_sse2(in, out, num_samples);
+        break;
+    case RTVISimdLevel::AVX2:
+        int16_to_float_avx2(in, out, num_samples);
+        break;
+#endif
+#if defined(RTVI_NEON)
+    case RTVISimdLevel::NEON:
+        int16_to_float_neon(in, out, num_samples);
+        break;
+#endif
+    default:
+        int16_to_float_scalar(in, out, num_samples);
+        break;
+    }
+}
+
+void rtvi::int16_to_float(const int16_t* in, float* out, size_t num_samples) {
+    int16_to_float(in, out, num_samples, simd_level());
+}
+
+//
+// Channel mixing
+//
+
+void rtvi::mix_channels(
+        const float* in,
+        uint32_t in_channels,
+        float* out,
+        uint32_t out_channels,
+        size_t num_frames
+) {
+    if (in_channels == out_channels) {
+        std::memmove(out, in, num_frames * in_channels * sizeof(float));
+    } else if (out_channels == 1) {
+        float scale = 1.0f / in_channels;
+        for (size_t i = 0; i < num_frames; ++i) {
+            float sum = 0;
+            for (uint32_t c = 0; c < in_channels; ++c) {
+                sum += in[i * in_channels + c];
+            }
+            out[i] = sum * scale;
+        }
+    } else {
+        for (size_t i = 0; i < num_frames; ++i) {
+            for (uint32_t c = 0; c < out_channels; ++c) {
+                out[i * out_channels + c] =
+                        in[i * in_channels + c % in_channels];
+            }
+        }
+    }
+}
+
+//
+// Dot product used by the resampler
+//
+
+static float dot_scalar(const float* a, const float* b, size_t n) {
+    float sum = 0;
+    for (size_t i = 0; i < n; ++i) {
+        sum += a[i] * b[i];
+    }
+    return sum;
+}
+
+#if defined(RTVI_X86)
+static float dot_sse2(const float* a, const float* b, size_t n) {
+    __m128 acc0 = _mm_setzero_ps();
+    __m128 acc1 = _mm_setzero_ps();
+
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        acc0 = _mm_add_ps(
+                acc0, _mm_mul_ps(_mm_loadu_ps(a + i), _mm_loadu_ps(b + i))
+        );
+        acc1 = _mm_add_ps(
+                acc1,
+                _mm_mul_ps(_mm_loadu_ps(a + i + 4), _mm_loadu_ps(b + i + 4))
+        );
+    }
+
+    __m128 acc = _mm_add_ps(acc0, acc1);
+    __m128 shuffled = _mm_shuffle_ps(acc, acc, _MM_SHUFFLE(2, 3, 0, 1));
+    acc = _mm_add_ps(acc, shuffled);
+    shuffled = _mm_movehl_ps(shuffled, acc);
+    acc = _mm_add_ss(acc, shuffled);
+
+    return _mm_cvtss_f32(acc) + dot_scalar(a + i, b + i, n - i);
+}
+
+RTVI_TARGET_AVX2
+static float dot_avx2(const float* a, const float* b, size_t n) {
+    __m256 acc0 = _mm256_setzero_ps();
+    __m256 acc1 = _mm256_setzero_ps();
+
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        acc0 = _mm256_fmadd_ps(
+                _mm256_loadu_ps(a + i), _mm256_loadu_ps(b + i), acc0
+        );
+        acc1 = _mm256_fmadd_ps(
+                _mm256_loadu_ps(a + i + 8), _mm256_loadu_ps(b + i + 8), acc1
+        );
+    }
+    for (; i + 8 <= n; i += 8) {
+        acc0 = _mm256_fmadd_ps(
+                _mm256_loadu_ps(a + i), _mm256_loadu_ps(b + i), acc0
+        );
+    }
+
+    __m256 acc = _mm256_add_ps(acc0, acc1);
+    __m128 sum = _mm_add_ps(
+            _mm256_castps256_ps128(acc), _mm256_extractf128_ps(acc, 1)
+    );
+    sum = _mm_add_ps(sum, _mm_movehl_ps(sum, sum));
+    sum = _mm_add_ss(sum, _mm_shuffle_ps(sum, sum, 0x55));
+
+    return _mm_cvtss_f32(sum) + dot_scalar(a + i, b + i, n - i);
+}
+#endif
+
+#if defined(RTVI_NEON)
+static float dot_neon(const float* a, const float* b, size_t n) {
+    float32x4_t acc0 = vdupq_n_f32(0);
+    float32x4_t acc1 = vdupq_n_f32(0);
+
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        acc0 = vmlaq_f32(acc0, vld1q_f32(a + i), vld1q_f32(b + i));
+        acc1 = vmlaq_f32(acc1, vld1q_f32(a + i + 4), vld1q_f32(b + i + 4));
+    }
+
+    return vaddvq_f32(vaddq_f32(acc0, acc1)) +
+           dot_scalar(a + i, b + i, n - i);
+}
+#endif
+
+static float
+dot(const float* a, const float* b, size_t n, RTVISimdLevel level) {
+    switch (level) {
+#if defined(RTVI_X86)
+    case RTVISimdLevel::SSE2:
+        return dot_sse2(a, b, n);
+    case RTVISimdLevel::AVX2:
+        return dot_avx2(a, b, n);
+#endif
+#if defined(RTVI_NEON)
+    case RTVISimdLevel::NEON:
+        return dot_neon(a, b, n);
+#endif
+    default:
+        return dot_scalar(a, b, n);
+    }
+}
+
+//
+// RTVIResampler
+//
+
+RTVIResampler::RTVIResampler(
+        uint32_t in_rate,
+        uint32_t out_rate,
+        uint32_t num_channels,
+        size_t max_in_frames,
+        RTVISimdLevel level
+)
+    : _num_channels(num_channels),
+      _level(simd_supported(level) ? level : RTVISimdLevel::Scalar),
+      _time(0) {
+    if (in_rate == 0 || out_rate == 0) {
+        throw RTVIException("invalid resampler sample rate");
+    }
+
+    uint32_t divisor = std::gcd(in_rate, out_rate);
+    _up = out_rate / divisor;
+    _down = in_rate / divisor;
+
+    uint32_t ratio = std::max(_up, _down);
+    _num_taps = (BASE_TAPS * ratio + _up - 1) / _up;
+
+    // Windowed sinc prototype at the upsampled rate, split into `_up` phases.
+    size_t length = _num_taps * _up;
+    double cutoff = CUTOFF * 0.5 / ratio;
+    double center = (length - 1) / 2.0;
+    std::vector<double> prototype(length);
+    double sum = 0;
+    for (size_t n = 0; n < length; ++n) {
+        double x = n - center;
+        double sinc = x == 0 ? 1.0
+                             : std::sin(2 * PI * cutoff * x) /
+                                       (2 * PI * cutoff * x);
+        double window = 0.42 - 0.5 * std::cos(2 * PI * n / (length - 1)) +
+                        0.08 * std::cos(4 * PI * n / (length - 1));
+        prototype[n] = 2 * cutoff * sinc * window;
+        sum += prototype[n];
+    }
+
+    // Each phase gets a gain of one.
+    double gain = _up / sum;
+    _taps.resize(length);
+    for (size_t phase = 0; phase < _up; ++phase) {
+        for (size_t j = 0; j < _num_taps; ++j) {
+            size_t n = phase + (_num_taps - 1 - j) * _up;
+            _taps[phase * _num_taps + j] =
+                    static_cast<float>(prototype[n] * gain);
+        }
+    }
+
+    _input.resize(num_channels);
+    for (auto& input: _input) {
+        input.resize(_num_taps - 1 + max_in_frames);
+    }
+}
+
+size_t RTVIResampler::max_out_frames(size_t in_frames) const {
+    return (in_frames * _up + _down - 1) / _down + 1;
+}
+
+size_t RTVIResampler::process(const float* in, size_t in_frames, float* out) {
+    size_t history = _num_taps - 1;
+
+    for (uint32_t c = 0; c < _num_channels; ++c) {
+        float* input = _input[c].data() + history;
+        for (size_t i = 0; i < in_frames; ++i) {
+            input[i] = in[i * _num_channels + c];
+        }
+    }
+
+    size_t out_frames = 0;
+    for (size_t index = _time / _up; index < in_frames; index = _time / _up) {
+        const float* taps = &_taps[(_time % _up) * _num_taps];
+        for (uint32_t c = 0; c < _num_channels; ++c) {
+            out[out_frames * _num_channels + c] =
+                    dot(_input[c].data() + index, taps, _num_taps, _level);
+        }
+        out_frames++;
+        _time += _down;
+    }
+    _time -= in_frames * _up;
+
+    for (auto& input: _input) {
+        std::memmove(
+                input.data(),
+                input.data() + in_frames,
+                history * sizeof(float)
+        );
+    }
+
+    return out_frames;
+}
+
+void RTVIResampler::reset() {
+    for (auto& input: _input) {
+        std::fill(input.begin(), input.end(), 0.0f);
+    }
+    _time = 0;
+}
+
+//
+// RTVIAudioConverter
+//
+
+RTVIAudioConverter::RTVIAudioConverter(
+        const RTVIAudioFormat& in_format,
+        const RTVIAudioFormat& out_format,
+        size_t max_in_frames
+)
+    : _in_format(in_format),
+      _out_format(out_format),
+      _max_in_frames(max_in_frames),
+      _resampler(
+              in_format.sample_rate,
+              out_format.sample_rate,
+              std::min(in_format.num_channels, out_format.num_channels),
+              max_in_frames
+      ),
+      _resample(in_format.sample_rate != out_format.sample_rate) {
+    uint32_t max_channels =
+            std::max(in_format.num_channels, out_format.num_channels);
+    size_t max_frames =
+            std::max(max_in_frames, _resampler.max_out_frames(max_in_frames));
+
+    _input.resize(max_in_frames * in_format.num_channels);
+    _mixed.resize(max_frames * max_channels);
+    _output.resize(max_frames * max_channels);
+}
+
+size_t RTVIAudioConverter::max_out_frames(size_t in_frames) const {
+    return _resample ? _resampler.max_out_frames(in_frames) : in_frames;
+}
+
+size_t RTVIAudioConverter::convert(
+        const int16_t* in,
+        size_t in_frames,
+        int16_t* out
+) {
+    if (_in_format == _out_format) {
+        std::memcpy(
+                out, in, in_frames * _in_format.num_channels * sizeof(int16_t)
+        );
+        return in_frames;
+    }
+
+    int16_to_float(in, _input.data(), in_frames * _in_format.num_channels);
+
+    size_t out_frames;
+    const float* output = process(_input.data(), in_frames, out_frames);
+    float_to_int16(output, out, out_frames * _out_format.num_channels);
+    return out_frames;
+}
+
+size_t
+RTVIAudioConverter::convert(const float* in, size_t in_frames, int16_t* out) {
+    size_t out_frames;
+    const float* output = process(in, in_frames, out_frames);
+    float_to_int16(output, out, out_frames * _out_format.num_channels);
+    return out_frames;
+}
+
+size_t
+RTVIAudioConverter::convert(const int16_t* in, size_t in_frames, float* out) {
+    int16_to_float(in, _input.data(), in_frames * _in_format.num_channels);
+
+    size_t out_frames;
+    const float* output = process(_input.data(), in_frames, out_frames);
+    std::memcpy(
+            out, output, out_frames * _out_format.num_channels * sizeof(float)
+    );
+    return out_frames;
+}
+
+size_t
+RTVIAudioConverter::convert(const float* in, size_t in_frames, float* out) {
+    size_t out_frames;
+    const float* output = process(in, in_frames, out_frames);
+    std::memcpy(
+            out, output, out_frames * _out_format.num_channels * sizeof(float)
+    );
+    return out_frames;
+}
+
+void RTVIAudioConverter::reset() {
+    _resampler.reset();
+}
+
+// Private
+
+const float* RTVIAudioConverter::process(
+        const float* in,
+        size_t in_frames,
+        size_t& out_frames
+) {
+    uint32_t in_channels = _in_format.num_channels;
+    uint32_t out_channels = _out_format.num_channels;
+
+    const float* data = in;
+    out_frames = in_frames;
+
+    // Downmix before resampling and upmix afterwards, so we always resample
+    // the smallest number of channels.
+    if (out_channels < in_channels) {
+        mix_channels(data, in_channels, _mixed.data(), out_channels, in_frames);
+        data = _mixed.data();
+    }
+
+    if (_resample) {
+        out_frames = _resampler.process(data, in_frames, _output.data());
+        data = _output.data();
+    }
+
+    if (out_channels > in_channels) {
+        mix_channels(
+                data, in_channels, _mixed.data(), out_channels, out_frames
+        );
+        data = _mixed.data();
+    }
+
+    return data;
+}
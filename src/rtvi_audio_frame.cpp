@@ -0,0 +1,83 @@
+//
+// Copyright (c) 2024, Daily
+//
+
+#include "rtvi_audio_frame.h"
+
+using namespace rtvi;
+
+static const uint32_t INVALID_INDEX = UINT32_MAX;
+
+static uint64_t pack_head(uint32_t tag, uint32_t index) {
+    return (static_cast<uint64_t>(tag) << 32) | index;
+}
+
+static uint32_t head_tag(uint64_t head) {
+    return static_cast<uint32_t>(head >> 32);
+}
+
+static uint32_t head_index(uint64_t head) {
+    return static_cast<uint32_t>(head);
+}
+
+RTVIAudioFramePool::RTVIAudioFramePool(
+        size_t pool_size,
+        size_t frame_capacity,
+        uint32_t num_channels
+)
+    : _pool_size(pool_size),
+      _frame_capacity(frame_capacity),
+      _num_channels(num_channels),
+      _samples(new int16_t[pool_size * frame_capacity * num_channels]),
+      _frames(new RTVIAudioFrame[pool_size]),
+      _next(new std::atomic<uint32_t>[pool_size]),
+      _head(pack_head(0, pool_size > 0 ? 0 : INVALID_INDEX)),
+      _available(pool_size) {
+    for (size_t i = 0; i < pool_size; ++i) {
+        RTVIAudioFrame& frame = _frames[i];
+        frame._pool = this;
+        frame._data = &_samples[i * frame_capacity * num_channels];
+        frame._capacity = frame_capacity;
+        frame._num_channels = num_channels;
+        frame._index = static_cast<uint32_t>(i);
+
+        uint32_t next = i + 1 < pool_size ? i + 1 : INVALID_INDEX;
+        _next[i].store(next, std::memory_order_relaxed);
+    }
+}
+
+RTVIAudioFrameRef RTVIAudioFramePool::acquire() {
+    uint64_t head = _head.load(std::memory_order_acquire);
+    while (head_index(head) != INVALID_INDEX) {
+        uint32_t index = head_index(head);
+        uint32_t next = _next[index].load(std::memory_order_relaxed);
+        uint64_t new_head = pack_head(head_tag(head) + 1, next);
+        if (_head.compare_exchange_weak(
+                    head,
+                    new_head,
+                    std::memory_order_acquire,
+                    std::memory_order_acquire
+            )) {
+            _available.fetch_sub(1, std::memory_order_relaxed);
+
+            RTVIAudioFrame* frame = &_frames[index];
+            frame->_num_frames = 0;
+            frame->_refs.store(1, std::memory_order_relaxed);
+            return RTVIAudioFrameRef::adopt(frame);
+        }
+    }
+    return RTVIAudioFrameRef();
+}
+
+void RTVIAudioFramePool::release(RTVIAudioFrame* frame) {
+    uint64_t head = _head.load(std::memory_order_relaxed);
+    uint64_t new_head;
+    do {
+        _next[frame->_index].store(head_index(head), std::memory_order_relaxed);
+        new_head = pack_head(head_tag(head) + 1, frame->_index);
+    } while (!_head.compare_exchange_weak(
+            head, new_head, std::memory_order_release, std::memory_order_relaxed
+    ));
+
+    _available.fetch_add(1, std::memory_order_relaxed);
+}
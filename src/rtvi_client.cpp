@@ -5,21 +5,211 @@
 #include "rtvi_client.h"
 #include "rtvi_exceptions.h"
 
-#include <curl/curl.h>
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <unordered_map>
 
 using namespace rtvi;
 
+// Shared by all the clients dispatching messages from the same thread with
+// the same block size.
+static RTVIArena& message_arena(size_t block_size) {
+    static thread_local std::unordered_map<size_t, RTVIArena> arenas;
+    return arenas.try_emplace(block_size, block_size).first->second;
+}
+
+// Detaches the arena from a message when the scope ends, even if a handler
+// throws.
+class MessageArenaGuard {
+   public:
+    MessageArenaGuard(RTVIInboundMessage& message, RTVIArena& arena)
+        : _message(message) {
+        _message.set_arena(&arena);
+    }
+
+    ~MessageArenaGuard() { _message.set_arena(nullptr); }
+
+    MessageArenaGuard(const MessageArenaGuard&) = delete;
+    MessageArenaGuard& operator=(const MessageArenaGuard&) = delete;
+
+   private:
+    RTVIInboundMessage& _message;
+};
+
+// Consecutive keys go to different executor threads.
+static std::atomic<uint32_t> next_executor_key(0);
+
+// Missing fields are empty.
+static std::string
+data_string(const RTVIInboundMessage& message, std::string_view key) {
+    return std::string(message.data_string(key).value_or(std::string_view()));
+}
+
 RTVIClient::RTVIClient(
         const RTVIClientOptions& options,
         std::unique_ptr<RTVITransport> transport
 )
     : _initialized(false),
       _connected(false),
+      _connecting(false),
       _options(options),
-      _transport(std::move(transport)) {}
+      _transport(std::move(transport)),
+      _executor_key(next_executor_key++),
+      _latency_timer(RTVI_INVALID_TIMER_ID),
+      _latency_generation(0),
+      _pending_actions(
+              options.max_pending_actions, options.action_table_shards
+      ),
+      _messages(0),
+      _parsed_messages(0),
+      _arena_allocations(0),
+      _arena_heap_allocations(0),
+      _audio_running(false),
+      _audio_pump_timer(RTVI_INVALID_TIMER_ID) {
+    RTVIAudioFormat options_format = {
+            .sample_rate = _options.audio.sample_rate,
+            .num_channels = _options.audio.num_channels,
+    };
+    _transport_format = _transport->audio_format().value_or(options_format);
+    _device_format = _options.audio.device_format.value_or(_transport_format);
+
+    bool convert = _device_format != _transport_format;
+    if (convert && !_options.audio.staging) {
+        throw RTVIException("audio format conversion requires audio staging");
+    }
+
+    // User audio is converted from the device to the transport format before
+    // being staged and bot audio is converted after being read from the
+    // transport, so only `read_bot_audio(float*)` needs to convert on read.
+    size_t device_frames = static_cast<size_t>(_device_format.sample_rate) *
+                           _options.audio.frame_ms / 1000;
+    _user_converter = std::make_unique<RTVIAudioConverter>(
+            _device_format, _transport_format, device_frames
+    );
+    _user_converted.resize(
+            _user_converter->max_out_frames(device_frames) *
+            _transport_format.num_channels
+    );
+    _bot_converted.resize(device_frames * _device_format.num_channels);
+
+    size_t frame_capacity = static_cast<size_t>(_transport_format.sample_rate) *
+                            _options.audio.frame_ms / 1000;
+    _user_frame_pool = std::make_unique<RTVIAudioFramePool>(
+            _options.audio.frame_pool_size,
+            frame_capacity,
+            _transport_format.num_channels
+    );
+
+    for (RTVIWireFormat format: _options.wire_formats) {
+        if (_transport->supports_wire_format(format)) {
+            _wire_format = format;
+            break;
+        }
+    }
+
+    if (_options.latency) {
+        _latency = std::make_unique<RTVILatencyTracker>(*_options.latency);
+    }
+
+    if (_options.recording) {
+        _recorder = std::make_unique<RTVISessionRecorder>(
+                *_options.recording, _transport_format
+        );
+    }
+
+    if (_options.text_aggregation && _options.callbacks) {
+        // Text waiting for a sentence end is flushed once the window expires,
+        // even if no more text arrives.
+        RTVITextAggregatorTimer timer;
+        timer.schedule = [this](auto delay, auto task) {
+            return schedule_timer(delay, std::move(task));
+        };
+        timer.cancel = [this](RTVITimerId id) { cancel_timer(id); };
+        _tts_text = std::make_unique<RTVITextAggregator>(
+                *_options.text_aggregation,
+                [this](const BotAggregatedTextData& data) {
+                    _options.callbacks->on_bot_tts_text_aggregated(data);
+                },
+                timer
+        );
+        _llm_text = std::make_unique<RTVITextAggregator>(
+                *_options.text_aggregation,
+                [this](const BotAggregatedTextData& data) {
+                    _options.callbacks->on_bot_llm_text_aggregated(data);
+                },
+                timer
+        );
+    }
+
+    if (_options.audio.staging) {
+        size_t user_samples =
+                static_cast<size_t>(_transport_format.sample_rate) *
+                _options.audio.buffer_ms / 1000 *
+                _transport_format.num_channels;
+        _user_audio = std::make_unique<RTVIAudioRingBuffer>(user_samples);
+        _user_frames = std::make_unique<RTVIRingBuffer<RTVIAudioFrame*>>(
+                _options.audio.frame_pool_size
+        );
+
+        size_t chunk_frames =
+                static_cast<size_t>(_transport_format.sample_rate) *
+                _options.audio.chunk_ms / 1000;
+        _user_chunk.resize(chunk_frames * _transport_format.num_channels);
+        _bot_chunk.resize(chunk_frames * _transport_format.num_channels);
+
+        if (convert) {
+            _bot_converter = std::make_unique<RTVIAudioConverter>(
+                    _transport_format, _device_format, chunk_frames
+            );
+            _bot_chunk_converted.resize(
+                    _bot_converter->max_out_frames(chunk_frames) *
+                    _device_format.num_channels
+            );
+        }
+
+        if (_options.audio.jitter_buffer) {
+            RTVIJitterBufferOptions jitter_options = {
+                    .sample_rate = _device_format.sample_rate,
+                    .num_channels = _device_format.num_channels,
+                    .capacity_ms = _options.audio.buffer_ms,
+                    .min_delay_ms = _options.audio.jitter_min_delay_ms,
+                    .max_delay_ms = _options.audio.jitter_max_delay_ms,
+            };
+            _bot_jitter_buffer =
+                    std::make_unique<RTVIJitterBuffer>(jitter_options);
+        } else {
+            size_t bot_samples =
+                    static_cast<size_t>(_device_format.sample_rate) *
+                    _options.audio.buffer_ms / 1000 *
+                    _device_format.num_channels;
+            _bot_audio = std::make_unique<RTVIAudioRingBuffer>(bot_samples);
+        }
+    }
+}
 
 RTVIClient::~RTVIClient() {
+    // An asynchronous connect would use the client once it completes.
+    std::unique_lock<std::mutex> lock(_connect_mutex);
+    _connect_condition.wait(lock, [this] { return !_connecting; });
+    lock.unlock();
+
     disconnect();
+    stop_latency_snapshots();
+    if (_tts_text) {
+        _tts_text->discard();
+        _llm_text->discard();
+    }
+
+    // Pending tasks and timers refer to the client, so make sure none is
+    // left.
+    if (_options.executor) {
+        _options.executor->flush(_executor_key);
+    }
+    if (_options.reactor) {
+        _options.reactor->run_sync([] {});
+    }
+    _action_timer.stop();
 }
 
 void RTVIClient::initialize() {
@@ -27,8 +217,6 @@ void RTVIClient::initialize() {
         return;
     }
 
-    curl_global_init(CURL_GLOBAL_DEFAULT);
-
     _transport->initialize();
 
     _initialized = true;
@@ -42,22 +230,99 @@ void RTVIClient::connect() {
         return;
     }
 
-    nlohmann::json response;
+    if (_options.params.endpoints.connect.empty()) {
+        connect_transport(_options.params.request);
+        return;
+    }
+
+    nlohmann::json response = connect_to_endpoint(
+            _options.params.endpoints.connect,
+            _options.params.request,
+            _options.params.headers
+    );
+
+    connect_transport(response);
+}
+
+void RTVIClient::connect_async(RTVIConnectCallback callback) {
+    if (!_initialized) {
+        throw RTVIException("client is not initialized");
+    }
+    if (_connected) {
+        callback(nullptr);
+        return;
+    }
+
+    std::unique_lock<std::mutex> lock(_connect_mutex);
+    if (_connecting) {
+        throw RTVIException("client is already connecting");
+    }
+    _connecting = true;
+    lock.unlock();
+
+    auto finish = [this, callback](std::exception_ptr error) {
+        // The client might be destroyed as soon as it's not connecting.
+        std::unique_lock<std::mutex> lock(_connect_mutex);
+        _connecting = false;
+        _connect_condition.notify_all();
+        lock.unlock();
+
+        callback(error);
+    };
+
+    if (_options.params.endpoints.connect.empty()) {
+        std::exception_ptr error;
+        try {
+            connect_transport(_options.params.request);
+        } catch (...) {
+            error = std::current_exception();
+        }
+        finish(error);
+        return;
+    }
+
+    auto on_response = [this, finish](
+                               std::exception_ptr error,
+                               RTVIHttpResponse response
+                       ) {
+        if (!error) {
+            try {
+                connect_transport(parse_endpoint_response(response));
+            } catch (...) {
+                error = std::current_exception();
+            }
+        }
+        finish(error);
+    };
+
     try {
-        response = connect_to_endpoint(
+        http_client().post_async(
                 _options.params.endpoints.connect,
-                _options.params.request,
-                _options.params.headers
-        );
-    } catch (nlohmann::json::parse_error& ex) {
-        throw RTVIException(
-                "unable to parse endpoint: " + std::string(ex.what())
+                _options.params.request.dump(),
+                endpoint_headers(_options.params.headers),
+                std::move(on_response)
         );
+    } catch (...) {
+        lock.lock();
+        _connecting = false;
+        lock.unlock();
+        throw;
     }
+}
 
-    _transport->connect(response);
+std::future<void> RTVIClient::connect_async() {
+    auto promise = std::make_shared<std::promise<void>>();
+    auto future = promise->get_future();
 
-    _connected = true;
+    connect_async([promise](std::exception_ptr error) {
+        if (error) {
+            promise->set_exception(error);
+        } else {
+            promise->set_value();
+        }
+    });
+
+    return future;
 }
 
 void RTVIClient::disconnect() {
@@ -65,9 +330,20 @@ void RTVIClient::disconnect() {
         return;
     }
 
+    _connected = false;
+
+    // Stop the audio loops before disconnecting so they don't send any more
+    // audio, but only join them afterwards since the transport might be
+    // blocked reading bot audio.
+    _audio_running = false;
+
     _transport->disconnect();
 
-    _connected = false;
+    stop_audio();
+
+    stop_latency_snapshots();
+
+    fail_all_actions(RTVIActionError::Disconnected, "client disconnected");
 }
 
 void RTVIClient::send_action(const nlohmann::json& action) {
@@ -75,23 +351,97 @@ void RTVIClient::send_action(const nlohmann::json& action) {
         return;
     }
 
-    _transport->send_message(action);
+    send_message(action);
 }
 
 void RTVIClient::send_action(
         const nlohmann::json& action,
         RTVIActionCallback callback
+) {
+    send_action(action, std::move(callback), RTVIActionOptions {});
+}
+
+void RTVIClient::send_action(
+        const nlohmann::json& action,
+        RTVIActionCallback callback,
+        const RTVIActionOptions& options
 ) {
     if (!_connected) {
+        if (options.on_error) {
+            options.on_error(RTVIActionException(
+                    RTVIActionError::Disconnected, "client is not connected"
+            ));
+        }
         return;
     }
 
-    std::unique_lock<std::mutex> lock(_actions_mutex);
-    std::string action_id = action["id"].get<std::string>();
-    _action_callbacks[action_id] = callback;
-    lock.unlock();
+    const std::string& action_id = action["id"].get_ref<const std::string&>();
+    track_action(action_id, std::move(callback), options, [&] {
+        send_message(action);
+    });
+}
+
+void RTVIClient::send_action(
+        const RTVIActionTemplate& action,
+        std::string_view arguments,
+        RTVIActionCallback callback,
+        const RTVIActionOptions& options
+) {
+    if (!_connected) {
+        if (options.on_error) {
+            options.on_error(RTVIActionException(
+                    RTVIActionError::Disconnected, "client is not connected"
+            ));
+        }
+        return;
+    }
 
-    _transport->send_message(action);
+    char action_id[RTVI_ID_LENGTH];
+    generate_random_id(action_id);
+    std::string_view id(action_id, RTVI_ID_LENGTH);
+
+    track_action(id, std::move(callback), options, [&] {
+        if (_wire_format != RTVIWireFormat::Json) {
+            send_message(action.to_json(id, arguments));
+            return;
+        }
+
+        // Reused, so writing doesn't allocate once it's grown.
+        static thread_local std::vector<uint8_t> buffer;
+        buffer.clear();
+        action.write_raw(id, arguments, buffer);
+        send_message_text(buffer);
+    });
+}
+
+std::future<nlohmann::json> RTVIClient::send_action_async(
+        const nlohmann::json& action,
+        std::chrono::milliseconds timeout
+) {
+    auto promise = std::make_shared<std::promise<nlohmann::json>>();
+    auto future = promise->get_future();
+
+    send_action(
+            action,
+            [promise](const nlohmann::json& data) { promise->set_value(data); },
+            RTVIActionOptions {
+                    .timeout = timeout,
+                    .on_error =
+                            [promise](const RTVIActionException& ex) {
+                                promise->set_exception(
+                                        std::make_exception_ptr(ex)
+                                );
+                            },
+            }
+    );
+
+    return future;
+}
+
+bool RTVIClient::cancel_action(const std::string& action_id) {
+    return fail_action(
+            action_id, RTVIActionError::Cancelled, "action cancelled"
+    );
 }
 
 int32_t RTVIClient::send_user_audio(const int16_t* frames, size_t num_frames) {
@@ -99,14 +449,182 @@ int32_t RTVIClient::send_user_audio(const int16_t* frames, size_t num_frames) {
         return 0;
     }
 
-    return _transport->send_user_audio(frames, num_frames);
+    if (_device_format != _transport_format) {
+        int32_t num_written = convert_user_audio(frames, num_frames);
+        RTVI_METRIC_ADD(UserAudioFrames, num_written);
+        return num_written;
+    }
+
+    int32_t num_written =
+            static_cast<int32_t>(write_user_audio(frames, num_frames));
+    RTVI_METRIC_ADD(UserAudioFrames, num_written);
+    return num_written;
+}
+
+int32_t RTVIClient::send_user_audio(const float* frames, size_t num_frames) {
+    if (!_connected) {
+        return 0;
+    }
+
+    int32_t num_written = convert_user_audio(frames, num_frames);
+    RTVI_METRIC_ADD(UserAudioFrames, num_written);
+    return num_written;
 }
 
 int32_t RTVIClient::read_bot_audio(int16_t* frames, size_t num_frames) {
     if (!_connected) {
         return 0;
     }
-    return _transport->read_bot_audio(frames, num_frames);
+
+    size_t num_channels = _device_format.num_channels;
+
+    int32_t num_read;
+    if (_bot_jitter_buffer) {
+        num_read = static_cast<int32_t>(
+                _bot_jitter_buffer->get(frames, num_frames)
+        );
+    } else if (!_bot_audio) {
+        num_read = _transport->read_bot_audio(frames, num_frames);
+        if (_recorder && num_read > 0) {
+            _recorder->record_audio(
+                    RTVISessionRecordType::BotAudio, frames, num_read
+            );
+        }
+    } else {
+        size_t num_samples =
+                _bot_audio->read(frames, num_frames * num_channels);
+        num_read = static_cast<int32_t>(num_samples / num_channels);
+    }
+
+    if (_latency && num_read > 0) {
+        _latency->on_bot_audio(frames, num_read * num_channels);
+    }
+
+    RTVI_METRIC_ADD(BotAudioFrames, num_read);
+    if (static_cast<size_t>(std::max(num_read, 0)) < num_frames) {
+        RTVI_METRIC_ADD(BotAudioUnderruns, 1);
+    }
+
+    return num_read;
+}
+
+int32_t RTVIClient::read_bot_audio(float* frames, size_t num_frames) {
+    if (!_connected) {
+        return 0;
+    }
+
+    size_t num_channels = _device_format.num_channels;
+    size_t chunk_frames = _bot_converted.size() / num_channels;
+
+    size_t total = 0;
+    size_t num_bot_frames = 0;
+    while (total < num_frames) {
+        size_t to_read = std::min(chunk_frames, num_frames - total);
+        int32_t num_read = read_bot_audio(_bot_converted.data(), to_read);
+
+        // The jitter buffer conceals underruns, so keep its audio.
+        if (_bot_jitter_buffer) {
+            int16_to_float(
+                    _bot_converted.data(),
+                    frames + total * num_channels,
+                    to_read * num_channels
+            );
+            total += to_read;
+            num_bot_frames += std::max(num_read, 0);
+            continue;
+        }
+
+        if (num_read <= 0) {
+            break;
+        }
+
+        int16_to_float(
+                _bot_converted.data(),
+                frames + total * num_channels,
+                num_read * num_channels
+        );
+        total += num_read;
+        num_bot_frames += num_read;
+
+        if (static_cast<size_t>(num_read) < to_read) {
+            break;
+        }
+    }
+
+    return static_cast<int32_t>(num_bot_frames);
+}
+
+RTVIAudioFrameRef RTVIClient::acquire_user_audio_frame() {
+    RTVIAudioFramePool* pool = _transport->user_audio_pool();
+    if (pool) {
+        return pool->acquire();
+    }
+    return _user_frame_pool->acquire();
+}
+
+int32_t RTVIClient::commit_user_audio_frame(RTVIAudioFrameRef frame) {
+    if (!_connected || !frame) {
+        return 0;
+    }
+
+    int32_t num_frames = static_cast<int32_t>(frame->num_frames());
+
+    if (!_user_frames) {
+        if (_recorder) {
+            _recorder->record_audio(
+                    RTVISessionRecordType::UserAudio, frame->data(), num_frames
+            );
+        }
+        _transport->send_user_audio_frame(std::move(frame));
+        RTVI_METRIC_ADD(UserAudioFrames, num_frames);
+        return num_frames;
+    }
+
+    // The queue takes over our reference. If it's full the frame is dropped.
+    RTVIAudioFrame* raw_frame = frame.detach();
+    if (_user_frames->write(&raw_frame, 1) == 0) {
+        RTVIAudioFrameRef::adopt(raw_frame);
+        return 0;
+    }
+    _user_audio_ready.notify_one();
+
+    RTVI_METRIC_ADD(UserAudioFrames, num_frames);
+    return num_frames;
+}
+
+RTVIAudioFrameRef RTVIClient::read_bot_audio_frame() {
+    if (!_connected || _options.audio.staging) {
+        return RTVIAudioFrameRef();
+    }
+
+    RTVIAudioFrameRef frame = _transport->read_bot_audio_frame();
+    if (_recorder && frame) {
+        _recorder->record_audio(
+                RTVISessionRecordType::BotAudio,
+                frame->data(),
+                frame->num_frames()
+        );
+    }
+    if (_latency && frame) {
+        _latency->on_bot_audio(
+                frame->data(), frame->num_frames() * frame->num_channels()
+        );
+    }
+
+    if (frame) {
+        RTVI_METRIC_ADD(BotAudioFrames, frame->num_frames());
+    } else {
+        RTVI_METRIC_ADD(BotAudioUnderruns, 1);
+    }
+
+    return frame;
+}
+
+std::optional<RTVIJitterBufferStats> RTVIClient::bot_audio_stats() const {
+    if (!_bot_jitter_buffer) {
+        return std::nullopt;
+    }
+    return _bot_jitter_buffer->stats();
 }
 
 void RTVIClient::register_helper(
@@ -115,150 +633,847 @@ void RTVIClient::register_helper(
 ) {
     std::unique_lock<std::mutex> lock(_helpers_mutex);
     _helpers[service] = helper;
+    rebuild_helper_index();
 }
 
 void RTVIClient::unregister_helper(const std::string& service) {
     std::unique_lock<std::mutex> lock(_helpers_mutex);
     _helpers.erase(service);
+    rebuild_helper_index();
+}
+
+RTVIMessageStats RTVIClient::message_stats() const {
+    return RTVIMessageStats {
+            .messages = _messages.load(),
+            .parsed_messages = _parsed_messages.load(),
+            .arena_allocations = _arena_allocations.load(),
+            .arena_heap_allocations = _arena_heap_allocations.load(),
+    };
+}
+
+std::optional<RTVILatencySnapshot> RTVIClient::latency_snapshot() const {
+    if (!_latency) {
+        return std::nullopt;
+    }
+    return _latency->snapshot();
+}
+
+std::optional<RTVIExecutorStats> RTVIClient::executor_stats() const {
+    if (!_options.executor) {
+        return std::nullopt;
+    }
+    return _options.executor->stats();
 }
 
 void RTVIClient::on_transport_message(const nlohmann::json& message) {
-    auto type = message["type"].get<std::string>();
-    switch (hash(type.c_str())) {
-    case hash("action-response"):
-        on_action_response(message);
-        break;
-    case hash("error-response"):
-        if (_options.callbacks) {
-            _options.callbacks->on_message_error(message);
+    if (_recorder) {
+        _recorder->record_message(
+                RTVISessionRecordType::InboundMessage, message
+        );
+    }
+    // Handled before returning unless it's queued, see `on_inbound_message()`.
+    on_inbound_message(RTVIInboundMessage::borrow(message));
+}
+
+void RTVIClient::on_transport_frame(std::string frame) {
+    if (_recorder) {
+        _recorder->record_message(
+                RTVISessionRecordType::InboundMessage,
+                RTVIWireFormat::Json,
+                reinterpret_cast<const uint8_t*>(frame.data()),
+                frame.size()
+        );
+    }
+    on_inbound_message(RTVIInboundMessage(std::move(frame)));
+}
+
+void RTVIClient::on_transport_encoded_frame(
+        RTVIWireFormat format,
+        const uint8_t* data,
+        size_t size
+) {
+    if (format == RTVIWireFormat::Json) {
+        on_transport_frame(std::string(data, data + size));
+    } else {
+        if (_recorder) {
+            _recorder->record_message(
+                    RTVISessionRecordType::InboundMessage, format, data, size
+            );
         }
-        break;
-    case hash("error"):
-        if (_options.callbacks) {
-            _options.callbacks->on_error(message);
+        on_inbound_message(
+                RTVIInboundMessage(decode_message(format, data, size))
+        );
+    }
+}
+
+// Private
+
+template<typename F>
+void RTVIClient::track_action(
+        std::string_view id,
+        RTVIActionCallback callback,
+        const RTVIActionOptions& options,
+        F send
+) {
+    std::string action_id(id);
+    PendingAction pending = {
+            .callback = std::move(callback),
+            .error_callback = options.on_error,
+            .timer = RTVI_INVALID_TIMER_ID,
+            .sent = RTVI_METRIC_NOW(),
+    };
+    if (!_pending_actions.insert(action_id, std::move(pending))) {
+        throw RTVIException("unable to track action " + action_id);
+    }
+
+    if (options.timeout.count() > 0) {
+        RTVITimerId timer =
+                schedule_timer(options.timeout, [this, action_id] {
+                    fail_action(
+                            action_id,
+                            RTVIActionError::Timeout,
+                            "action timed out"
+                    );
+                });
+        // The response might have already arrived.
+        bool updated = _pending_actions.update(
+                action_id, [timer](PendingAction& p) { p.timer = timer; }
+        );
+        if (!updated) {
+            cancel_timer(timer);
         }
-        break;
-    case hash("bot-ready"):
-        if (_options.callbacks) {
-            _options.callbacks->on_bot_ready();
+    }
+
+    try {
+        send();
+    } catch (...) {
+        auto removed = _pending_actions.remove(action_id);
+        if (removed) {
+            cancel_timer(removed->timer);
         }
-        break;
-    case hash("bot-started-speaking"):
-        if (_options.callbacks) {
-            _options.callbacks->on_bot_started_speaking();
+        throw;
+    }
+
+    RTVI_METRIC_ADD(ActionsSent, 1);
+}
+
+void RTVIClient::send_message(const nlohmann::json& message) {
+    RTVI_METRIC_ADD(MessagesSent, 1);
+
+    if (!_wire_format) {
+        if (_recorder) {
+            _recorder->record_message(
+                    RTVISessionRecordType::OutboundMessage, message
+            );
         }
-        break;
-    case hash("bot-stopped-speaking"):
-        if (_options.callbacks) {
-            _options.callbacks->on_bot_stopped_speaking();
+        _transport->send_message(message);
+        return;
+    }
+
+    // Reused, so encoding doesn't allocate once it's grown.
+    static thread_local std::vector<uint8_t> buffer;
+    buffer.clear();
+    encode_message(message, *_wire_format, buffer);
+    if (_recorder) {
+        _recorder->record_message(
+                RTVISessionRecordType::OutboundMessage,
+                *_wire_format,
+                buffer.data(),
+                buffer.size()
+        );
+    }
+    _transport->send_encoded_message(
+            *_wire_format, buffer.data(), buffer.size()
+    );
+}
+
+// Only used if JSON is the negotiated wire format.
+void RTVIClient::send_message_text(const std::vector<uint8_t>& text) {
+    RTVI_METRIC_ADD(MessagesSent, 1);
+    if (_recorder) {
+        _recorder->record_message(
+                RTVISessionRecordType::OutboundMessage,
+                RTVIWireFormat::Json,
+                text.data(),
+                text.size()
+        );
+    }
+    _transport->send_encoded_message(
+            RTVIWireFormat::Json, text.data(), text.size()
+    );
+}
+
+void RTVIClient::on_inbound_message(RTVIInboundMessage message) {
+    // Timestamps are taken on arrival, so queueing isn't counted.
+    if (_latency) {
+        _latency->on_message(message);
+    }
+
+    RTVI_METRIC_MESSAGE(message.type());
+    auto received = RTVI_METRIC_NOW();
+
+    if (_options.reactor) {
+        message.detach();
+        _options.reactor->post(
+                [this, message = std::move(message), received]() mutable {
+                    dispatch_message(message, received);
+                },
+                &_reactor_load
+        );
+        return;
+    }
+
+    if (!_options.executor) {
+        dispatch_message(message, received);
+        return;
+    }
+
+    // Every message goes to the same worker so they are handled in order.
+    std::string_view type = message.type();
+    RTVIExecutorTaskKind kind = executor_task_kind(type);
+    uint32_t coalesce_key = hash_fnv1a(type);
+    message.detach();
+    _options.executor->submit(
+            _executor_key,
+            [this, message = std::move(message), received]() mutable {
+                dispatch_message(message, received);
+            },
+            kind,
+            coalesce_key
+    );
+}
+
+RTVIExecutorTaskKind
+RTVIClient::executor_task_kind(std::string_view type) const {
+    // Someone is waiting for these, or they delimit what comes in between.
+    static constexpr std::string_view REQUIRED[] = {
+            "action-response",
+            "bot-llm-started",
+            "bot-llm-stopped",
+            "bot-ready",
+            "bot-started-speaking",
+            "bot-stopped-speaking",
+            "bot-tts-started",
+            "bot-tts-stopped",
+            "error",
+            "error-response",
+            "llm-function-call",
+            "user-started-speaking",
+            "user-stopped-speaking",
+    };
+
+    for (std::string_view required: REQUIRED) {
+        if (type == required) {
+            return RTVIExecutorTaskKind::Required;
         }
-        break;
-    // `tts-text`: RTVI 0.1.0 backwards compatibilty
-    case hash("tts-text"):
-    case hash("bot-transcription"): {
-        if (_options.callbacks) {
-            auto bot_data = BotTranscriptData {
-                    .text = message["data"]["text"].get<std::string>()
-            };
-            _options.callbacks->on_bot_transcript(bot_data);
+    }
+    for (const std::string& coalescable: _options.coalescable_messages) {
+        if (type == coalescable) {
+            return RTVIExecutorTaskKind::Coalescable;
         }
-        break;
     }
-    case hash("bot-tts-started"): {
-        if (_options.callbacks) {
-            _options.callbacks->on_bot_tts_started();
+    return RTVIExecutorTaskKind::Droppable;
+}
+
+void RTVIClient::dispatch_message(
+        RTVIInboundMessage& message,
+        std::chrono::steady_clock::time_point received
+) {
+    RTVI_METRIC_RECORD_SINCE(MessageDispatch, received);
+    auto start = RTVI_METRIC_NOW();
+
+    _messages++;
+
+    if (_options.message_arena_block_size == 0) {
+        handle_message(message);
+    } else {
+        RTVIArena& arena = message_arena(_options.message_arena_block_size);
+        RTVIArenaStats before = arena.stats();
+        {
+            RTVIArenaScope scope(arena);
+            MessageArenaGuard guard(message, arena);
+            handle_message(message);
         }
-        break;
+        RTVIArenaStats after = arena.stats();
+        _arena_allocations += after.allocations - before.allocations;
+        _arena_heap_allocations +=
+                after.heap_allocations - before.heap_allocations;
     }
-    case hash("bot-tts-stopped"): {
-        if (_options.callbacks) {
-            _options.callbacks->on_bot_tts_stopped();
+
+    if (message.has_json()) {
+        _parsed_messages++;
+    }
+
+    RTVI_METRIC_RECORD_SINCE(MessageCallback, start);
+}
+
+// Only messages handled by helpers or passed to `on_generic_message()` are
+// fully parsed.
+void RTVIClient::handle_message(const RTVIInboundMessage& message) {
+    std::string_view type = message.type();
+
+    MessageHandler handler = find_message_handler(type);
+    if (handler) {
+        (this->*handler)(message);
+        return;
+    }
+
+    // The snapshot keeps the helpers alive even if they are unregistered
+    // while handling the message.
+    auto helper_index = _helper_index.load();
+    if (helper_index) {
+        auto it = helper_index->helpers.find(type);
+        if (it != helper_index->helpers.end()) {
+            for (const auto& helper: it->second) {
+                helper->handle_message(_transport.get(), message.json());
+            }
+            return;
         }
-        break;
     }
-    case hash("bot-tts-text"): {
-        if (_options.callbacks) {
-            auto bot_data = BotTTSTextData {
-                    .text = message["data"]["text"].get<std::string>()
-            };
-            _options.callbacks->on_bot_tts_text(bot_data);
+
+    if (_options.callbacks) {
+        _options.callbacks->on_generic_message(message.json());
+    }
+}
+
+namespace {
+
+struct MessageHandlerEntry {
+    uint32_t hash;
+    std::string_view type;
+    void (RTVIClient::*handler)(const RTVIInboundMessage&);
+};
+
+constexpr MessageHandlerEntry message_handler(
+        std::string_view type,
+        void (RTVIClient::*handler)(const RTVIInboundMessage&)
+) {
+    return MessageHandlerEntry {hash_fnv1a(type), type, handler};
+}
+
+template<size_t N>
+constexpr std::array<MessageHandlerEntry, N>
+sort_by_hash(std::array<MessageHandlerEntry, N> entries) {
+    for (size_t i = 1; i < N; ++i) {
+        for (size_t j = i; j > 0 && entries[j].hash < entries[j - 1].hash;
+             --j) {
+            MessageHandlerEntry entry = entries[j];
+            entries[j] = entries[j - 1];
+            entries[j - 1] = entry;
         }
-        break;
     }
-    case hash("bot-llm-started"): {
-        if (_options.callbacks) {
-            _options.callbacks->on_bot_llm_started();
+    return entries;
+}
+
+template<size_t N>
+constexpr bool
+has_unique_hashes(const std::array<MessageHandlerEntry, N>& entries) {
+    for (size_t i = 1; i < N; ++i) {
+        if (entries[i].hash == entries[i - 1].hash) {
+            return false;
         }
-        break;
     }
-    case hash("bot-llm-stopped"): {
-        if (_options.callbacks) {
-            _options.callbacks->on_bot_llm_stopped();
+    return true;
+}
+
+}  // namespace
+
+// Built-in messages are dispatched through a table sorted by hash at compile
+// time, so a lookup is a binary search plus a single string comparison.
+RTVIClient::MessageHandler
+RTVIClient::find_message_handler(std::string_view type) {
+    static constexpr auto HANDLERS = sort_by_hash(std::array {
+            message_handler("action-response", &RTVIClient::on_action_response),
+            message_handler("error-response", &RTVIClient::on_error_response),
+            message_handler("error", &RTVIClient::on_error),
+            message_handler("bot-ready", &RTVIClient::on_bot_ready),
+            message_handler(
+                    "bot-started-speaking", &RTVIClient::on_bot_started_speaking
+            ),
+            message_handler(
+                    "bot-stopped-speaking", &RTVIClient::on_bot_stopped_speaking
+            ),
+            // `tts-text`: RTVI 0.1.0 backwards compatibilty
+            message_handler("tts-text", &RTVIClient::on_bot_transcript),
+            message_handler(
+                    "bot-transcription", &RTVIClient::on_bot_transcript
+            ),
+            message_handler("bot-tts-started", &RTVIClient::on_bot_tts_started),
+            message_handler("bot-tts-stopped", &RTVIClient::on_bot_tts_stopped),
+            message_handler("bot-tts-text", &RTVIClient::on_bot_tts_text),
+            message_handler("bot-llm-started", &RTVIClient::on_bot_llm_started),
+            message_handler("bot-llm-stopped", &RTVIClient::on_bot_llm_stopped),
+            message_handler("bot-llm-text", &RTVIClient::on_bot_llm_text),
+            message_handler(
+                    "user-started-speaking",
+                    &RTVIClient::on_user_started_speaking
+            ),
+            message_handler(
+                    "user-stopped-speaking",
+                    &RTVIClient::on_user_stopped_speaking
+            ),
+            message_handler(
+                    "user-transcription", &RTVIClient::on_user_transcript
+            ),
+    });
+
+    static_assert(
+            has_unique_hashes(HANDLERS),
+            "message type hash collision, use a different hash function"
+    );
+
+    uint32_t type_hash = hash_fnv1a(type);
+    auto it = std::lower_bound(
+            HANDLERS.begin(),
+            HANDLERS.end(),
+            type_hash,
+            [](const MessageHandlerEntry& entry, uint32_t hash) {
+                return entry.hash < hash;
+            }
+    );
+    if (it != HANDLERS.end() && it->hash == type_hash && it->type == type) {
+        return it->handler;
+    }
+
+    return nullptr;
+}
+
+// Must be called with `_helpers_mutex` held.
+void RTVIClient::rebuild_helper_index() {
+    auto index = std::make_shared<HelperIndex>();
+    for (const auto& [service, helper]: _helpers) {
+        for (const auto& type: helper->supported_messages()) {
+            // Keys are views of the strings owned by the index.
+            auto it = index->helpers.find(type);
+            if (it == index->helpers.end()) {
+                index->types.push_back(type);
+                index->helpers[index->types.back()].push_back(helper);
+            } else {
+                it->second.push_back(helper);
+            }
         }
-        break;
     }
-    case hash("bot-llm-text"): {
-        if (_options.callbacks) {
-            auto bot_data = BotLLMTextData {
-                    .text = message["data"]["text"].get<std::string>()
-            };
-            _options.callbacks->on_bot_llm_text(bot_data);
+    _helper_index.store(std::move(index));
+}
+
+void RTVIClient::on_error_response(const RTVIInboundMessage& message) {
+    if (_options.callbacks) {
+        _options.callbacks->on_message_error(message.json());
+    }
+}
+
+void RTVIClient::on_error(const RTVIInboundMessage& message) {
+    if (_options.callbacks) {
+        _options.callbacks->on_error(message.json());
+    }
+}
+
+void RTVIClient::on_bot_ready(const RTVIInboundMessage&) {
+    if (_options.callbacks) {
+        _options.callbacks->on_bot_ready();
+    }
+}
+
+void RTVIClient::on_bot_started_speaking(const RTVIInboundMessage&) {
+    if (_options.callbacks) {
+        _options.callbacks->on_bot_started_speaking();
+    }
+}
+
+void RTVIClient::on_bot_stopped_speaking(const RTVIInboundMessage&) {
+    if (_options.callbacks) {
+        _options.callbacks->on_bot_stopped_speaking();
+    }
+}
+
+void RTVIClient::on_bot_transcript(const RTVIInboundMessage& message) {
+    if (_options.callbacks) {
+        auto bot_data = BotTranscriptData {
+                .text = data_string(message, "text")
+        };
+        _options.callbacks->on_bot_transcript(bot_data);
+    }
+}
+
+void RTVIClient::on_bot_tts_started(const RTVIInboundMessage&) {
+    if (_tts_text) {
+        _tts_text->start();
+    }
+    if (_options.callbacks) {
+        _options.callbacks->on_bot_tts_started();
+    }
+}
+
+void RTVIClient::on_bot_tts_stopped(const RTVIInboundMessage&) {
+    if (_tts_text) {
+        _tts_text->stop();
+    }
+    if (_options.callbacks) {
+        _options.callbacks->on_bot_tts_stopped();
+    }
+}
+
+void RTVIClient::on_bot_tts_text(const RTVIInboundMessage& message) {
+    if (_tts_text) {
+        _tts_text->append(message.data_string("text").value_or(""));
+        return;
+    }
+    if (_options.callbacks) {
+        auto bot_data = BotTTSTextData {
+                .text = data_string(message, "text")
+        };
+        _options.callbacks->on_bot_tts_text(bot_data);
+    }
+}
+
+void RTVIClient::on_bot_llm_started(const RTVIInboundMessage&) {
+    if (_llm_text) {
+        _llm_text->start();
+    }
+    if (_options.callbacks) {
+        _options.callbacks->on_bot_llm_started();
+    }
+}
+
+void RTVIClient::on_bot_llm_stopped(const RTVIInboundMessage&) {
+    if (_llm_text) {
+        _llm_text->stop();
+    }
+    if (_options.callbacks) {
+        _options.callbacks->on_bot_llm_stopped();
+    }
+}
+
+void RTVIClient::on_bot_llm_text(const RTVIInboundMessage& message) {
+    if (_llm_text) {
+        _llm_text->append(message.data_string("text").value_or(""));
+        return;
+    }
+    if (_options.callbacks) {
+        auto bot_data = BotLLMTextData {
+                .text = data_string(message, "text")
+        };
+        _options.callbacks->on_bot_llm_text(bot_data);
+    }
+}
+
+void RTVIClient::on_user_started_speaking(const RTVIInboundMessage&) {
+    if (_options.callbacks) {
+        _options.callbacks->on_user_started_speaking();
+    }
+}
+
+void RTVIClient::on_user_stopped_speaking(const RTVIInboundMessage&) {
+    if (_options.callbacks) {
+        _options.callbacks->on_user_stopped_speaking();
+    }
+}
+
+void RTVIClient::on_user_transcript(const RTVIInboundMessage& message) {
+    if (_options.callbacks) {
+        auto bot_data = UserTranscriptData {
+                .text = data_string(message, "text"),
+                .final = message.data_bool("final").value_or(false),
+                .timestamp = data_string(message, "timestamp"),
+                .user_id = data_string(message, "user_id")
+        };
+        _options.callbacks->on_user_transcript(bot_data);
+    }
+}
+
+void RTVIClient::start_audio() {
+    if (!_user_audio || _audio_running) {
+        return;
+    }
+
+    _user_audio->clear();
+    release_user_frames();
+    if (_bot_jitter_buffer) {
+        _bot_jitter_buffer->reset();
+    } else {
+        _bot_audio->clear();
+    }
+    if (_bot_converter) {
+        _bot_converter->reset();
+    }
+
+    _audio_running = true;
+    if (use_reactor_audio()) {
+        _options.reactor->post(
+                [this] { reactor_audio_loop(); }, &_reactor_load
+        );
+        return;
+    }
+    _user_audio_thread = std::thread(&RTVIClient::user_audio_loop, this);
+    _bot_audio_thread = std::thread(&RTVIClient::bot_audio_loop, this);
+}
+
+void RTVIClient::stop_audio() {
+    _audio_running = false;
+    _user_audio_ready.notify_all();
+
+    // Once this runs the reactor loop won't be scheduled again.
+    if (use_reactor_audio()) {
+        _options.reactor->run_sync([this] {
+            _options.reactor->cancel(_audio_pump_timer);
+        });
+    }
+
+    if (_user_audio_thread.joinable()) {
+        _user_audio_thread.join();
+    }
+    if (_bot_audio_thread.joinable()) {
+        _bot_audio_thread.join();
+    }
+
+    if (_user_frames) {
+        release_user_frames();
+    }
+}
+
+void RTVIClient::release_user_frames() {
+    RTVIAudioFrame* raw_frame;
+    while (_user_frames->read(&raw_frame, 1) > 0) {
+        RTVIAudioFrameRef::adopt(raw_frame);
+    }
+}
+
+template<typename T>
+int32_t RTVIClient::convert_user_audio(const T* frames, size_t num_frames) {
+    size_t in_channels = _device_format.num_channels;
+    size_t max_in_frames = _user_converter->max_in_frames();
+
+    // Convert in blocks so the converter never needs to allocate.
+    size_t consumed = 0;
+    while (consumed < num_frames) {
+        size_t in_frames = std::min(max_in_frames, num_frames - consumed);
+        size_t out_frames = _user_converter->convert(
+                frames + consumed * in_channels,
+                in_frames,
+                _user_converted.data()
+        );
+        consumed += in_frames;
+
+        if (write_user_audio(_user_converted.data(), out_frames) < out_frames) {
+            break;
         }
-        break;
     }
-    case hash("user-started-speaking"):
-        if (_options.callbacks) {
-            _options.callbacks->on_user_started_speaking();
+
+    return static_cast<int32_t>(consumed);
+}
+
+size_t RTVIClient::write_user_audio(const int16_t* frames, size_t num_frames) {
+    if (!_user_audio) {
+        if (_recorder) {
+            _recorder->record_audio(
+                    RTVISessionRecordType::UserAudio, frames, num_frames
+            );
         }
-        break;
-    case hash("user-stopped-speaking"):
-        if (_options.callbacks) {
-            _options.callbacks->on_user_stopped_speaking();
+        int32_t num_sent = _transport->send_user_audio(frames, num_frames);
+        return num_sent > 0 ? num_sent : 0;
+    }
+
+    // Only write whole frames, the rest is dropped if the buffer is full.
+    size_t num_channels = _transport_format.num_channels;
+    size_t writable = _user_audio->free_space() / num_channels;
+    size_t to_write = std::min(num_frames, writable);
+    _user_audio->write(frames, to_write * num_channels);
+    _user_audio_ready.notify_one();
+
+    return to_write;
+}
+
+bool RTVIClient::use_reactor_audio() const {
+    return _options.reactor && _transport->nonblocking_audio();
+}
+
+bool RTVIClient::pump_user_audio() {
+    size_t num_channels = _transport_format.num_channels;
+    bool sent = false;
+
+    // Committed frames are handed to the transport without copying.
+    RTVIAudioFrame* raw_frame;
+    while (_user_frames->read(&raw_frame, 1) > 0) {
+        if (_recorder) {
+            _recorder->record_audio(
+                    RTVISessionRecordType::UserAudio,
+                    raw_frame->data(),
+                    raw_frame->num_frames()
+            );
         }
-        break;
-    case hash("user-transcription"): {
-        if (_options.callbacks) {
-            auto bot_data = UserTranscriptData {
-                    .text = message["data"]["text"].get<std::string>(),
-                    .final = message["data"]["final"].get<bool>(),
-                    .timestamp =
-                            message["data"]["timestamp"].get<std::string>(),
-                    .user_id = message["data"]["user_id"].get<std::string>()
-            };
-            _options.callbacks->on_user_transcript(bot_data);
-        }
-        break;
-    }
-    default: {
-        std::unique_lock<std::mutex> lock(_helpers_mutex);
-        bool handled = false;
-        for (const auto& [service, helper]: _helpers) {
-            auto supported = helper->supported_messages();
-            if (std::find(supported.begin(), supported.end(), type) !=
-                supported.end()) {
-                helper->handle_message(_transport.get(), message);
-                handled = true;
-            }
+        _transport->send_user_audio_frame(
+                RTVIAudioFrameRef::adopt(raw_frame)
+        );
+        sent = true;
+    }
+
+    // Writers only write whole frames so we always read whole frames.
+    size_t num_samples =
+            _user_audio->read(_user_chunk.data(), _user_chunk.size());
+    if (num_samples > 0) {
+        if (_recorder) {
+            _recorder->record_audio(
+                    RTVISessionRecordType::UserAudio,
+                    _user_chunk.data(),
+                    num_samples / num_channels
+            );
         }
+        _transport->send_user_audio(
+                _user_chunk.data(), num_samples / num_channels
+        );
+        sent = true;
+    }
+
+    return sent;
+}
+
+bool RTVIClient::pump_bot_audio() {
+    size_t chunk_frames = _bot_chunk.size() / _transport_format.num_channels;
+
+    int32_t num_frames =
+            _transport->read_bot_audio(_bot_chunk.data(), chunk_frames);
+    if (num_frames <= 0) {
+        return false;
+    }
 
-        if (!handled && _options.callbacks) {
-            _options.callbacks->on_generic_message(message);
+    if (_recorder) {
+        _recorder->record_audio(
+                RTVISessionRecordType::BotAudio, _bot_chunk.data(), num_frames
+        );
+    }
+
+    const int16_t* data = _bot_chunk.data();
+    if (_bot_converter) {
+        num_frames = static_cast<int32_t>(_bot_converter->convert(
+                _bot_chunk.data(), num_frames, _bot_chunk_converted.data()
+        ));
+        data = _bot_chunk_converted.data();
+    }
+
+    // If the application is not reading fast enough the most recent audio is
+    // dropped, but only whole frames are written.
+    if (_bot_jitter_buffer) {
+        _bot_jitter_buffer->put(
+                data, num_frames, _transport->bot_audio_arrival_time()
+        );
+    } else {
+        size_t num_channels = _device_format.num_channels;
+        size_t to_write = std::min(
+                static_cast<size_t>(num_frames),
+                _bot_audio->free_space() / num_channels
+        );
+        _bot_audio->write(data, to_write * num_channels);
+    }
+
+    return true;
+}
+
+bool RTVIClient::user_audio_pending() const {
+    return _user_audio->size() > 0 || _user_frames->size() > 0;
+}
+
+void RTVIClient::user_audio_loop() {
+    while (_audio_running) {
+        if (pump_user_audio()) {
+            continue;
+        }
+
+        // Sleep until audio is staged.
+        RTVIEventCount::Key key = _user_audio_ready.prepare_wait();
+        if (!_audio_running || user_audio_pending()) {
+            _user_audio_ready.cancel_wait();
+            continue;
         }
+        _user_audio_ready.wait(key);
     }
+}
+
+// The transport has to be polled for bot audio.
+void RTVIClient::bot_audio_loop() {
+    auto idle = std::chrono::milliseconds(_options.audio.chunk_ms) / 2;
+
+    while (_audio_running) {
+        if (!pump_bot_audio()) {
+            std::this_thread::sleep_for(idle);
+        }
     }
 }
 
-// Private
+void RTVIClient::reactor_audio_loop() {
+    // Bounded, so a session with a backlog doesn't starve the other sessions
+    // of the reactor.
+    static const int MAX_CHUNKS = 4;
+
+    if (!_audio_running) {
+        return;
+    }
+
+    for (int i = 0; i < MAX_CHUNKS && pump_user_audio(); ++i) {
+    }
+    for (int i = 0; i < MAX_CHUNKS && pump_bot_audio(); ++i) {
+    }
+
+    auto idle = std::chrono::milliseconds(_options.audio.chunk_ms) / 2;
+    _audio_pump_timer = _options.reactor->schedule(
+            idle, [this] { reactor_audio_loop(); }, &_reactor_load
+    );
+}
 
-static size_t write_response_callback(
-        void* contents,
-        size_t size,
-        size_t nmemb,
-        std::string* output
+RTVITimerId RTVIClient::schedule_timer(
+        std::chrono::milliseconds delay,
+        std::function<void()> task
 ) {
-    size_t totalSize = size * nmemb;
-    output->append(static_cast<char*>(contents), totalSize);
-    return totalSize;
+    if (_options.reactor) {
+        return _options.reactor->schedule(
+                delay, std::move(task), &_reactor_load
+        );
+    }
+    return _action_timer.schedule(delay, std::move(task));
+}
+
+void RTVIClient::cancel_timer(RTVITimerId id) {
+    if (_options.reactor) {
+        _options.reactor->cancel(id);
+    } else {
+        _action_timer.cancel(id);
+    }
+}
+
+void RTVIClient::schedule_latency_snapshot(uint64_t generation) {
+    auto task = [this, generation] {
+        {
+            std::lock_guard<std::mutex> lock(_latency_mutex);
+            if (generation != _latency_generation) {
+                return;
+            }
+        }
+        RTVILatencySnapshot snapshot =
+                _latency->snapshot(_options.latency->reset_on_snapshot);
+        if (_options.callbacks) {
+            _options.callbacks->on_latency_snapshot(snapshot);
+        }
+        schedule_latency_snapshot(generation);
+    };
+
+    // Checked under the lock so a snapshot running while the client
+    // disconnects doesn't schedule another one.
+    std::lock_guard<std::mutex> lock(_latency_mutex);
+    if (generation == _latency_generation) {
+        _latency_timer =
+                schedule_timer(_options.latency->snapshot_interval, task);
+    }
+}
+
+void RTVIClient::stop_latency_snapshots() {
+    std::unique_lock<std::mutex> lock(_latency_mutex);
+    _latency_generation++;
+    RTVITimerId timer = _latency_timer;
+    _latency_timer = RTVI_INVALID_TIMER_ID;
+    lock.unlock();
+
+    if (timer != RTVI_INVALID_TIMER_ID) {
+        cancel_timer(timer);
+    }
 }
 
 nlohmann::json RTVIClient::connect_to_endpoint(
@@ -266,67 +1481,106 @@ nlohmann::json RTVIClient::connect_to_endpoint(
         const nlohmann::json& body,
         const std::vector<std::string>& headers
 ) const {
-    std::string response_body;
+    RTVIHttpResponse response =
+            http_client().post(url, body.dump(), endpoint_headers(headers));
 
-    CURL* curl = curl_easy_init();
-    if (curl == nullptr) {
-        throw RTVIException("unable to initialize CURL");
-    }
+    return parse_endpoint_response(response);
+}
 
-    struct curl_slist* curl_headers = nullptr;
+nlohmann::json
+RTVIClient::parse_endpoint_response(const RTVIHttpResponse& response) {
+    if (response.status != 200) {
+        throw RTVIException(
+                "unable to perform POST request (status: " +
+                std::to_string(response.status) + "): " + response.body
+        );
+    }
 
-    for (const std::string& header: headers) {
-        curl_headers = curl_slist_append(curl_headers, header.c_str());
+    try {
+        return nlohmann::json::parse(response.body);
+    } catch (nlohmann::json::parse_error& ex) {
+        throw RTVIException(
+                "unable to parse endpoint: " + std::string(ex.what())
+        );
     }
-    curl_headers =
-            curl_slist_append(curl_headers, "Content-Type: application/json");
-    curl_easy_setopt(curl, CURLOPT_HTTPHEADER, curl_headers);
+}
 
-    curl_easy_setopt(curl, CURLOPT_URL, url.c_str());
+std::vector<std::string>
+RTVIClient::endpoint_headers(const std::vector<std::string>& headers) {
+    std::vector<std::string> result = headers;
+    result.push_back("Content-Type: application/json");
+    return result;
+}
 
-    std::string body_json = body.dump();
-    curl_easy_setopt(curl, CURLOPT_POST, 1L);
-    curl_easy_setopt(curl, CURLOPT_POSTFIELDS, body_json.c_str());
+RTVIHttpClient& RTVIClient::http_client() const {
+    return _options.http_client ? *_options.http_client
+                                : RTVIHttpClient::shared();
+}
 
-    curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, write_response_callback);
-    curl_easy_setopt(curl, CURLOPT_WRITEDATA, &response_body);
+void RTVIClient::connect_transport(const nlohmann::json& info) {
+    _transport->connect(info);
 
-    CURLcode res = curl_easy_perform(curl);
+    start_audio();
 
-    // Check for errors
-    if (res != CURLE_OK) {
-        throw RTVIException(
-                "unable to perform POST request: " +
-                std::string(curl_easy_strerror(res))
-        );
+    _connected = true;
+
+    if (_latency && _options.latency->snapshot_interval.count() > 0) {
+        std::unique_lock<std::mutex> lock(_latency_mutex);
+        uint64_t generation = _latency_generation;
+        lock.unlock();
+        schedule_latency_snapshot(generation);
     }
+}
 
-    long status;
-    curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &status);
+void RTVIClient::on_action_response(const RTVIInboundMessage& message) {
+    auto pending = _pending_actions.remove(message.id());
+    if (!pending) {
+        return;
+    }
+    cancel_timer(pending->timer);
 
-    if (status != 200) {
-        throw RTVIException(
-                "unable to perform POST request (status: " +
-                std::to_string(status) + "): " + response_body
-        );
+    RTVI_METRIC_ADD(ActionsCompleted, 1);
+    RTVI_METRIC_RECORD_SINCE(ActionRoundTrip, pending->sent);
+
+    if (pending->callback) {
+        pending->callback(message.data());
+    }
+}
+
+bool RTVIClient::fail_action(
+        const std::string& action_id,
+        RTVIActionError error,
+        const std::string& reason
+) {
+    auto pending = _pending_actions.remove(action_id);
+    if (!pending) {
+        return false;
     }
+    cancel_timer(pending->timer);
 
-    curl_easy_cleanup(curl);
+    RTVI_METRIC_ADD(ActionsFailed, 1);
 
-    return nlohmann::json::parse(response_body);
+    if (pending->error_callback) {
+        pending->error_callback(RTVIActionException(error, reason));
+    }
+    return true;
 }
 
-void RTVIClient::on_action_response(const nlohmann::json& response) {
-    std::unique_lock<std::mutex> lock(_actions_mutex);
-    std::string action_id = response["id"].get<std::string>();
-    RTVIActionCallback action_callback = nullptr;
-    if (_action_callbacks.find(action_id) != _action_callbacks.end()) {
-        action_callback = _action_callbacks[action_id];
-        _action_callbacks.erase(action_id);
+void RTVIClient::fail_all_actions(
+        RTVIActionError error,
+        const std::string& reason
+) {
+    std::vector<PendingAction> pending_actions;
+    _pending_actions.remove_all(pending_actions);
+    for (const auto& pending: pending_actions) {
+        cancel_timer(pending.timer);
     }
-    lock.unlock();
 
-    if (action_callback) {
-        action_callback(response["data"]);
+    RTVI_METRIC_ADD(ActionsFailed, pending_actions.size());
+
+    for (const auto& pending: pending_actions) {
+        if (pending.error_callback) {
+            pending.error_callback(RTVIActionException(error, reason));
+        }
     }
 }
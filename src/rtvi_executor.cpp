@@ -0,0 +1,238 @@
+//
+// Copyright (c) 2024, Daily
+//
+
+#include "rtvi_executor.h"
+
+#include <algorithm>
+#include <future>
+
+using namespace rtvi;
+
+static uint64_t elapsed_us(
+        std::chrono::steady_clock::time_point from,
+        std::chrono::steady_clock::time_point to
+) {
+    return std::chrono::duration_cast<std::chrono::microseconds>(to - from)
+            .count();
+}
+
+static void update_max(std::atomic<uint64_t>& max, uint64_t value) {
+    uint64_t current = max.load(std::memory_order_relaxed);
+    while (value > current &&
+           !max.compare_exchange_weak(
+                   current, value, std::memory_order_relaxed
+           )) {
+    }
+}
+
+RTVIExecutor::RTVIExecutor(const RTVIExecutorOptions& options)
+    : _options(options),
+      _state(State::Running),
+      _submitted(0),
+      _executed(0),
+      _failed(0),
+      _dropped(0),
+      _coalesced(0),
+      _total_queue_delay_us(0),
+      _max_queue_delay_us(0),
+      _total_run_time_us(0),
+      _max_run_time_us(0) {
+    uint32_t num_threads = std::max(_options.num_threads, 1u);
+    for (uint32_t i = 0; i < num_threads; ++i) {
+        _workers.push_back(std::make_unique<Worker>());
+    }
+    for (auto& worker: _workers) {
+        worker->thread = std::thread(&RTVIExecutor::run, this, worker.get());
+    }
+}
+
+RTVIExecutor::~RTVIExecutor() {
+    stop();
+}
+
+bool RTVIExecutor::submit(
+        uint32_t key,
+        Task task,
+        RTVIExecutorTaskKind kind,
+        uint32_t coalesce_key
+) {
+    if (_state != State::Running) {
+        return false;
+    }
+
+    _submitted.fetch_add(1, std::memory_order_relaxed);
+
+    Worker* worker = _workers[key % _workers.size()].get();
+    Entry entry = {
+            .kind = kind,
+            .coalesce_key = coalesce_key,
+            .task = std::move(task),
+            .submitted = std::chrono::steady_clock::now(),
+    };
+
+    std::unique_lock<std::mutex> lock(worker->mutex);
+
+    if (_options.max_queue_size > 0 &&
+        worker->queue.size() >= _options.max_queue_size) {
+        Overflow overflow = make_room(worker, entry);
+        if (overflow != Overflow::Queue) {
+            return overflow == Overflow::Coalesced;
+        }
+    }
+
+    worker->queue.push_back(std::move(entry));
+    lock.unlock();
+
+    worker->condition.notify_one();
+    return true;
+}
+
+void RTVIExecutor::flush(uint32_t key) {
+    auto promise = std::make_shared<std::promise<void>>();
+    std::future<void> future = promise->get_future();
+    // The task owns the promise, so the future is also ready (with an error)
+    // if the task is dropped or discarded.
+    submit(
+            key,
+            [promise = std::move(promise)] { promise->set_value(); },
+            RTVIExecutorTaskKind::Required
+    );
+    future.wait();
+}
+
+void RTVIExecutor::stop(bool run_pending) {
+    State running = State::Running;
+    State stopped = run_pending ? State::Draining : State::Stopped;
+    if (!_state.compare_exchange_strong(running, stopped)) {
+        return;
+    }
+
+    for (auto& worker: _workers) {
+        std::lock_guard<std::mutex> lock(worker->mutex);
+        worker->condition.notify_all();
+    }
+
+    for (auto& worker: _workers) {
+        if (worker->thread.joinable()) {
+            worker->thread.join();
+        }
+        worker->queue.clear();
+    }
+}
+
+RTVIExecutorStats RTVIExecutor::stats() const {
+    size_t queue_depth = 0;
+    for (const auto& worker: _workers) {
+        std::lock_guard<std::mutex> lock(worker->mutex);
+        queue_depth += worker->queue.size();
+    }
+
+    return RTVIExecutorStats {
+            .queue_depth = queue_depth,
+            .submitted = _submitted.load(),
+            .executed = _executed.load(),
+            .failed = _failed.load(),
+            .dropped = _dropped.load(),
+            .coalesced = _coalesced.load(),
+            .total_queue_delay_us = _total_queue_delay_us.load(),
+            .max_queue_delay_us = _max_queue_delay_us.load(),
+            .total_run_time_us = _total_run_time_us.load(),
+            .max_run_time_us = _max_run_time_us.load(),
+    };
+}
+
+// Private
+
+// Called with the worker queue full and locked. Required tasks are queued
+// even if no room could be made.
+RTVIExecutor::Overflow RTVIExecutor::make_room(Worker* worker, Entry& entry) {
+    bool droppable = entry.kind != RTVIExecutorTaskKind::Required;
+
+    switch (_options.overflow_policy) {
+    case RTVIExecutorOverflowPolicy::DropNewest:
+        if (droppable) {
+            _dropped.fetch_add(1, std::memory_order_relaxed);
+            return Overflow::Dropped;
+        }
+        return Overflow::Queue;
+    case RTVIExecutorOverflowPolicy::Coalesce:
+        if (entry.kind == RTVIExecutorTaskKind::Coalescable) {
+            for (auto it = worker->queue.rbegin(); it != worker->queue.rend();
+                 ++it) {
+                if (it->kind == RTVIExecutorTaskKind::Coalescable &&
+                    it->coalesce_key == entry.coalesce_key) {
+                    // Keep the original submission time so the queue delay
+                    // accounts for the time the slot has been waiting.
+                    it->task = std::move(entry.task);
+                    _coalesced.fetch_add(1, std::memory_order_relaxed);
+                    return Overflow::Coalesced;
+                }
+            }
+        }
+        // Nothing to coalesce with.
+        [[fallthrough]];
+    case RTVIExecutorOverflowPolicy::DropOldest:
+        for (auto it = worker->queue.begin(); it != worker->queue.end(); ++it) {
+            if (it->kind != RTVIExecutorTaskKind::Required) {
+                worker->queue.erase(it);
+                _dropped.fetch_add(1, std::memory_order_relaxed);
+                return Overflow::Queue;
+            }
+        }
+        // Only required tasks are pending.
+        if (droppable) {
+            _dropped.fetch_add(1, std::memory_order_relaxed);
+            return Overflow::Dropped;
+        }
+        return Overflow::Queue;
+    }
+    return Overflow::Queue;
+}
+
+void RTVIExecutor::run(Worker* worker) {
+    while (true) {
+        std::unique_lock<std::mutex> lock(worker->mutex);
+        worker->condition.wait(lock, [this, worker] {
+            return _state != State::Running || !worker->queue.empty();
+        });
+
+        State state = _state;
+        if (state == State::Stopped ||
+            (state == State::Draining && worker->queue.empty())) {
+            return;
+        }
+
+        Entry entry = std::move(worker->queue.front());
+        worker->queue.pop_front();
+        lock.unlock();
+
+        auto start = std::chrono::steady_clock::now();
+        run_task(entry.task);
+        auto end = std::chrono::steady_clock::now();
+
+        uint64_t queue_delay = elapsed_us(entry.submitted, start);
+        uint64_t run_time = elapsed_us(start, end);
+
+        _executed.fetch_add(1, std::memory_order_relaxed);
+        _total_queue_delay_us.fetch_add(queue_delay, std::memory_order_relaxed);
+        _total_run_time_us.fetch_add(run_time, std::memory_order_relaxed);
+        update_max(_max_queue_delay_us, queue_delay);
+        update_max(_max_run_time_us, run_time);
+    }
+}
+
+void RTVIExecutor::run_task(Task& task) {
+    try {
+        task();
+    } catch (...) {
+        _failed.fetch_add(1, std::memory_order_relaxed);
+        if (_options.on_error) {
+            try {
+                _options.on_error(std::current_exception());
+            } catch (...) {
+                // Nowhere left to report it.
+            }
+        }
+    }
+}
@@ -0,0 +1,145 @@
+//
+// Copyright (c) 2024, Daily
+//
+
+#include "rtvi_histogram.h"
+
+#include "rtvi_exceptions.h"
+
+#include <algorithm>
+#include <cmath>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+using namespace rtvi;
+
+namespace {
+
+// Index of the highest bit set. `value` must not be zero.
+uint32_t highest_bit(uint64_t value) {
+#if defined(_MSC_VER)
+    unsigned long index;
+    _BitScanReverse64(&index, value);
+    return index;
+#else
+    return 63 - __builtin_clzll(value);
+#endif
+}
+
+}  // namespace
+
+// The layout follows HdrHistogram: the first bucket has `sub_bucket_count`
+// sub-buckets of size 1, and each of the next ones covers twice the range
+// with `sub_bucket_count / 2` sub-buckets twice as large, so the relative
+// error is the same everywhere.
+RTVIHistogram::RTVIHistogram(uint64_t highest_value, int significant_digits)
+    : _highest_value(std::max<uint64_t>(highest_value, 2)),
+      _count(0),
+      _min(UINT64_MAX),
+      _max(0),
+      _sum(0) {
+    if (significant_digits < 1 || significant_digits > 5) {
+        throw RTVIException("histogram significant digits must be 1 to 5");
+    }
+
+    uint64_t largest_single_unit = 2 * static_cast<uint64_t>(
+            std::pow(10, significant_digits)
+    );
+    _sub_bucket_count_magnitude = highest_bit(largest_single_unit - 1) + 1;
+    _sub_bucket_half_count_magnitude = _sub_bucket_count_magnitude - 1;
+    _sub_bucket_half_count = uint64_t(1) << _sub_bucket_half_count_magnitude;
+    _sub_bucket_mask = (uint64_t(1) << _sub_bucket_count_magnitude) - 1;
+
+    size_t bucket_count = 1;
+    uint64_t smallest_untrackable = uint64_t(1) << _sub_bucket_count_magnitude;
+    while (smallest_untrackable <= _highest_value) {
+        if (smallest_untrackable > UINT64_MAX / 2) {
+            bucket_count++;
+            break;
+        }
+        smallest_untrackable <<= 1;
+        bucket_count++;
+    }
+    _counts.resize((bucket_count + 1) * _sub_bucket_half_count);
+}
+
+void RTVIHistogram::record(uint64_t value, uint64_t count) {
+    value = std::min(value, _highest_value);
+    _counts[index_of(value)] += count;
+    _count += count;
+    _sum += value * count;
+    _min = std::min(_min, value);
+    _max = std::max(_max, value);
+}
+
+void RTVIHistogram::merge(const RTVIHistogram& other) {
+    if (other._counts.size() != _counts.size() ||
+        other._sub_bucket_count_magnitude != _sub_bucket_count_magnitude) {
+        throw RTVIException("histograms have different layouts");
+    }
+    for (size_t i = 0; i < _counts.size(); ++i) {
+        _counts[i] += other._counts[i];
+    }
+    _count += other._count;
+    _sum += other._sum;
+    _min = std::min(_min, other._min);
+    _max = std::max(_max, other._max);
+}
+
+void RTVIHistogram::reset() {
+    std::fill(_counts.begin(), _counts.end(), 0);
+    _count = 0;
+    _min = UINT64_MAX;
+    _max = 0;
+    _sum = 0;
+}
+
+double RTVIHistogram::mean() const {
+    return _count > 0 ? static_cast<double>(_sum) / _count : 0;
+}
+
+uint64_t RTVIHistogram::percentile(double percentile) const {
+    if (_count == 0) {
+        return 0;
+    }
+
+    percentile = std::min(std::max(percentile, 0.0), 100.0);
+    auto target = static_cast<uint64_t>(
+            std::ceil(percentile / 100 * static_cast<double>(_count))
+    );
+    target = std::max<uint64_t>(target, 1);
+
+    uint64_t total = 0;
+    for (size_t i = 0; i < _counts.size(); ++i) {
+        total += _counts[i];
+        if (total >= target) {
+            return std::min(highest_equivalent_value(i), _max);
+        }
+    }
+    return _max;
+}
+
+// Private
+
+size_t RTVIHistogram::index_of(uint64_t value) const {
+    uint32_t bucket_index = highest_bit(value | _sub_bucket_mask) -
+                            _sub_bucket_half_count_magnitude;
+    uint64_t sub_bucket_index = value >> bucket_index;
+    return ((bucket_index + 1) << _sub_bucket_half_count_magnitude) +
+           (sub_bucket_index - _sub_bucket_half_count);
+}
+
+uint64_t RTVIHistogram::highest_equivalent_value(size_t index) const {
+    int64_t bucket_index =
+            static_cast<int64_t>(index >> _sub_bucket_half_count_magnitude) - 1;
+    uint64_t sub_bucket_index =
+            (index & (_sub_bucket_half_count - 1)) + _sub_bucket_half_count;
+    if (bucket_index < 0) {
+        sub_bucket_index -= _sub_bucket_half_count;
+        bucket_index = 0;
+    }
+    uint64_t lowest = sub_bucket_index << bucket_index;
+    return lowest + (uint64_t(1) << bucket_index) - 1;
+}
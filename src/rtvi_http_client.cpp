@@ -0,0 +1,506 @@
+//
+// Copyright (c) 2024, Daily
+//
+
+#include "rtvi_http_client.h"
+#include "rtvi_exceptions.h"
+
+#include <curl/curl.h>
+
+#include <memory>
+#include <unordered_set>
+
+using namespace rtvi;
+
+static_assert(
+        CURL_LOCK_DATA_LAST <= 8,
+        "not enough locks for all the curl shared data"
+);
+
+struct SlistDeleter {
+    void operator()(curl_slist* list) const { curl_slist_free_all(list); }
+};
+
+typedef std::unique_ptr<curl_slist, SlistDeleter> SlistPtr;
+
+static size_t write_response_callback(
+        void* contents,
+        size_t size,
+        size_t nmemb,
+        std::string* output
+) {
+    size_t totalSize = size * nmemb;
+    output->append(static_cast<char*>(contents), totalSize);
+    return totalSize;
+}
+
+static SlistPtr make_headers(const std::vector<std::string>& headers) {
+    SlistPtr curl_headers;
+    for (const std::string& header: headers) {
+        curl_slist* list =
+                curl_slist_append(curl_headers.get(), header.c_str());
+        if (list == nullptr) {
+            throw RTVIException("unable to allocate request headers");
+        }
+        curl_headers.release();
+        curl_headers.reset(list);
+    }
+    return curl_headers;
+}
+
+// `url`, `body`, `headers` and `response` need to outlive the request.
+static void setup_post(
+        CURL* curl,
+        const std::string& url,
+        const std::string& body,
+        curl_slist* headers,
+        RTVIHttpResponse* response
+) {
+    curl_easy_setopt(curl, CURLOPT_URL, url.c_str());
+    curl_easy_setopt(curl, CURLOPT_HTTPHEADER, headers);
+    curl_easy_setopt(curl, CURLOPT_POST, 1L);
+    curl_easy_setopt(curl, CURLOPT_POSTFIELDS, body.c_str());
+    curl_easy_setopt(
+            curl, CURLOPT_POSTFIELDSIZE_LARGE, (curl_off_t) body.size()
+    );
+    curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, write_response_callback);
+    curl_easy_setopt(curl, CURLOPT_WRITEDATA, &response->body);
+}
+
+static RTVIException post_error(CURLcode res) {
+    return RTVIException(
+            "unable to perform POST request: " +
+            std::string(curl_easy_strerror(res))
+    );
+}
+
+static void lock_share(
+        CURL* /* handle */,
+        curl_lock_data data,
+        curl_lock_access /* access */,
+        void* userptr
+) {
+    static_cast<std::mutex*>(userptr)[data].lock();
+}
+
+static void
+unlock_share(CURL* /* handle */, curl_lock_data data, void* userptr) {
+    static_cast<std::mutex*>(userptr)[data].unlock();
+}
+
+struct RTVIHttpClient::AsyncRequest {
+    std::string url;
+    std::string body;
+    SlistPtr headers;
+    RTVIHttpResponse response;
+    RTVIHttpCallback callback;
+    CURL* handle = nullptr;
+};
+
+class RTVIHttpClient::HandleLease {
+   public:
+    explicit HandleLease(RTVIHttpClient& client)
+        : _client(client), _handle(client.acquire_handle()) {}
+
+    ~HandleLease() {
+        if (_handle) {
+            _client.release_handle(_handle);
+        }
+    }
+
+    CURL* get() const { return _handle; }
+
+    // Keeps the handle, which must then be given back some other way.
+    CURL* release() {
+        CURL* handle = _handle;
+        _handle = nullptr;
+        return handle;
+    }
+
+   private:
+    RTVIHttpClient& _client;
+    CURL* _handle;
+};
+
+RTVIHttpClient::RTVIHttpClient(const RTVIHttpClientOptions& options)
+    : _options(options),
+      _requests(0),
+      _failed_requests(0),
+      _reused_connections(0),
+      _new_connections(0),
+      _total_dns_time_us(0),
+      _total_connect_time_us(0),
+      _total_handshake_time_us(0),
+      _total_request_time_us(0),
+      _multi(nullptr),
+      _loop_stopped(false),
+      _next_callback_key(0) {
+    // Reference counted by libcurl, and undone by the destructor.
+    if (curl_global_init(CURL_GLOBAL_DEFAULT) != CURLE_OK) {
+        throw RTVIException("unable to initialize CURL");
+    }
+
+    _share = curl_share_init();
+    if (_share == nullptr) {
+        curl_global_cleanup();
+        throw RTVIException("unable to initialize CURL share");
+    }
+
+    // The connection cache is not shared: libcurl doesn't support using a
+    // shared one from several threads at once, which blocking requests do.
+    // Instead, each handle keeps its own connections and asynchronous
+    // requests use the connections of the multi handle.
+    curl_share_setopt(_share, CURLSHOPT_SHARE, CURL_LOCK_DATA_DNS);
+    curl_share_setopt(_share, CURLSHOPT_SHARE, CURL_LOCK_DATA_SSL_SESSION);
+    curl_share_setopt(_share, CURLSHOPT_SHARE, CURL_LOCK_DATA_COOKIE);
+    curl_share_setopt(_share, CURLSHOPT_LOCKFUNC, lock_share);
+    curl_share_setopt(_share, CURLSHOPT_UNLOCKFUNC, unlock_share);
+    curl_share_setopt(_share, CURLSHOPT_USERDATA, _share_locks);
+}
+
+RTVIHttpClient::~RTVIHttpClient() {
+    stop_event_loop();
+
+    // Handles need to be cleaned up before the share they use.
+    for (void* handle: _idle_handles) {
+        curl_easy_cleanup(handle);
+    }
+    curl_share_cleanup(_share);
+
+    curl_global_cleanup();
+}
+
+RTVIHttpClient& RTVIHttpClient::shared() {
+    static RTVIHttpClient client;
+    return client;
+}
+
+RTVIHttpResponse RTVIHttpClient::post(
+        const std::string& url,
+        const std::string& body,
+        const std::vector<std::string>& headers
+) {
+    HandleLease lease(*this);
+    CURL* curl = lease.get();
+
+    SlistPtr curl_headers = make_headers(headers);
+    RTVIHttpResponse response;
+
+    setup_post(curl, url, body, curl_headers.get(), &response);
+
+    CURLcode res = curl_easy_perform(curl);
+
+    update_stats(curl, res == CURLE_OK);
+
+    if (res != CURLE_OK) {
+        throw post_error(res);
+    }
+
+    curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &response.status);
+
+    return response;
+}
+
+void RTVIHttpClient::post_async(
+        const std::string& url,
+        const std::string& body,
+        const std::vector<std::string>& headers,
+        RTVIHttpCallback callback
+) {
+    // Start the loop before taking anything that would need to be given back
+    // if it fails to start.
+    std::unique_lock<std::mutex> lock(_loop_mutex);
+    if (_loop_stopped) {
+        throw RTVIException("HTTP client is stopped");
+    }
+    if (!_loop_thread.joinable()) {
+        start_event_loop();
+    }
+    lock.unlock();
+
+    auto request = std::make_unique<AsyncRequest>();
+    request->url = url;
+    request->body = body;
+    request->headers = make_headers(headers);
+    request->callback = std::move(callback);
+
+    // The lease gives the handle back unless the request is queued.
+    HandleLease lease(*this);
+    request->handle = lease.get();
+
+    CURL* curl = request->handle;
+    setup_post(
+            curl,
+            request->url,
+            request->body,
+            request->headers.get(),
+            &request->response
+    );
+    // Prefer waiting for a connection that can multiplex (HTTP/2) over
+    // opening a new one.
+    curl_easy_setopt(curl, CURLOPT_PIPEWAIT, 1L);
+    curl_easy_setopt(curl, CURLOPT_PRIVATE, request.get());
+
+    lock.lock();
+    if (_loop_stopped) {
+        throw RTVIException("HTTP client is stopped");
+    }
+    _new_requests.push_back(request.get());
+    request.release();
+    lease.release();
+    lock.unlock();
+
+    curl_multi_wakeup(_multi);
+}
+
+std::future<RTVIHttpResponse> RTVIHttpClient::post_async(
+        const std::string& url,
+        const std::string& body,
+        const std::vector<std::string>& headers
+) {
+    auto promise = std::make_shared<std::promise<RTVIHttpResponse>>();
+    auto future = promise->get_future();
+
+    post_async(
+            url,
+            body,
+            headers,
+            [promise](std::exception_ptr error, RTVIHttpResponse response) {
+                if (error) {
+                    promise->set_exception(error);
+                } else {
+                    promise->set_value(std::move(response));
+                }
+            }
+    );
+
+    return future;
+}
+
+RTVIHttpClientStats RTVIHttpClient::stats() const {
+    return RTVIHttpClientStats {
+            .requests = _requests.load(),
+            .failed_requests = _failed_requests.load(),
+            .reused_connections = _reused_connections.load(),
+            .new_connections = _new_connections.load(),
+            .total_dns_time_us = _total_dns_time_us.load(),
+            .total_connect_time_us = _total_connect_time_us.load(),
+            .total_handshake_time_us = _total_handshake_time_us.load(),
+            .total_request_time_us = _total_request_time_us.load(),
+    };
+}
+
+// Private
+
+void* RTVIHttpClient::acquire_handle() {
+    std::unique_lock<std::mutex> lock(_handles_mutex);
+    if (!_idle_handles.empty()) {
+        CURL* curl = _idle_handles.back();
+        _idle_handles.pop_back();
+        return curl;
+    }
+    lock.unlock();
+
+    CURL* curl = curl_easy_init();
+    if (curl == nullptr) {
+        throw RTVIException("unable to initialize CURL");
+    }
+    setup_handle(curl);
+    return curl;
+}
+
+void RTVIHttpClient::release_handle(void* handle) {
+    // Resetting keeps the handle caches, but clears all the options (and
+    // with them any pointer to the previous request).
+    curl_easy_reset(handle);
+    setup_handle(handle);
+
+    std::unique_lock<std::mutex> lock(_handles_mutex);
+    if (_idle_handles.size() < _options.max_idle_handles) {
+        _idle_handles.push_back(handle);
+        return;
+    }
+    lock.unlock();
+
+    curl_easy_cleanup(handle);
+}
+
+void RTVIHttpClient::setup_handle(void* handle) {
+    curl_easy_setopt(handle, CURLOPT_SHARE, _share);
+    curl_easy_setopt(handle, CURLOPT_NOSIGNAL, 1L);
+    curl_easy_setopt(handle, CURLOPT_TCP_KEEPALIVE, 1L);
+    curl_easy_setopt(
+            handle,
+            CURLOPT_HTTP_VERSION,
+            _options.http2 ? CURL_HTTP_VERSION_2TLS : CURL_HTTP_VERSION_1_1
+    );
+    curl_easy_setopt(
+            handle, CURLOPT_CONNECTTIMEOUT_MS, _options.connect_timeout_ms
+    );
+    curl_easy_setopt(handle, CURLOPT_TIMEOUT_MS, _options.timeout_ms);
+}
+
+void RTVIHttpClient::update_stats(void* handle, bool success) {
+    _requests.fetch_add(1, std::memory_order_relaxed);
+    if (!success) {
+        _failed_requests.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    long num_connects = 0;
+    curl_off_t dns = 0;
+    curl_off_t connect = 0;
+    curl_off_t app_connect = 0;
+    curl_off_t total = 0;
+    curl_easy_getinfo(handle, CURLINFO_NUM_CONNECTS, &num_connects);
+    curl_easy_getinfo(handle, CURLINFO_NAMELOOKUP_TIME_T, &dns);
+    curl_easy_getinfo(handle, CURLINFO_CONNECT_TIME_T, &connect);
+    curl_easy_getinfo(handle, CURLINFO_APPCONNECT_TIME_T, &app_connect);
+    curl_easy_getinfo(handle, CURLINFO_TOTAL_TIME_T, &total);
+
+    _total_request_time_us.fetch_add(total, std::memory_order_relaxed);
+
+    if (num_connects == 0) {
+        if (success) {
+            _reused_connections.fetch_add(1, std::memory_order_relaxed);
+        }
+        return;
+    }
+
+    // All the times are measured from the start of the request. The
+    // application connect time is zero for plain HTTP.
+    _new_connections.fetch_add(num_connects, std::memory_order_relaxed);
+    _total_dns_time_us.fetch_add(dns, std::memory_order_relaxed);
+    _total_connect_time_us.fetch_add(connect - dns, std::memory_order_relaxed);
+    if (app_connect > connect) {
+        _total_handshake_time_us.fetch_add(
+                app_connect - connect, std::memory_order_relaxed
+        );
+    }
+}
+
+void RTVIHttpClient::start_event_loop() {
+    _multi = curl_multi_init();
+    if (_multi == nullptr) {
+        throw RTVIException("unable to initialize CURL multi");
+    }
+    curl_multi_setopt(_multi, CURLMOPT_PIPELINING, CURLPIPE_MULTIPLEX);
+
+    // Completion callbacks can't be dropped, so their queue is unbounded.
+    RTVIExecutorOptions executor_options;
+    executor_options.num_threads = _options.callback_threads;
+    executor_options.max_queue_size = 0;
+
+    // Leave nothing behind if a thread can't be started, so the next request
+    // can try again.
+    try {
+        _callback_executor = std::make_unique<RTVIExecutor>(executor_options);
+        _loop_thread = std::thread(&RTVIHttpClient::run_event_loop, this);
+    } catch (...) {
+        _callback_executor.reset();
+        curl_multi_cleanup(_multi);
+        _multi = nullptr;
+        throw;
+    }
+}
+
+void RTVIHttpClient::stop_event_loop() {
+    std::unique_lock<std::mutex> lock(_loop_mutex);
+    _loop_stopped = true;
+    lock.unlock();
+
+    if (!_loop_thread.joinable()) {
+        return;
+    }
+
+    curl_multi_wakeup(_multi);
+    _loop_thread.join();
+
+    // Callbacks of completed requests might still be queued, and someone
+    // might be waiting for them (e.g. RTVIClient::connect_async()).
+    _callback_executor->stop(true);
+
+    curl_multi_cleanup(_multi);
+    _multi = nullptr;
+}
+
+void RTVIHttpClient::run_event_loop() {
+    std::vector<AsyncRequest*> requests;
+    std::unordered_set<CURL*> active;
+
+    while (true) {
+        std::unique_lock<std::mutex> lock(_loop_mutex);
+        bool stopped = _loop_stopped;
+        requests.swap(_new_requests);
+        lock.unlock();
+
+        for (AsyncRequest* request: requests) {
+            curl_multi_add_handle(_multi, request->handle);
+            active.insert(request->handle);
+        }
+        requests.clear();
+
+        if (stopped) {
+            break;
+        }
+
+        int running = 0;
+        curl_multi_perform(_multi, &running);
+
+        int num_messages = 0;
+        CURLMsg* message;
+        while ((message = curl_multi_info_read(_multi, &num_messages))) {
+            if (message->msg != CURLMSG_DONE) {
+                continue;
+            }
+            CURL* curl = message->easy_handle;
+            curl_multi_remove_handle(_multi, curl);
+            active.erase(curl);
+            finish_request(curl, message->data.result, false);
+        }
+
+        curl_multi_poll(_multi, nullptr, 0, 1000, nullptr);
+    }
+
+    // Fail whatever is still running. The callback executor is stopped
+    // right after the loop, so call these right away.
+    for (CURL* curl: active) {
+        curl_multi_remove_handle(_multi, curl);
+        finish_request(curl, CURLE_ABORTED_BY_CALLBACK, true);
+    }
+}
+
+void RTVIHttpClient::finish_request(void* handle, int result, bool stopping) {
+    AsyncRequest* request = nullptr;
+    curl_easy_getinfo(handle, CURLINFO_PRIVATE, &request);
+    std::unique_ptr<AsyncRequest> owner(request);
+
+    CURLcode res = static_cast<CURLcode>(result);
+    update_stats(handle, res == CURLE_OK);
+
+    std::exception_ptr error;
+    if (res == CURLE_OK) {
+        curl_easy_getinfo(
+                handle, CURLINFO_RESPONSE_CODE, &request->response.status
+        );
+    } else {
+        error = std::make_exception_ptr(post_error(res));
+    }
+
+    release_handle(handle);
+
+    if (stopping) {
+        request->callback(error, std::move(request->response));
+        return;
+    }
+
+    // Callbacks run in their own threads, so slow callbacks don't hold back
+    // other requests.
+    _callback_executor->submit(
+            _next_callback_key++,
+            [error,
+             callback = std::move(request->callback),
+             response = std::move(request->response)]() mutable {
+                callback(error, std::move(response));
+            }
+    );
+}
@@ -0,0 +1,470 @@
+//
+// Copyright (c) 2024, Daily
+//
+
+#include "rtvi_inbound_message.h"
+
+#include "rtvi_exceptions.h"
+
+#include <cstdint>
+
+using namespace rtvi;
+
+namespace {
+
+// A minimal scanner that finds where values start and end without building
+// anything. Nested objects and arrays are skipped by matching brackets, so
+// it's up to the JSON parser to validate them if they are ever parsed.
+
+void skip_whitespace(std::string_view text, size_t& pos) {
+    while (pos < text.size() &&
+           (text[pos] == ' ' || text[pos] == '\t' || text[pos] == '\n' ||
+            text[pos] == '\r')) {
+        pos++;
+    }
+}
+
+bool skip_string(std::string_view text, size_t& pos) {
+    // Skip the opening quote.
+    pos++;
+    while (pos < text.size()) {
+        char c = text[pos];
+        if (c == '"') {
+            pos++;
+            return true;
+        } else if (c == '\\') {
+            pos += 2;
+        } else if (static_cast<unsigned char>(c) < 0x20) {
+            return false;
+        } else {
+            pos++;
+        }
+    }
+    return false;
+}
+
+bool skip_value(std::string_view text, size_t& pos) {
+    if (pos >= text.size()) {
+        return false;
+    }
+
+    char c = text[pos];
+    if (c == '"') {
+        return skip_string(text, pos);
+    }
+
+    if (c == '{' || c == '[') {
+        size_t depth = 0;
+        while (pos < text.size()) {
+            c = text[pos];
+            if (c == '"') {
+                if (!skip_string(text, pos)) {
+                    return false;
+                }
+                continue;
+            }
+            if (c == '{' || c == '[') {
+                depth++;
+            } else if (c == '}' || c == ']') {
+                if (--depth == 0) {
+                    pos++;
+                    return true;
+                }
+            }
+            pos++;
+        }
+        return false;
+    }
+
+    // Numbers and literals.
+    size_t start = pos;
+    while (pos < text.size()) {
+        c = text[pos];
+        if ((c >= '0' && c <= '9') || (c >= 'a' && c <= 'z') || c == '-' ||
+            c == '+' || c == '.' || c == 'E') {
+            pos++;
+        } else {
+            break;
+        }
+    }
+    return pos > start;
+}
+
+// Calls `f(key, value)` for each field of the object at the start of `text`,
+// until `f` returns false. Keys are raw (still quoted and escaped), values
+// are the raw JSON text. Returns false if the object is malformed.
+template<typename F>
+bool for_each_field(std::string_view text, F f) {
+    size_t pos = 0;
+    skip_whitespace(text, pos);
+    if (pos >= text.size() || text[pos] != '{') {
+        return false;
+    }
+    pos++;
+
+    skip_whitespace(text, pos);
+    if (pos < text.size() && text[pos] == '}') {
+        return true;
+    }
+
+    while (pos < text.size()) {
+        if (text[pos] != '"') {
+            return false;
+        }
+        size_t key_start = pos;
+        if (!skip_string(text, pos)) {
+            return false;
+        }
+        std::string_view key = text.substr(key_start, pos - key_start);
+
+        skip_whitespace(text, pos);
+        if (pos >= text.size() || text[pos] != ':') {
+            return false;
+        }
+        pos++;
+        skip_whitespace(text, pos);
+
+        size_t value_start = pos;
+        if (!skip_value(text, pos)) {
+            return false;
+        }
+        if (!f(key, text.substr(value_start, pos - value_start))) {
+            return true;
+        }
+
+        skip_whitespace(text, pos);
+        if (pos >= text.size()) {
+            return false;
+        }
+        if (text[pos] == '}') {
+            return true;
+        }
+        if (text[pos] != ',') {
+            return false;
+        }
+        pos++;
+        skip_whitespace(text, pos);
+    }
+    return false;
+}
+
+bool parse_hex4(std::string_view text, size_t pos, uint32_t& value) {
+    if (pos + 4 > text.size()) {
+        return false;
+    }
+    value = 0;
+    for (size_t i = pos; i < pos + 4; ++i) {
+        char c = text[i];
+        value <<= 4;
+        if (c >= '0' && c <= '9') {
+            value |= c - '0';
+        } else if (c >= 'a' && c <= 'f') {
+            value |= c - 'a' + 10;
+        } else if (c >= 'A' && c <= 'F') {
+            value |= c - 'A' + 10;
+        } else {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Writes to a buffer known to be large enough.
+class Writer {
+   public:
+    explicit Writer(char* data) : _data(data), _size(0) {}
+
+    void push_back(char c) { _data[_size++] = c; }
+
+    size_t size() const { return _size; }
+
+   private:
+    char* _data;
+    size_t _size;
+};
+
+void append_utf8(Writer& out, uint32_t code_point) {
+    if (code_point < 0x80) {
+        out.push_back(static_cast<char>(code_point));
+    } else if (code_point < 0x800) {
+        out.push_back(static_cast<char>(0xc0 | (code_point >> 6)));
+        out.push_back(static_cast<char>(0x80 | (code_point & 0x3f)));
+    } else if (code_point < 0x10000) {
+        out.push_back(static_cast<char>(0xe0 | (code_point >> 12)));
+        out.push_back(static_cast<char>(0x80 | ((code_point >> 6) & 0x3f)));
+        out.push_back(static_cast<char>(0x80 | (code_point & 0x3f)));
+    } else {
+        out.push_back(static_cast<char>(0xf0 | (code_point >> 18)));
+        out.push_back(static_cast<char>(0x80 | ((code_point >> 12) & 0x3f)));
+        out.push_back(static_cast<char>(0x80 | ((code_point >> 6) & 0x3f)));
+        out.push_back(static_cast<char>(0x80 | (code_point & 0x3f)));
+    }
+}
+
+// Decodes the contents of a string (without quotes) into `data`, which must
+// have room for `text.size()` characters since decoding never makes a
+// string longer. Returns the decoded size, or `std::string_view::npos` if
+// the string is malformed.
+size_t unescape(std::string_view text, char* data) {
+    Writer out(data);
+    for (size_t pos = 0; pos < text.size(); ++pos) {
+        char c = text[pos];
+        if (c != '\\') {
+            out.push_back(c);
+            continue;
+        }
+
+        if (++pos >= text.size()) {
+            return std::string_view::npos;
+        }
+        switch (text[pos]) {
+        case '"':
+            out.push_back('"');
+            break;
+        case '\\':
+            out.push_back('\\');
+            break;
+        case '/':
+            out.push_back('/');
+            break;
+        case 'b':
+            out.push_back('\b');
+            break;
+        case 'f':
+            out.push_back('\f');
+            break;
+        case 'n':
+            out.push_back('\n');
+            break;
+        case 'r':
+            out.push_back('\r');
+            break;
+        case 't':
+            out.push_back('\t');
+            break;
+        case 'u': {
+            uint32_t code_point;
+            if (!parse_hex4(text, pos + 1, code_point)) {
+                return std::string_view::npos;
+            }
+            pos += 4;
+            // Surrogate pairs
+            if (code_point >= 0xd800 && code_point <= 0xdbff) {
+                uint32_t low;
+                if (pos + 2 >= text.size() || text[pos + 1] != '\\' ||
+                    text[pos + 2] != 'u' || !parse_hex4(text, pos + 3, low) ||
+                    low < 0xdc00 || low > 0xdfff) {
+                    return std::string_view::npos;
+                }
+                pos += 6;
+                code_point = 0x10000 + ((code_point - 0xd800) << 10) +
+                             (low - 0xdc00);
+            } else if (code_point >= 0xdc00 && code_point <= 0xdfff) {
+                return std::string_view::npos;
+            }
+            append_utf8(out, code_point);
+            break;
+        }
+        default:
+            return std::string_view::npos;
+        }
+    }
+    return out.size();
+}
+
+// Compares a raw (quoted) key with an unescaped one.
+bool key_equals(std::string_view raw_key, std::string_view key) {
+    std::string_view contents = raw_key.substr(1, raw_key.size() - 2);
+    if (contents.find('\\') == std::string_view::npos) {
+        return contents == key;
+    }
+    std::string decoded(contents.size(), '\0');
+    size_t size = unescape(contents, decoded.data());
+    return size == key.size() && decoded.compare(0, size, key) == 0;
+}
+
+}  // namespace
+
+RTVIInboundMessage::RTVIInboundMessage(std::string frame)
+    : _frame(std::move(frame)) {
+    std::string_view text(_frame);
+    bool valid = for_each_field(
+            text,
+            [&](std::string_view key, std::string_view value) {
+                Span span {
+                        static_cast<size_t>(value.data() - text.data()),
+                        value.size(),
+                        true
+                };
+                if (key_equals(key, "type")) {
+                    _type = span;
+                } else if (key_equals(key, "id")) {
+                    _id = span;
+                } else if (key_equals(key, "data")) {
+                    _data = span;
+                }
+                return true;
+            }
+    );
+    if (!valid) {
+        throw RTVIException("invalid message: not a JSON object");
+    }
+}
+
+RTVIInboundMessage::RTVIInboundMessage(nlohmann::json message)
+    : _json(std::move(message)) {}
+
+RTVIInboundMessage RTVIInboundMessage::borrow(const nlohmann::json& message) {
+    RTVIInboundMessage result;
+    result._borrowed = &message;
+    return result;
+}
+
+void RTVIInboundMessage::detach() {
+    if (_borrowed) {
+        _json = *_borrowed;
+        _borrowed = nullptr;
+    }
+}
+
+std::string_view RTVIInboundMessage::type() const {
+    if (_frame.empty()) {
+        const std::string* type = json_string("type");
+        return type ? std::string_view(*type) : std::string_view();
+    }
+    return string_value(view(_type)).value_or(std::string_view());
+}
+
+std::string_view RTVIInboundMessage::id() const {
+    if (_frame.empty()) {
+        const std::string* id = json_string("id");
+        return id ? std::string_view(*id) : std::string_view();
+    }
+    return string_value(view(_id)).value_or(std::string_view());
+}
+
+std::optional<std::string_view>
+RTVIInboundMessage::data_string(std::string_view key) const {
+    if (_frame.empty()) {
+        const nlohmann::json& message = dom();
+        auto it = message.find("data");
+        if (it == message.end() || !it->is_object()) {
+            return std::nullopt;
+        }
+        auto field = it->find(std::string(key));
+        if (field == it->end() || !field->is_string()) {
+            return std::nullopt;
+        }
+        return field->get_ref<const std::string&>();
+    }
+
+    auto value = data_value(key);
+    return value ? string_value(*value) : std::nullopt;
+}
+
+std::optional<bool> RTVIInboundMessage::data_bool(std::string_view key) const {
+    if (_frame.empty()) {
+        const nlohmann::json& message = dom();
+        auto it = message.find("data");
+        if (it == message.end() || !it->is_object()) {
+            return std::nullopt;
+        }
+        auto field = it->find(std::string(key));
+        if (field == it->end() || !field->is_boolean()) {
+            return std::nullopt;
+        }
+        return field->get<bool>();
+    }
+
+    auto value = data_value(key);
+    if (value == "true") {
+        return true;
+    } else if (value == "false") {
+        return false;
+    }
+    return std::nullopt;
+}
+
+nlohmann::json RTVIInboundMessage::data() const {
+    if (has_json()) {
+        const nlohmann::json& message = dom();
+        auto it = message.find("data");
+        return it != message.end() ? *it : nlohmann::json();
+    }
+    if (!_data.found) {
+        return nlohmann::json();
+    }
+    return nlohmann::json::parse(view(_data));
+}
+
+const nlohmann::json& RTVIInboundMessage::json() const {
+    if (!has_json()) {
+        _json = nlohmann::json::parse(_frame);
+    }
+    return dom();
+}
+
+// Private
+
+std::string_view RTVIInboundMessage::view(const Span& span) const {
+    if (!span.found) {
+        return std::string_view();
+    }
+    return std::string_view(_frame).substr(span.offset, span.length);
+}
+
+std::optional<std::string_view>
+RTVIInboundMessage::data_value(std::string_view key) const {
+    std::optional<std::string_view> result;
+    for_each_field(
+            view(_data),
+            [&](std::string_view raw_key, std::string_view value) {
+                if (key_equals(raw_key, key)) {
+                    result = value;
+                    return false;
+                }
+                return true;
+            }
+    );
+    return result;
+}
+
+std::optional<std::string_view>
+RTVIInboundMessage::string_value(std::string_view value) const {
+    if (value.size() < 2 || value.front() != '"') {
+        return std::nullopt;
+    }
+
+    std::string_view contents = value.substr(1, value.size() - 2);
+    if (contents.find('\\') == std::string_view::npos) {
+        return contents;
+    }
+
+    char* data;
+    if (_arena) {
+        data = static_cast<char*>(_arena->allocate(contents.size(), 1));
+    } else {
+        data = _decoded.emplace_front(contents.size(), '\0').data();
+    }
+
+    size_t size = unescape(contents, data);
+    if (size == std::string_view::npos) {
+        return std::nullopt;
+    }
+    return std::string_view(data, size);
+}
+
+// Top-level string field of a message created from JSON.
+const std::string* RTVIInboundMessage::json_string(const char* key) const {
+    const nlohmann::json& message = dom();
+    auto it = message.find(key);
+    if (it == message.end() || !it->is_string()) {
+        return nullptr;
+    }
+    return &it->get_ref<const std::string&>();
+}
+
+// Only valid if `has_json()`.
+const nlohmann::json& RTVIInboundMessage::dom() const {
+    return _borrowed ? *_borrowed : *_json;
+}
@@ -0,0 +1,322 @@
+//
+// Copyright (c) 2024, Daily
+//
+
+#include "rtvi_jitter_buffer.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+using namespace rtvi;
+
+// Amount of played audio kept around to conceal underruns.
+static const double HISTORY_MS = 10.0;
+// Concealment fades out to silence over this period.
+static const double CONCEAL_FADE_MS = 30.0;
+// Fade-in applied when playback resumes after buffering.
+static const double FADE_IN_MS = 2.0;
+// Time constant for the extra delay added after underruns to decay.
+static const double UNDERRUN_BOOST_DECAY_MS = 4000.0;
+// Target depth in number of jitter deviations.
+static const double JITTER_FACTOR = 4.0;
+// Arrival gaps longer than this are treated as a new talkspurt.
+static const double TALKSPURT_GAP_FACTOR = 2.0;
+
+RTVIJitterBuffer::RTVIJitterBuffer(const RTVIJitterBufferOptions& options)
+    : _options(options),
+      _buffer(
+              static_cast<size_t>(options.sample_rate) * options.capacity_ms /
+              1000 * options.num_channels
+      ),
+      _has_arrival(false),
+      _last_packet_ms(0),
+      _jitter_ms(0),
+      _packet_ms(0),
+      _reset_pending(false),
+      _stale_samples(0),
+      _buffering(true),
+      _target_frames(ms_to_frames(options.min_delay_ms)),
+      _underrun_boost_ms(0),
+      _conceal_position(0),
+      _fade_in(false),
+      _history(ms_to_frames(HISTORY_MS) * options.num_channels),
+      _scratch(_buffer.capacity()),
+      _concealing(false),
+      _target_frames_snapshot(_target_frames),
+      _late_packets(0),
+      _lost_frames(0),
+      _compressed_frames(0),
+      _dropped_frames(0),
+      _underruns(0) {}
+
+size_t RTVIJitterBuffer::put(
+        const int16_t* frames,
+        size_t num_frames,
+        std::optional<std::chrono::steady_clock::time_point> arrival
+) {
+    double packet_ms = frames_to_ms(num_frames);
+
+    if (arrival && _has_arrival) {
+        std::chrono::duration<double, std::milli> elapsed =
+                *arrival - _last_arrival;
+        double elapsed_ms = elapsed.count();
+        if (elapsed_ms < _options.max_delay_ms * TALKSPURT_GAP_FACTOR) {
+            // RFC 3550 interarrival jitter, with the media time advancing by
+            // the duration of the previous packet.
+            double deviation = std::fabs(elapsed_ms - _last_packet_ms);
+            double jitter = _jitter_ms.load(std::memory_order_relaxed);
+            jitter += (deviation - jitter) / 16.0;
+            _jitter_ms.store(jitter, std::memory_order_relaxed);
+        }
+    }
+    if (arrival) {
+        _has_arrival = true;
+        _last_arrival = *arrival;
+        _last_packet_ms = packet_ms;
+    }
+
+    double average_packet_ms = _packet_ms.load(std::memory_order_relaxed);
+    if (average_packet_ms == 0) {
+        average_packet_ms = packet_ms;
+    } else {
+        average_packet_ms += (packet_ms - average_packet_ms) / 16.0;
+    }
+    _packet_ms.store(average_packet_ms, std::memory_order_relaxed);
+
+    if (_concealing.load(std::memory_order_relaxed)) {
+        _late_packets.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    // Only write whole frames.
+    size_t num_channels = _options.num_channels;
+    size_t to_write =
+            std::min(num_frames, _buffer.free_space() / num_channels);
+    _buffer.write(frames, to_write * num_channels);
+
+    if (to_write < num_frames) {
+        _dropped_frames.fetch_add(
+                num_frames - to_write, std::memory_order_relaxed
+        );
+    }
+
+    return to_write;
+}
+
+size_t RTVIJitterBuffer::get(int16_t* frames, size_t num_frames) {
+    size_t num_channels = _options.num_channels;
+
+    if (_reset_pending.exchange(false, std::memory_order_acquire)) {
+        reset_consumer();
+    }
+
+    update_target(num_frames);
+
+    size_t available = _buffer.size() / num_channels;
+
+    if (_buffering) {
+        if (available < _target_frames) {
+            conceal(frames, num_frames);
+            return 0;
+        }
+        _buffering = false;
+        _fade_in = true;
+        _conceal_position = 0;
+        _concealing.store(false, std::memory_order_relaxed);
+    }
+
+    if (available < num_frames) {
+        size_t got = _buffer.read(frames, available * num_channels) /
+                     num_channels;
+        remember(frames, got);
+        conceal(frames + got * num_channels, num_frames - got);
+
+        _buffering = true;
+        _concealing.store(true, std::memory_order_relaxed);
+        _underrun_boost_ms += _packet_ms.load(std::memory_order_relaxed);
+        _lost_frames.fetch_add(num_frames - got, std::memory_order_relaxed);
+        _underruns.fetch_add(1, std::memory_order_relaxed);
+        return got;
+    }
+
+    // Only compress if we are well above the target depth, and never remove
+    // more than a fraction of the requested frames at once so it's not
+    // audible.
+    size_t remaining = available - num_frames;
+    size_t hysteresis = _target_frames / 2;
+    size_t excess = 0;
+    if (remaining > _target_frames + hysteresis) {
+        excess = std::min(remaining - _target_frames, num_frames / 8);
+    }
+
+    if (excess > 0) {
+        read_compressed(frames, num_frames, excess);
+    } else {
+        _buffer.read(frames, num_frames * num_channels);
+    }
+
+    if (_fade_in) {
+        size_t fade_frames = std::min(num_frames, ms_to_frames(FADE_IN_MS));
+        for (size_t i = 0; i < fade_frames; ++i) {
+            double gain = static_cast<double>(i + 1) / (fade_frames + 1);
+            for (size_t c = 0; c < num_channels; ++c) {
+                int16_t& sample = frames[i * num_channels + c];
+                sample = static_cast<int16_t>(sample * gain);
+            }
+        }
+        _fade_in = false;
+    }
+
+    remember(frames, num_frames);
+
+    return num_frames;
+}
+
+void RTVIJitterBuffer::reset() {
+    _has_arrival = false;
+    _jitter_ms = 0;
+    _packet_ms = 0;
+
+    // Only the consumer can drop buffered audio, and it might be running.
+    _stale_samples.store(_buffer.size(), std::memory_order_relaxed);
+    _reset_pending.store(true, std::memory_order_release);
+}
+
+RTVIJitterBufferStats RTVIJitterBuffer::stats() const {
+    return RTVIJitterBufferStats {
+            .depth_ms = static_cast<uint32_t>(
+                    frames_to_ms(_buffer.size() / _options.num_channels)
+            ),
+            .target_ms = static_cast<uint32_t>(
+                    frames_to_ms(_target_frames_snapshot.load())
+            ),
+            .jitter_ms = _jitter_ms.load(),
+            .late_packets = _late_packets.load(),
+            .lost_frames = _lost_frames.load(),
+            .compressed_frames = _compressed_frames.load(),
+            .dropped_frames = _dropped_frames.load(),
+            .underruns = _underruns.load(),
+    };
+}
+
+// Private
+
+size_t RTVIJitterBuffer::ms_to_frames(double ms) const {
+    return static_cast<size_t>(ms * _options.sample_rate / 1000.0);
+}
+
+double RTVIJitterBuffer::frames_to_ms(size_t frames) const {
+    return frames * 1000.0 / _options.sample_rate;
+}
+
+void RTVIJitterBuffer::reset_consumer() {
+    _buffer.discard(_stale_samples.load(std::memory_order_relaxed));
+    _buffering = true;
+    _underrun_boost_ms = 0;
+    _conceal_position = 0;
+    _fade_in = false;
+    std::fill(_history.begin(), _history.end(), 0);
+    _concealing.store(false, std::memory_order_relaxed);
+}
+
+void RTVIJitterBuffer::update_target(size_t num_frames) {
+    double elapsed_ms = frames_to_ms(num_frames);
+    _underrun_boost_ms -=
+            _underrun_boost_ms * elapsed_ms / UNDERRUN_BOOST_DECAY_MS;
+
+    double packet_ms = _packet_ms.load(std::memory_order_relaxed);
+    double jitter_ms = _jitter_ms.load(std::memory_order_relaxed);
+
+    double target_ms =
+            packet_ms + JITTER_FACTOR * jitter_ms + _underrun_boost_ms;
+    target_ms = std::clamp(
+            target_ms,
+            static_cast<double>(_options.min_delay_ms),
+            static_cast<double>(_options.max_delay_ms)
+    );
+
+    _target_frames = ms_to_frames(target_ms);
+    _target_frames_snapshot.store(_target_frames, std::memory_order_relaxed);
+}
+
+void RTVIJitterBuffer::conceal(int16_t* frames, size_t num_frames) {
+    size_t num_channels = _options.num_channels;
+    size_t history_frames = _history.size() / num_channels;
+    size_t fade_frames = ms_to_frames(CONCEAL_FADE_MS);
+
+    for (size_t i = 0; i < num_frames; ++i) {
+        if (_conceal_position >= fade_frames || history_frames == 0) {
+            std::memset(
+                    frames + i * num_channels,
+                    0,
+                    (num_frames - i) * num_channels * sizeof(int16_t)
+            );
+            break;
+        }
+
+        // Repeat the last played audio while fading it out.
+        double gain = 1.0 - static_cast<double>(_conceal_position) /
+                                    fade_frames;
+        size_t source = (_conceal_position % history_frames) * num_channels;
+        for (size_t c = 0; c < num_channels; ++c) {
+            frames[i * num_channels + c] =
+                    static_cast<int16_t>(_history[source + c] * gain);
+        }
+        _conceal_position++;
+    }
+}
+
+size_t RTVIJitterBuffer::read_compressed(
+        int16_t* frames,
+        size_t num_frames,
+        size_t excess
+) {
+    size_t num_channels = _options.num_channels;
+    size_t total = num_frames + excess;
+    int16_t* input = _scratch.data();
+
+    _buffer.read(input, total * num_channels);
+
+    // Drop `excess` frames by crossfading the tail of the block with the
+    // audio that follows the dropped region.
+    size_t head = num_frames - excess;
+    std::memcpy(frames, input, head * num_channels * sizeof(int16_t));
+    for (size_t i = 0; i < excess; ++i) {
+        double gain = static_cast<double>(i + 1) / (excess + 1);
+        for (size_t c = 0; c < num_channels; ++c) {
+            double from = input[(head + i) * num_channels + c];
+            double to = input[(num_frames + i) * num_channels + c];
+            frames[(head + i) * num_channels + c] =
+                    static_cast<int16_t>(from * (1.0 - gain) + to * gain);
+        }
+    }
+
+    _compressed_frames.fetch_add(excess, std::memory_order_relaxed);
+
+    return num_frames;
+}
+
+void RTVIJitterBuffer::remember(const int16_t* frames, size_t num_frames) {
+    size_t num_channels = _options.num_channels;
+    size_t history_samples = _history.size();
+    size_t num_samples = num_frames * num_channels;
+
+    if (num_samples >= history_samples) {
+        std::memcpy(
+                _history.data(),
+                frames + num_samples - history_samples,
+                history_samples * sizeof(int16_t)
+        );
+    } else {
+        std::memmove(
+                _history.data(),
+                _history.data() + num_samples,
+                (history_samples - num_samples) * sizeof(int16_t)
+        );
+        std::memcpy(
+                _history.data() + history_samples - num_samples,
+                frames,
+                num_samples * sizeof(int16_t)
+        );
+    }
+}
@@ -0,0 +1,196 @@
+//
+// Copyright (c) 2024, Daily
+//
+
+#include "rtvi_latency.h"
+
+#include "rtvi_utils.h"
+
+#include <algorithm>
+
+using namespace rtvi;
+
+namespace {
+
+constexpr int64_t NOT_REACHED = -1;
+
+size_t stage_index(RTVILatencyStage stage) {
+    return static_cast<size_t>(stage);
+}
+
+}  // namespace
+
+const char* rtvi::latency_stage_name(RTVILatencyStage stage) {
+    switch (stage) {
+    case RTVILatencyStage::TranscriptFinal:
+        return "transcript_final";
+    case RTVILatencyStage::LLMStarted:
+        return "llm_started";
+    case RTVILatencyStage::LLMFirstToken:
+        return "llm_first_token";
+    case RTVILatencyStage::TTSStarted:
+        return "tts_started";
+    case RTVILatencyStage::BotStartedSpeaking:
+        return "bot_started_speaking";
+    case RTVILatencyStage::FirstAudio:
+        return "first_audio";
+    }
+    return "";
+}
+
+RTVILatencyTracker::RTVILatencyTracker(const RTVILatencyOptions& options)
+    : _turns(0),
+      _interrupted_turns(0),
+      _active(false),
+      _waiting_for_audio(false) {
+    auto max_latency = std::chrono::duration_cast<std::chrono::microseconds>(
+            options.max_latency
+    );
+    for (size_t i = 0; i < RTVI_LATENCY_STAGE_COUNT; ++i) {
+        _histograms.emplace_back(
+                max_latency.count(), options.significant_digits
+        );
+    }
+    _last_turn.fill(NOT_REACHED);
+    _turn.fill(NOT_REACHED);
+}
+
+void RTVILatencyTracker::on_message(
+        const RTVIInboundMessage& message,
+        TimePoint now
+) {
+    switch (hash_fnv1a(message.type())) {
+    case hash_fnv1a("user-started-speaking"):
+        on_user_started_speaking(now);
+        break;
+    case hash_fnv1a("user-stopped-speaking"):
+        on_user_stopped_speaking(now);
+        break;
+    case hash_fnv1a("user-transcription"):
+        if (message.data_bool("final").value_or(false)) {
+            mark(RTVILatencyStage::TranscriptFinal, now);
+        }
+        break;
+    case hash_fnv1a("bot-llm-started"):
+        mark(RTVILatencyStage::LLMStarted, now);
+        break;
+    case hash_fnv1a("bot-llm-text"):
+        mark(RTVILatencyStage::LLMFirstToken, now);
+        break;
+    case hash_fnv1a("bot-tts-started"):
+        mark(RTVILatencyStage::TTSStarted, now);
+        break;
+    case hash_fnv1a("bot-started-speaking"):
+        mark(RTVILatencyStage::BotStartedSpeaking, now);
+        break;
+    }
+}
+
+void RTVILatencyTracker::on_bot_audio(
+        const int16_t* samples,
+        size_t num_samples,
+        TimePoint now
+) {
+    if (!_waiting_for_audio.load(std::memory_order_relaxed)) {
+        return;
+    }
+
+    bool silent = std::all_of(samples, samples + num_samples, [](int16_t s) {
+        return s == 0;
+    });
+    if (!silent) {
+        mark(RTVILatencyStage::FirstAudio, now);
+    }
+}
+
+void RTVILatencyTracker::on_user_started_speaking(TimePoint) {
+    std::lock_guard<std::mutex> lock(_mutex);
+    if (_active) {
+        _interrupted_turns++;
+        end_turn();
+    }
+}
+
+void RTVILatencyTracker::on_user_stopped_speaking(TimePoint now) {
+    std::lock_guard<std::mutex> lock(_mutex);
+    // The user paused and went on before the bot said anything.
+    if (_active) {
+        _interrupted_turns++;
+    }
+    _active = true;
+    _turn_start = now;
+    _turn.fill(NOT_REACHED);
+    _waiting_for_audio.store(false, std::memory_order_relaxed);
+}
+
+void RTVILatencyTracker::mark(RTVILatencyStage stage, TimePoint now) {
+    std::lock_guard<std::mutex> lock(_mutex);
+    size_t index = stage_index(stage);
+    if (!_active || _turn[index] != NOT_REACHED) {
+        return;
+    }
+
+    auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(
+            now - _turn_start
+    );
+    _turn[index] = std::max<int64_t>(elapsed.count(), 0);
+    _histograms[index].record(_turn[index]);
+
+    if (stage == RTVILatencyStage::FirstAudio) {
+        _turns++;
+        _last_turn = _turn;
+        end_turn();
+    } else if (stage == RTVILatencyStage::TTSStarted ||
+               stage == RTVILatencyStage::BotStartedSpeaking) {
+        _waiting_for_audio.store(true, std::memory_order_relaxed);
+    }
+}
+
+RTVILatencySnapshot RTVILatencyTracker::snapshot(bool reset) {
+    std::lock_guard<std::mutex> lock(_mutex);
+
+    RTVILatencySnapshot snapshot;
+    snapshot.turns = _turns;
+    snapshot.interrupted_turns = _interrupted_turns;
+    snapshot.last_turn_us = _last_turn;
+    for (size_t i = 0; i < RTVI_LATENCY_STAGE_COUNT; ++i) {
+        const RTVIHistogram& histogram = _histograms[i];
+        snapshot.stages[i] = RTVILatencyStageStats {
+                .count = histogram.count(),
+                .min_us = histogram.min(),
+                .mean_us = static_cast<uint64_t>(histogram.mean()),
+                .p50_us = histogram.percentile(50),
+                .p90_us = histogram.percentile(90),
+                .p99_us = histogram.percentile(99),
+                .max_us = histogram.max(),
+        };
+    }
+
+    if (reset) {
+        for (auto& histogram: _histograms) {
+            histogram.reset();
+        }
+        _turns = 0;
+        _interrupted_turns = 0;
+    }
+
+    return snapshot;
+}
+
+void RTVILatencyTracker::reset() {
+    std::lock_guard<std::mutex> lock(_mutex);
+    for (auto& histogram: _histograms) {
+        histogram.reset();
+    }
+    _turns = 0;
+    _interrupted_turns = 0;
+    _last_turn.fill(NOT_REACHED);
+    end_turn();
+}
+
+// Private
+
+void RTVILatencyTracker::end_turn() {
+    _active = false;
+    _waiting_for_audio.store(false, std::memory_order_relaxed);
+}
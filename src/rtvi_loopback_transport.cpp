@@ -0,0 +1,642 @@
+//
+// Copyright (c) 2024, Daily
+//
+
+#include "rtvi_loopback_transport.h"
+
+#include "rtvi_exceptions.h"
+#include "rtvi_inbound_message.h"
+#include "rtvi_messages.h"
+
+#include <algorithm>
+#include <cmath>
+#include <sstream>
+
+#if !defined(_WIN32)
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <cerrno>
+#endif
+
+using namespace rtvi;
+
+namespace {
+
+constexpr double PI = 3.14159265358979323846;
+constexpr double TONE_HZ = 440.0;
+constexpr double TONE_AMPLITUDE = 0.25;
+
+std::vector<std::string> split_words(const std::string& text) {
+    std::vector<std::string> words;
+    std::istringstream stream(text);
+    std::string word;
+    while (stream >> word) {
+        words.push_back(word);
+    }
+    return words;
+}
+
+std::chrono::microseconds per_second(double rate) {
+    if (rate <= 0) {
+        return std::chrono::microseconds(0);
+    }
+    return std::chrono::microseconds(static_cast<int64_t>(1000000 / rate));
+}
+
+RTVILoopbackEvent event(
+        std::chrono::microseconds delay,
+        const std::string& type,
+        const nlohmann::json& data = nullptr,
+        uint32_t audio_frames = 0
+) {
+    nlohmann::json message = data.is_null()
+                                     ? RTVIMessage::message(type)
+                                     : RTVIMessage::message(type, data);
+    return RTVILoopbackEvent {delay, message.dump(), audio_frames};
+}
+
+nlohmann::json response(
+        std::string_view id,
+        const std::string& type,
+        const nlohmann::json& data
+) {
+    return nlohmann::json {
+            {"id", std::string(id)},
+            {"label", "rtvi-ai"},
+            {"type", type},
+            {"data", data},
+    };
+}
+
+#if !defined(_WIN32)
+
+#if defined(MSG_NOSIGNAL)
+constexpr int SEND_FLAGS = MSG_NOSIGNAL;
+#else
+constexpr int SEND_FLAGS = 0;
+#endif
+
+bool write_all(int fd, const char* data, size_t size) {
+    while (size > 0) {
+        ssize_t result = ::send(fd, data, size, SEND_FLAGS);
+        if (result < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return false;
+        }
+        data += result;
+        size -= result;
+    }
+    return true;
+}
+
+bool read_all(int fd, char* data, size_t size) {
+    while (size > 0) {
+        ssize_t result = ::recv(fd, data, size, 0);
+        if (result < 0 && errno == EINTR) {
+            continue;
+        }
+        if (result <= 0) {
+            return false;
+        }
+        data += result;
+        size -= result;
+    }
+    return true;
+}
+
+// Frames are prefixed with their size, in native byte order since both ends
+// are in the same process.
+bool write_frame(int fd, std::string_view frame) {
+    uint32_t size = static_cast<uint32_t>(frame.size());
+    return write_all(fd, reinterpret_cast<const char*>(&size), sizeof(size)) &&
+           write_all(fd, frame.data(), frame.size());
+}
+
+bool read_frame(int fd, std::string& frame) {
+    uint32_t size;
+    if (!read_all(fd, reinterpret_cast<char*>(&size), sizeof(size))) {
+        return false;
+    }
+    frame.resize(size);
+    return read_all(fd, frame.data(), size);
+}
+
+#endif
+
+}  // namespace
+
+//
+// RTVILoopbackBot
+//
+
+RTVILoopbackBot::RTVILoopbackBot(const RTVILoopbackBotOptions& options)
+    : _options(options),
+      _stopped(true),
+      _audio(static_cast<size_t>(options.audio_format.sample_rate) *
+             options.audio_format.num_channels * options.audio_buffer_ms /
+             1000),
+      _tone_position(0),
+      _finished(false),
+      _turns(0),
+      _frames_sent(0),
+      _frames_received(0),
+      _actions(0),
+      _function_call_results(0),
+      _bot_audio_frames(0),
+      _bot_audio_dropped(0) {
+    // A whole number of cycles, so it loops without clicks.
+    uint32_t sample_rate = _options.audio_format.sample_rate;
+    uint32_t num_channels = _options.audio_format.num_channels;
+    _tone.resize(static_cast<size_t>(sample_rate) * num_channels);
+    for (uint32_t i = 0; i < sample_rate; ++i) {
+        auto sample = static_cast<int16_t>(
+                std::sin(2 * PI * TONE_HZ * i / sample_rate) * TONE_AMPLITUDE *
+                32767
+        );
+        std::fill_n(&_tone[i * num_channels], num_channels, sample);
+    }
+
+    if (_options.script.empty()) {
+        _turn = conversation_turn(_options, false);
+        _function_call_turn = conversation_turn(_options, true);
+    } else {
+        _turn = _options.script;
+    }
+}
+
+RTVILoopbackBot::~RTVILoopbackBot() {
+    stop();
+}
+
+void RTVILoopbackBot::start(Sink sink) {
+    stop();
+
+    std::lock_guard<std::mutex> lock(_mutex);
+    _sink = std::move(sink);
+    _stopped = false;
+    _finished = false;
+    _thread = std::thread(&RTVILoopbackBot::run, this);
+}
+
+void RTVILoopbackBot::stop() {
+    std::unique_lock<std::mutex> lock(_mutex);
+    _stopped = true;
+    lock.unlock();
+
+    _condition.notify_all();
+
+    if (_thread.joinable()) {
+        _thread.join();
+    }
+
+    lock.lock();
+    _inbox.clear();
+}
+
+void RTVILoopbackBot::receive(std::string frame) {
+    _frames_received++;
+
+    std::unique_lock<std::mutex> lock(_mutex);
+    _inbox.push_back(std::move(frame));
+    lock.unlock();
+
+    _condition.notify_one();
+}
+
+size_t RTVILoopbackBot::read_audio(int16_t* data, size_t num_frames) {
+    uint32_t num_channels = _options.audio_format.num_channels;
+    return _audio.read(data, num_frames * num_channels) / num_channels;
+}
+
+RTVILoopbackStats RTVILoopbackBot::stats() const {
+    return RTVILoopbackStats {
+            .turns = _turns,
+            .frames_sent = _frames_sent,
+            .frames_received = _frames_received,
+            .actions = _actions,
+            .function_call_results = _function_call_results,
+            .bot_audio_frames = _bot_audio_frames,
+            .bot_audio_dropped = _bot_audio_dropped,
+            .user_audio_frames = 0,
+    };
+}
+
+std::vector<RTVILoopbackEvent> RTVILoopbackBot::conversation_turn(
+        const RTVILoopbackBotOptions& options,
+        bool function_call
+) {
+    std::vector<RTVILoopbackEvent> events;
+    auto no_delay = std::chrono::microseconds(0);
+
+    // The user speaks, with an interim transcription for each word.
+    auto user_word = per_second(options.user_words_per_second);
+    auto user_words = split_words(options.user_text);
+    events.push_back(event(
+            std::chrono::duration_cast<std::chrono::microseconds>(
+                    options.turn_interval
+            ),
+            "user-started-speaking"
+    ));
+    std::string transcript;
+    for (size_t i = 0; i < user_words.size(); ++i) {
+        transcript += (i > 0 ? " " : "") + user_words[i];
+        events.push_back(event(
+                user_word,
+                "user-transcription",
+                {{"text", transcript},
+                 {"final", false},
+                 {"timestamp", "2024-01-01T00:00:00.000Z"},
+                 {"user_id", "loopback-user"}}
+        ));
+    }
+    // The final transcription comes a bit after the user stops, as it would
+    // from a speech-to-text service.
+    events.push_back(event(no_delay, "user-stopped-speaking"));
+    events.push_back(event(
+            user_word,
+            "user-transcription",
+            {{"text", options.user_text},
+             {"final", true},
+             {"timestamp", "2024-01-01T00:00:00.000Z"},
+             {"user_id", "loopback-user"}}
+    ));
+
+    if (function_call) {
+        events.push_back(event(
+                no_delay,
+                "llm-function-call-start",
+                {{"function_name", options.function_name}}
+        ));
+        events.push_back(event(
+                no_delay,
+                "llm-function-call",
+                {{"function_name", options.function_name},
+                 {"tool_call_id", "loopback-tool-call"},
+                 {"args", options.function_args}}
+        ));
+    }
+
+    // LLM tokens are words here, sent with their leading space.
+    auto token = per_second(options.llm_tokens_per_second);
+    auto bot_words = split_words(options.bot_text);
+    events.push_back(event(no_delay, "bot-llm-started"));
+    for (size_t i = 0; i < bot_words.size(); ++i) {
+        events.push_back(event(
+                token,
+                "bot-llm-text",
+                {{"text", (i > 0 ? " " : "") + bot_words[i]}}
+        ));
+    }
+    events.push_back(event(no_delay, "bot-llm-stopped"));
+
+    // Each TTS word comes with its audio, and the next one is sent once it
+    // has played.
+    auto tts_word = per_second(options.tts_words_per_second);
+    auto word_frames = static_cast<uint32_t>(
+            options.audio_format.sample_rate * tts_word.count() / 1000000
+    );
+    events.push_back(event(no_delay, "bot-tts-started"));
+    events.push_back(event(no_delay, "bot-started-speaking"));
+    for (size_t i = 0; i < bot_words.size(); ++i) {
+        events.push_back(event(
+                i > 0 ? tts_word : no_delay,
+                "bot-tts-text",
+                {{"text", bot_words[i]}},
+                word_frames
+        ));
+    }
+    events.push_back(event(tts_word, "bot-stopped-speaking"));
+    events.push_back(event(no_delay, "bot-tts-stopped"));
+    events.push_back(event(
+            no_delay, "bot-transcription", {{"text", options.bot_text}}
+    ));
+
+    return events;
+}
+
+// Private
+
+void RTVILoopbackBot::run() {
+    auto deadline = std::chrono::steady_clock::now();
+    uint32_t turn = 0;
+    size_t index = 0;
+
+    std::unique_lock<std::mutex> lock(_mutex);
+    while (!_stopped) {
+        if (!_inbox.empty()) {
+            std::string frame = std::move(_inbox.front());
+            _inbox.pop_front();
+            lock.unlock();
+            handle(frame);
+            lock.lock();
+            continue;
+        }
+
+        if (_finished) {
+            _condition.wait(lock);
+            continue;
+        }
+
+        bool function_call = _options.function_call_interval > 0 &&
+                             !_function_call_turn.empty() &&
+                             (turn + 1) % _options.function_call_interval == 0;
+        const auto& events = function_call ? _function_call_turn : _turn;
+
+        if (index >= events.size()) {
+            index = 0;
+            turn++;
+            _turns++;
+            if (events.empty() ||
+                (_options.turns > 0 && turn >= _options.turns)) {
+                _finished = true;
+            }
+            continue;
+        }
+
+        // Deadlines accumulate so pacing doesn't drift.
+        const RTVILoopbackEvent& next = events[index];
+        auto event_deadline = deadline + scaled(next.delay);
+        if (std::chrono::steady_clock::now() < event_deadline) {
+            _condition.wait_until(lock, event_deadline);
+            continue;
+        }
+        deadline = event_deadline;
+        index++;
+
+        lock.unlock();
+        if (next.audio_frames > 0) {
+            write_audio(next.audio_frames);
+        }
+        if (!next.frame.empty()) {
+            send(next.frame);
+        }
+        lock.lock();
+    }
+}
+
+void RTVILoopbackBot::handle(const std::string& frame) {
+    try {
+        RTVIInboundMessage message(frame);
+        std::string_view type = message.type();
+
+        if (type == "client-ready") {
+            send_message(RTVIMessage::message(
+                    "bot-ready",
+                    {{"version", "0.3.0"}, {"about", {{"library", "loopback"}}}}
+            ));
+        } else if (type == "action") {
+            _actions++;
+            nlohmann::json result = true;
+            if (_options.on_action) {
+                result = _options.on_action(message.data());
+            }
+            send_message(response(
+                    message.id(), "action-response", {{"result", result}}
+            ));
+        } else if (type == "llm-function-call-result") {
+            _function_call_results++;
+        } else if (type == "get-config" || type == "update-config") {
+            send_message(response(
+                    message.id(),
+                    "config",
+                    {{"config", nlohmann::json::array()}}
+            ));
+        } else if (type == "describe-config") {
+            send_message(response(
+                    message.id(),
+                    "config-available",
+                    {{"config", nlohmann::json::array()}}
+            ));
+        } else if (type == "describe-actions") {
+            send_message(response(
+                    message.id(),
+                    "actions-available",
+                    {{"actions", nlohmann::json::array()}}
+            ));
+        } else {
+            send_message(response(
+                    message.id(),
+                    "error-response",
+                    {{"error", "unsupported message type"}}
+            ));
+        }
+    } catch (const std::exception& ex) {
+        send_message(RTVIMessage::message(
+                "error",
+                {{"error", std::string("invalid message: ") + ex.what()},
+                 {"fatal", false}}
+        ));
+    }
+}
+
+void RTVILoopbackBot::send(std::string frame) {
+    _frames_sent++;
+    if (_sink) {
+        _sink(std::move(frame));
+    }
+}
+
+void RTVILoopbackBot::send_message(const nlohmann::json& message) {
+    send(message.dump());
+}
+
+void RTVILoopbackBot::write_audio(uint32_t num_frames) {
+    uint32_t sample_rate = _options.audio_format.sample_rate;
+    uint32_t num_channels = _options.audio_format.num_channels;
+
+    // Audio that doesn't fit is dropped, as if the client didn't read it in
+    // time.
+    size_t remaining = std::min<size_t>(
+            num_frames, _audio.free_space() / num_channels
+    );
+    size_t written = 0;
+    while (remaining > 0) {
+        size_t count =
+                std::min<size_t>(remaining, sample_rate - _tone_position);
+        written += _audio.write(
+                           &_tone[_tone_position * num_channels],
+                           count * num_channels
+                   ) /
+                   num_channels;
+        _tone_position = (_tone_position + count) % sample_rate;
+        remaining -= count;
+    }
+
+    _bot_audio_frames += written;
+    _bot_audio_dropped += num_frames - written;
+}
+
+std::chrono::nanoseconds
+RTVILoopbackBot::scaled(std::chrono::microseconds delay) const {
+    return std::chrono::nanoseconds(
+            static_cast<int64_t>(delay.count() * 1000 * _options.time_scale)
+    );
+}
+
+//
+// RTVILoopbackTransport
+//
+
+RTVILoopbackTransport::RTVILoopbackTransport(
+        const RTVILoopbackTransportOptions& options,
+        RTVITransportMessageObserver* observer
+)
+    : _options(options),
+      _observer(observer),
+      _bot(options.bot),
+      _connected(false),
+      _user_audio_frames(0),
+      _sockets {-1, -1} {}
+
+RTVILoopbackTransport::~RTVILoopbackTransport() {
+    disconnect();
+}
+
+RTVILoopbackStats RTVILoopbackTransport::stats() const {
+    RTVILoopbackStats stats = _bot.stats();
+    stats.user_audio_frames = _user_audio_frames;
+    return stats;
+}
+
+void RTVILoopbackTransport::initialize() {}
+
+void RTVILoopbackTransport::connect(const nlohmann::json&) {
+    if (_connected) {
+        return;
+    }
+    if (!_observer) {
+        throw RTVIException("loopback transport has no observer");
+    }
+
+    if (_options.mode == RTVILoopbackMode::InProcess) {
+        _bot.start([this](std::string frame) {
+            _observer->on_transport_frame(std::move(frame));
+        });
+        _connected = true;
+        return;
+    }
+
+#if defined(_WIN32)
+    throw RTVIException("loopback sockets are not supported on Windows");
+#else
+    if (::socketpair(AF_UNIX, SOCK_STREAM, 0, _sockets) != 0) {
+        throw RTVIException("unable to create loopback sockets");
+    }
+#if defined(SO_NOSIGPIPE)
+    int enable = 1;
+    for (int fd: _sockets) {
+        ::setsockopt(fd, SOL_SOCKET, SO_NOSIGPIPE, &enable, sizeof(enable));
+    }
+#endif
+
+    _client_reader = std::thread([this]() {
+        read_frames(_sockets[0], [this](std::string frame) {
+            _observer->on_transport_frame(std::move(frame));
+        });
+    });
+    _bot_reader = std::thread([this]() {
+        read_frames(_sockets[1], [this](std::string frame) {
+            _bot.receive(std::move(frame));
+        });
+    });
+    _bot.start([this](std::string frame) {
+        std::lock_guard<std::mutex> lock(_bot_write_mutex);
+        write_frame(_sockets[1], frame);
+    });
+    _connected = true;
+#endif
+}
+
+void RTVILoopbackTransport::disconnect() {
+    if (!_connected) {
+        return;
+    }
+    _connected = false;
+
+    _bot.stop();
+
+#if !defined(_WIN32)
+    if (_sockets[0] >= 0) {
+        // Wakes up the readers.
+        ::shutdown(_sockets[0], SHUT_RDWR);
+        ::shutdown(_sockets[1], SHUT_RDWR);
+        _client_reader.join();
+        _bot_reader.join();
+        ::close(_sockets[0]);
+        ::close(_sockets[1]);
+        _sockets[0] = -1;
+        _sockets[1] = -1;
+    }
+#endif
+}
+
+void RTVILoopbackTransport::send_message(const nlohmann::json& message) {
+    send_text(message.dump());
+}
+
+bool RTVILoopbackTransport::supports_wire_format(RTVIWireFormat format) const {
+    return format == RTVIWireFormat::Json;
+}
+
+void RTVILoopbackTransport::send_encoded_message(
+        RTVIWireFormat format,
+        const uint8_t* data,
+        size_t size
+) {
+    if (format != RTVIWireFormat::Json) {
+        RTVITransport::send_encoded_message(format, data, size);
+        return;
+    }
+    send_text(std::string(reinterpret_cast<const char*>(data), size));
+}
+
+int32_t RTVILoopbackTransport::send_user_audio(
+        const int16_t*,
+        size_t num_frames
+) {
+    _user_audio_frames += num_frames;
+    return static_cast<int32_t>(num_frames);
+}
+
+int32_t
+RTVILoopbackTransport::read_bot_audio(int16_t* data, size_t num_frames) {
+    return static_cast<int32_t>(_bot.read_audio(data, num_frames));
+}
+
+std::optional<RTVIAudioFormat> RTVILoopbackTransport::audio_format() {
+    return _options.bot.audio_format;
+}
+
+// Private
+
+void RTVILoopbackTransport::send_text(std::string text) {
+    if (!_connected) {
+        throw RTVIException("loopback transport is not connected");
+    }
+
+#if !defined(_WIN32)
+    if (_options.mode == RTVILoopbackMode::Socket) {
+        std::lock_guard<std::mutex> lock(_client_write_mutex);
+        write_frame(_sockets[0], text);
+        return;
+    }
+#endif
+
+    _bot.receive(std::move(text));
+}
+
+void RTVILoopbackTransport::read_frames(
+        int fd,
+        std::function<void(std::string)> f
+) {
+#if !defined(_WIN32)
+    std::string frame;
+    while (read_frame(fd, frame)) {
+        f(std::move(frame));
+        frame = std::string();
+    }
+#endif
+}
@@ -0,0 +1,133 @@
+//
+// Copyright (c) 2024, Daily
+//
+
+#include "rtvi_message_template.h"
+
+#include "rtvi_wire_format.h"
+
+using namespace rtvi;
+
+namespace {
+
+void append(std::string_view text, std::vector<uint8_t>& out) {
+    const uint8_t* data = reinterpret_cast<const uint8_t*>(text.data());
+    out.insert(out.end(), data, data + text.size());
+}
+
+bool needs_escaping(char c) {
+    return c == '"' || c == '\\' || static_cast<unsigned char>(c) < 0x20;
+}
+
+}  // namespace
+
+void rtvi::append_json_string(
+        std::string_view value,
+        std::vector<uint8_t>& out
+) {
+    static const char HEX[] = "0123456789abcdef";
+
+    out.push_back('"');
+
+    // Copy runs of characters that don't need escaping at once.
+    size_t start = 0;
+    for (size_t i = 0; i < value.size(); ++i) {
+        char c = value[i];
+        if (!needs_escaping(c)) {
+            continue;
+        }
+
+        append(value.substr(start, i - start), out);
+        start = i + 1;
+
+        out.push_back('\\');
+        switch (c) {
+        case '"':
+        case '\\':
+            out.push_back(c);
+            break;
+        case '\b':
+            out.push_back('b');
+            break;
+        case '\f':
+            out.push_back('f');
+            break;
+        case '\n':
+            out.push_back('n');
+            break;
+        case '\r':
+            out.push_back('r');
+            break;
+        case '\t':
+            out.push_back('t');
+            break;
+        default:
+            append("u00", out);
+            out.push_back(HEX[(c >> 4) & 0xf]);
+            out.push_back(HEX[c & 0xf]);
+            break;
+        }
+    }
+    append(value.substr(start), out);
+
+    out.push_back('"');
+}
+
+//
+// RTVIActionTemplate
+//
+
+RTVIActionTemplate::RTVIActionTemplate(
+        std::string_view service,
+        std::string_view action
+)
+    : _service(service), _action(action) {
+    std::vector<uint8_t> head;
+    append(R"({"label":"rtvi-ai","type":"action","data":{"service":)", head);
+    append_json_string(service, head);
+    append(R"(,"action":)", head);
+    append_json_string(action, head);
+    append(R"(,"arguments":)", head);
+    _head.assign(head.begin(), head.end());
+}
+
+void RTVIActionTemplate::write_raw(
+        std::string_view id,
+        std::string_view arguments,
+        std::vector<uint8_t>& out
+) const {
+    append(_head, out);
+    append(arguments, out);
+    append(R"(},"id":)", out);
+    append_json_string(id, out);
+    out.push_back('}');
+}
+
+void RTVIActionTemplate::write(
+        std::string_view id,
+        const nlohmann::json& arguments,
+        std::vector<uint8_t>& out
+) const {
+    append(_head, out);
+    encode_message(arguments, RTVIWireFormat::Json, out);
+    append(R"(},"id":)", out);
+    append_json_string(id, out);
+    out.push_back('}');
+}
+
+nlohmann::json RTVIActionTemplate::to_json(
+        std::string_view id,
+        std::string_view arguments
+) const {
+    return nlohmann::json {
+            {"id", id},
+            {"label", "rtvi-ai"},
+            {"type", "action"},
+            {"data",
+             {
+                     {"service", _service},
+                     {"action", _action},
+                     {"arguments", nlohmann::json::parse(arguments)},
+             }},
+    };
+}
@@ -0,0 +1,759 @@
+//
+// Copyright (c) 2024, Daily
+//
+
+#include "rtvi_metrics.h"
+
+#include "json.hpp"
+#include "rtvi_exceptions.h"
+#include "rtvi_utils.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+#include <memory>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+#if !defined(_WIN32)
+#include <netdb.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstring>
+#endif
+
+using namespace rtvi;
+
+namespace {
+
+// Types handled by the client or its helpers. Anything else is "other".
+constexpr const char* MESSAGE_TYPES[] = {
+        "action-response",
+        "bot-llm-started",
+        "bot-llm-stopped",
+        "bot-llm-text",
+        "bot-ready",
+        "bot-started-speaking",
+        "bot-stopped-speaking",
+        "bot-transcription",
+        "bot-tts-started",
+        "bot-tts-stopped",
+        "bot-tts-text",
+        "config",
+        "error",
+        "error-response",
+        "llm-function-call",
+        "llm-function-call-start",
+        "tts-text",
+        "user-started-speaking",
+        "user-stopped-speaking",
+        "user-transcription",
+        "other",
+};
+
+constexpr size_t MESSAGE_TYPE_COUNT = std::size(MESSAGE_TYPES);
+
+constexpr std::array<uint32_t, MESSAGE_TYPE_COUNT> message_type_hashes() {
+    std::array<uint32_t, MESSAGE_TYPE_COUNT> hashes {};
+    for (size_t i = 0; i < MESSAGE_TYPE_COUNT; ++i) {
+        hashes[i] = hash_fnv1a(MESSAGE_TYPES[i]);
+    }
+    return hashes;
+}
+
+constexpr std::array<uint32_t, MESSAGE_TYPE_COUNT> MESSAGE_TYPE_HASHES =
+        message_type_hashes();
+
+size_t message_type_index(std::string_view type) {
+    uint32_t hash = hash_fnv1a(type);
+    for (size_t i = 0; i < MESSAGE_TYPE_COUNT - 1; ++i) {
+        if (MESSAGE_TYPE_HASHES[i] == hash) {
+            return i;
+        }
+    }
+    return MESSAGE_TYPE_COUNT - 1;
+}
+
+struct MetricInfo {
+    const char* name;
+    const char* otlp_name;
+    const char* help;
+    const char* unit;
+    bool gauge;
+};
+
+constexpr MetricInfo MESSAGES_RECEIVED = {
+        "messages_received",
+        "pipecat.messages.received",
+        "Messages received from the bot.",
+        "{message}",
+        false,
+};
+
+constexpr MetricInfo COUNTERS[RTVI_METRIC_COUNTER_COUNT] = {
+        {"messages_sent",
+         "pipecat.messages.sent",
+         "Messages sent to the bot.",
+         "{message}",
+         false},
+        {"actions_sent",
+         "pipecat.actions.sent",
+         "Actions sent to the bot.",
+         "{action}",
+         false},
+        {"actions_completed",
+         "pipecat.actions.completed",
+         "Actions that got a response.",
+         "{action}",
+         false},
+        {"actions_failed",
+         "pipecat.actions.failed",
+         "Actions that failed, timed out or were cancelled.",
+         "{action}",
+         false},
+        {"user_audio_frames",
+         "pipecat.user_audio.frames",
+         "User audio frames sent.",
+         "{frame}",
+         false},
+        {"bot_audio_frames",
+         "pipecat.bot_audio.frames",
+         "Bot audio frames read.",
+         "{frame}",
+         false},
+        {"bot_audio_underruns",
+         "pipecat.bot_audio.underruns",
+         "Bot audio reads that got fewer frames than requested.",
+         "{read}",
+         false},
+        {"queue_pushed",
+         "pipecat.queue.pushed",
+         "Values pushed to queues.",
+         "{value}",
+         false},
+        {"queue_popped",
+         "pipecat.queue.popped",
+         "Values popped from queues.",
+         "{value}",
+         false},
+        {"queue_dropped",
+         "pipecat.queue.dropped",
+         "Values dropped because a queue was full.",
+         "{value}",
+         false},
+        {"queue_depth",
+         "pipecat.queue.depth",
+         "Values currently queued.",
+         "{value}",
+         true},
+};
+
+constexpr MetricInfo DURATIONS[RTVI_METRIC_DURATION_COUNT] = {
+        {"message_dispatch",
+         "pipecat.message.dispatch.duration",
+         "Time from the arrival of a message until it's handled.",
+         "ns",
+         false},
+        {"message_callback",
+         "pipecat.message.callback.duration",
+         "Time spent handling a message.",
+         "ns",
+         false},
+        {"action_round_trip",
+         "pipecat.action.round_trip.duration",
+         "Time from sending an action until its response.",
+         "ns",
+         false},
+};
+
+// Prometheus buckets, from about 1us to 68s.
+constexpr size_t PROMETHEUS_FIRST_BUCKET = 10;
+constexpr size_t PROMETHEUS_LAST_BUCKET = 36;
+
+// Each thread's metrics. Only that thread writes them, so updates are plain
+// loads and stores, and atomics only make concurrent snapshots safe.
+struct alignas(64) ThreadMetrics {
+    struct Duration {
+        std::atomic<uint64_t> count;
+        std::atomic<uint64_t> sum_ns;
+        std::atomic<uint64_t> buckets[RTVI_METRIC_BUCKET_COUNT];
+    };
+
+    ThreadMetrics() {
+        for (auto& counter: counters) {
+            counter.store(0, std::memory_order_relaxed);
+        }
+        for (auto& message: messages) {
+            message.store(0, std::memory_order_relaxed);
+        }
+        for (auto& duration: durations) {
+            duration.count.store(0, std::memory_order_relaxed);
+            duration.sum_ns.store(0, std::memory_order_relaxed);
+            for (auto& bucket: duration.buckets) {
+                bucket.store(0, std::memory_order_relaxed);
+            }
+        }
+    }
+
+    std::atomic<int64_t> counters[RTVI_METRIC_COUNTER_COUNT];
+    std::atomic<uint64_t> messages[MESSAGE_TYPE_COUNT];
+    Duration durations[RTVI_METRIC_DURATION_COUNT];
+};
+
+template<typename T>
+void add_value(std::atomic<T>& target, T value) {
+    target.store(
+            target.load(std::memory_order_relaxed) + value,
+            std::memory_order_relaxed
+    );
+}
+
+struct Registry {
+    std::mutex mutex;
+    std::vector<std::unique_ptr<ThreadMetrics>> blocks;
+    std::vector<ThreadMetrics*> free_blocks;
+    std::chrono::system_clock::time_point start_time =
+            std::chrono::system_clock::now();
+};
+
+// Never destroyed, so threads can still release their blocks during exit.
+Registry& registry() {
+    static Registry* registry = new Registry();
+    return *registry;
+}
+
+class ThreadMetricsHandle {
+   public:
+    ThreadMetricsHandle() {
+        Registry& r = registry();
+        std::lock_guard<std::mutex> lock(r.mutex);
+        if (r.free_blocks.empty()) {
+            r.blocks.push_back(std::make_unique<ThreadMetrics>());
+            metrics = r.blocks.back().get();
+        } else {
+            metrics = r.free_blocks.back();
+            r.free_blocks.pop_back();
+        }
+    }
+
+    ~ThreadMetricsHandle() {
+        Registry& r = registry();
+        std::lock_guard<std::mutex> lock(r.mutex);
+        r.free_blocks.push_back(metrics);
+    }
+
+    ThreadMetrics* metrics;
+};
+
+ThreadMetrics& thread_metrics() {
+    thread_local ThreadMetricsHandle handle;
+    return *handle.metrics;
+}
+
+// Index of the highest bit set. `value` must not be zero.
+uint32_t highest_bit(uint64_t value) {
+#if defined(_MSC_VER)
+    unsigned long index;
+    _BitScanReverse64(&index, value);
+    return index;
+#else
+    return 63 - __builtin_clzll(value);
+#endif
+}
+
+size_t bucket_index(uint64_t value_ns) {
+    if (value_ns <= 1) {
+        return 0;
+    }
+    return std::min<size_t>(
+            highest_bit(value_ns - 1) + 1, RTVI_METRIC_BUCKET_COUNT - 1
+    );
+}
+
+uint64_t unix_nanos(std::chrono::system_clock::time_point time) {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+                   time.time_since_epoch()
+    )
+            .count();
+}
+
+std::string format_double(double value) {
+    char buffer[32];
+    std::snprintf(buffer, sizeof(buffer), "%.9g", value);
+    return buffer;
+}
+
+std::string prometheus_name(const MetricInfo& info) {
+    return std::string("pipecat_") + info.name;
+}
+
+nlohmann::json otlp_attribute(const char* key, std::string_view value) {
+    return {
+            {"key", key},
+            {"value", {{"stringValue", std::string(value)}}},
+    };
+}
+
+nlohmann::json otlp_sum(
+        const MetricInfo& info,
+        nlohmann::json data_points,
+        bool monotonic
+) {
+    return {
+            {"name", info.otlp_name},
+            {"description", info.help},
+            {"unit", info.unit},
+            {"sum",
+             {
+                     // Cumulative.
+                     {"aggregationTemporality", 2},
+                     {"isMonotonic", monotonic},
+                     {"dataPoints", std::move(data_points)},
+             }},
+    };
+}
+
+#if !defined(_WIN32)
+
+#if defined(MSG_NOSIGNAL)
+constexpr int SEND_FLAGS = MSG_NOSIGNAL;
+#else
+constexpr int SEND_FLAGS = 0;
+#endif
+
+int connect_unix(const std::string& path) {
+    sockaddr_un address = {};
+    if (path.size() >= sizeof(address.sun_path)) {
+        throw RTVIException("metrics socket path is too long: " + path);
+    }
+    address.sun_family = AF_UNIX;
+    std::memcpy(address.sun_path, path.c_str(), path.size() + 1);
+
+    int fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0) {
+        throw RTVIException("unable to create metrics socket");
+    }
+    auto* addr = reinterpret_cast<sockaddr*>(&address);
+    if (::connect(fd, addr, sizeof(address)) != 0) {
+        ::close(fd);
+        throw RTVIException("unable to connect to metrics socket " + path);
+    }
+    return fd;
+}
+
+int connect_tcp(const std::string& destination) {
+    size_t colon = destination.rfind(':');
+    if (colon == std::string::npos) {
+        throw RTVIException("invalid metrics address: " + destination);
+    }
+    std::string host = destination.substr(0, colon);
+    std::string port = destination.substr(colon + 1);
+
+    addrinfo hints = {};
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    addrinfo* addresses = nullptr;
+    if (::getaddrinfo(host.c_str(), port.c_str(), &hints, &addresses) != 0) {
+        throw RTVIException(
+                "unable to resolve metrics address: " + destination
+        );
+    }
+
+    int fd = -1;
+    for (addrinfo* a = addresses; a != nullptr; a = a->ai_next) {
+        fd = ::socket(a->ai_family, a->ai_socktype, a->ai_protocol);
+        if (fd < 0) {
+            continue;
+        }
+        if (::connect(fd, a->ai_addr, a->ai_addrlen) == 0) {
+            break;
+        }
+        ::close(fd);
+        fd = -1;
+    }
+    ::freeaddrinfo(addresses);
+
+    if (fd < 0) {
+        throw RTVIException(
+                "unable to connect to metrics address " + destination
+        );
+    }
+    return fd;
+}
+
+#endif
+
+}  // namespace
+
+void RTVIMetrics::set_enabled(bool enabled) {
+    // Sets the start time of the cumulative metrics.
+    registry();
+    _enabled.store(enabled, std::memory_order_relaxed);
+}
+
+void RTVIMetrics::add(RTVIMetricCounter counter, int64_t value) {
+    add_value(
+            thread_metrics().counters[static_cast<size_t>(counter)], value
+    );
+}
+
+void RTVIMetrics::add_message(std::string_view type) {
+    add_value<uint64_t>(
+            thread_metrics().messages[message_type_index(type)], 1
+    );
+}
+
+void RTVIMetrics::record(
+        RTVIMetricDuration duration,
+        std::chrono::nanoseconds value
+) {
+    uint64_t value_ns = std::max<int64_t>(value.count(), 0);
+    ThreadMetrics::Duration& d =
+            thread_metrics().durations[static_cast<size_t>(duration)];
+    add_value<uint64_t>(d.count, 1);
+    add_value(d.sum_ns, value_ns);
+    add_value<uint64_t>(d.buckets[bucket_index(value_ns)], 1);
+}
+
+RTVIMetricsSnapshot RTVIMetrics::snapshot() {
+    Registry& r = registry();
+
+    RTVIMetricsSnapshot snapshot = {};
+    snapshot.start_time = r.start_time;
+    snapshot.time = std::chrono::system_clock::now();
+
+    uint64_t messages[MESSAGE_TYPE_COUNT] = {};
+
+    std::lock_guard<std::mutex> lock(r.mutex);
+    for (const auto& block: r.blocks) {
+        for (size_t i = 0; i < RTVI_METRIC_COUNTER_COUNT; ++i) {
+            snapshot.counters[i] +=
+                    block->counters[i].load(std::memory_order_relaxed);
+        }
+        for (size_t i = 0; i < MESSAGE_TYPE_COUNT; ++i) {
+            messages[i] += block->messages[i].load(std::memory_order_relaxed);
+        }
+        for (size_t i = 0; i < RTVI_METRIC_DURATION_COUNT; ++i) {
+            const ThreadMetrics::Duration& d = block->durations[i];
+            RTVIMetricHistogram& histogram = snapshot.durations[i];
+            histogram.count += d.count.load(std::memory_order_relaxed);
+            histogram.sum_ns += d.sum_ns.load(std::memory_order_relaxed);
+            for (size_t j = 0; j < RTVI_METRIC_BUCKET_COUNT; ++j) {
+                histogram.buckets[j] +=
+                        d.buckets[j].load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    for (size_t i = 0; i < MESSAGE_TYPE_COUNT; ++i) {
+        if (messages[i] > 0) {
+            snapshot.messages_received.emplace_back(
+                    MESSAGE_TYPES[i], messages[i]
+            );
+        }
+    }
+
+    return snapshot;
+}
+
+const char* rtvi::metric_counter_name(RTVIMetricCounter counter) {
+    return COUNTERS[static_cast<size_t>(counter)].name;
+}
+
+const char* rtvi::metric_duration_name(RTVIMetricDuration duration) {
+    return DURATIONS[static_cast<size_t>(duration)].name;
+}
+
+std::string rtvi::format_prometheus(const RTVIMetricsSnapshot& snapshot) {
+    std::string out;
+
+    std::string received = prometheus_name(MESSAGES_RECEIVED) + "_total";
+    out += "# HELP " + received + " " + MESSAGES_RECEIVED.help + "\n";
+    out += "# TYPE " + received + " counter\n";
+    for (const auto& [type, count]: snapshot.messages_received) {
+        out += received + "{type=\"";
+        out += type;
+        out += "\"} " + std::to_string(count) + "\n";
+    }
+
+    for (size_t i = 0; i < RTVI_METRIC_COUNTER_COUNT; ++i) {
+        const MetricInfo& info = COUNTERS[i];
+        std::string name = prometheus_name(info);
+        if (!info.gauge) {
+            name += "_total";
+        }
+        out += "# HELP " + name + " " + info.help + "\n";
+        out += "# TYPE " + name + (info.gauge ? " gauge\n" : " counter\n");
+        out += name + " " + std::to_string(snapshot.counters[i]) + "\n";
+    }
+
+    for (size_t i = 0; i < RTVI_METRIC_DURATION_COUNT; ++i) {
+        const MetricInfo& info = DURATIONS[i];
+        const RTVIMetricHistogram& histogram = snapshot.durations[i];
+        std::string name = prometheus_name(info) + "_seconds";
+        out += "# HELP " + name + " " + info.help + "\n";
+        out += "# TYPE " + name + " histogram\n";
+
+        uint64_t cumulative = 0;
+        for (size_t j = 0; j < PROMETHEUS_FIRST_BUCKET; ++j) {
+            cumulative += histogram.buckets[j];
+        }
+        for (size_t j = PROMETHEUS_FIRST_BUCKET; j <= PROMETHEUS_LAST_BUCKET;
+             ++j) {
+            cumulative += histogram.buckets[j];
+            double le = static_cast<double>(uint64_t(1) << j) / 1e9;
+            out += name + "_bucket{le=\"" + format_double(le) + "\"} " +
+                   std::to_string(cumulative) + "\n";
+        }
+        out += name + "_bucket{le=\"+Inf\"} " +
+               std::to_string(histogram.count) + "\n";
+        out += name + "_sum " +
+               format_double(static_cast<double>(histogram.sum_ns) / 1e9) +
+               "\n";
+        out += name + "_count " + std::to_string(histogram.count) + "\n";
+    }
+
+    return out;
+}
+
+std::string rtvi::format_otlp_json(
+        const RTVIMetricsSnapshot& snapshot,
+        const std::string& service_name
+) {
+    std::string start = std::to_string(unix_nanos(snapshot.start_time));
+    std::string now = std::to_string(unix_nanos(snapshot.time));
+
+    nlohmann::json metrics = nlohmann::json::array();
+
+    nlohmann::json messages = nlohmann::json::array();
+    for (const auto& [type, count]: snapshot.messages_received) {
+        messages.push_back({
+                {"attributes", {otlp_attribute("type", type)}},
+                {"startTimeUnixNano", start},
+                {"timeUnixNano", now},
+                {"asInt", std::to_string(count)},
+        });
+    }
+    metrics.push_back(otlp_sum(MESSAGES_RECEIVED, std::move(messages), true));
+
+    for (size_t i = 0; i < RTVI_METRIC_COUNTER_COUNT; ++i) {
+        const MetricInfo& info = COUNTERS[i];
+        nlohmann::json point = {
+                {"startTimeUnixNano", start},
+                {"timeUnixNano", now},
+                {"asInt", std::to_string(snapshot.counters[i])},
+        };
+        metrics.push_back(otlp_sum(info, {point}, !info.gauge));
+    }
+
+    for (size_t i = 0; i < RTVI_METRIC_DURATION_COUNT; ++i) {
+        const MetricInfo& info = DURATIONS[i];
+        const RTVIMetricHistogram& histogram = snapshot.durations[i];
+
+        // At scale 0, OTLP bucket `k` has (2^k, 2^(k+1)], so ours is `k + 1`.
+        const auto& buckets = histogram.buckets;
+        auto nonzero = [](uint64_t count) { return count > 0; };
+        auto first = std::find_if(buckets.begin(), buckets.end(), nonzero);
+        auto last = std::find_if(buckets.rbegin(), buckets.rend(), nonzero);
+
+        nlohmann::json bucket_counts = nlohmann::json::array();
+        if (first != buckets.end()) {
+            for (auto it = first; it != last.base(); ++it) {
+                bucket_counts.push_back(std::to_string(*it));
+            }
+        }
+        int offset = static_cast<int>(first - buckets.begin()) - 1;
+
+        nlohmann::json point = {
+                {"startTimeUnixNano", start},
+                {"timeUnixNano", now},
+                {"count", std::to_string(histogram.count)},
+                {"sum", static_cast<double>(histogram.sum_ns)},
+                {"scale", 0},
+                {"zeroCount", "0"},
+                {"positive",
+                 {
+                         {"offset", offset},
+                         {"bucketCounts", std::move(bucket_counts)},
+                 }},
+        };
+        metrics.push_back({
+                {"name", info.otlp_name},
+                {"description", info.help},
+                {"unit", info.unit},
+                {"exponentialHistogram",
+                 {
+                         {"aggregationTemporality", 2},
+                         {"dataPoints", {point}},
+                 }},
+        });
+    }
+
+    nlohmann::json request = {
+            {"resourceMetrics",
+             {{
+                     {"resource",
+                      {{"attributes",
+                        {otlp_attribute("service.name", service_name)}}}},
+                     {"scopeMetrics",
+                      {{
+                              {"scope", {{"name", "pipecat"}}},
+                              {"metrics", std::move(metrics)},
+                      }}},
+             }}},
+    };
+    return request.dump();
+}
+
+RTVIMetricsExporter::RTVIMetricsExporter(
+        const RTVIMetricsExporterOptions& options
+)
+    : _options(options), _running(false), _failed_exports(0) {
+    if (_options.destination.empty()) {
+        throw RTVIException("metrics exporter needs a destination");
+    }
+}
+
+RTVIMetricsExporter::~RTVIMetricsExporter() {
+    stop();
+}
+
+void RTVIMetricsExporter::start() {
+    std::lock_guard<std::mutex> lock(_mutex);
+    if (_running) {
+        return;
+    }
+    _running = true;
+    _thread = std::thread(&RTVIMetricsExporter::run, this);
+}
+
+void RTVIMetricsExporter::stop() {
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        if (!_running) {
+            return;
+        }
+        _running = false;
+    }
+    _condition.notify_all();
+    _thread.join();
+
+    try {
+        export_now();
+    } catch (const RTVIException&) {
+        _failed_exports++;
+    }
+}
+
+void RTVIMetricsExporter::export_now() {
+    RTVIMetricsSnapshot snapshot = RTVIMetrics::snapshot();
+
+    std::string payload;
+    if (_options.format == RTVIMetricsFormat::Prometheus) {
+        payload = format_prometheus(snapshot);
+    } else {
+        payload = format_otlp_json(snapshot, _options.service_name) + "\n";
+    }
+
+    std::lock_guard<std::mutex> lock(_export_mutex);
+    const std::string& destination = _options.destination;
+    if (destination.rfind("unix:", 0) == 0 ||
+        destination.rfind("tcp:", 0) == 0) {
+        write_socket(payload);
+    } else {
+        write_file(payload);
+    }
+}
+
+// Private
+
+void RTVIMetricsExporter::run() {
+    std::unique_lock<std::mutex> lock(_mutex);
+    while (_running) {
+        if (_options.interval.count() == 0) {
+            _condition.wait(lock, [this] { return !_running; });
+            break;
+        }
+
+        bool stopped = _condition.wait_for(lock, _options.interval, [this] {
+            return !_running;
+        });
+        if (stopped) {
+            break;
+        }
+
+        lock.unlock();
+        try {
+            export_now();
+        } catch (const RTVIException&) {
+            _failed_exports++;
+        }
+        lock.lock();
+    }
+}
+
+void RTVIMetricsExporter::write_file(const std::string& payload) {
+    const std::string& path = _options.destination;
+
+    if (_options.format == RTVIMetricsFormat::OtlpJson) {
+        std::ofstream file(path, std::ios::binary | std::ios::app);
+        file << payload;
+        if (!file.good()) {
+            throw RTVIException("unable to write metrics to " + path);
+        }
+        return;
+    }
+
+    // Readers never see a partially written file.
+    std::string temp_path = path + ".tmp";
+    {
+        std::ofstream file(temp_path, std::ios::binary | std::ios::trunc);
+        file << payload;
+        if (!file.good()) {
+            throw RTVIException("unable to write metrics to " + temp_path);
+        }
+    }
+#if defined(_WIN32)
+    std::remove(path.c_str());
+#endif
+    if (std::rename(temp_path.c_str(), path.c_str()) != 0) {
+        throw RTVIException("unable to write metrics to " + path);
+    }
+}
+
+void RTVIMetricsExporter::write_socket(const std::string& payload) {
+#if defined(_WIN32)
+    throw RTVIException("metrics sockets are not supported on Windows");
+#else
+    const std::string& destination = _options.destination;
+    int fd = destination.rfind("unix:", 0) == 0
+                     ? connect_unix(destination.substr(5))
+                     : connect_tcp(destination.substr(4));
+#if defined(SO_NOSIGPIPE)
+    int enable = 1;
+    ::setsockopt(fd, SOL_SOCKET, SO_NOSIGPIPE, &enable, sizeof(enable));
+#endif
+
+    const char* data = payload.data();
+    size_t size = payload.size();
+    while (size > 0) {
+        ssize_t result = ::send(fd, data, size, SEND_FLAGS);
+        if (result < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            ::close(fd);
+            throw RTVIException("unable to send metrics to " + destination);
+        }
+        data += result;
+        size -= result;
+    }
+    ::close(fd);
+#endif
+}
@@ -0,0 +1,114 @@
+//
+// Copyright (c) 2024, Daily
+//
+
+#include "rtvi_mpmc_queue.h"
+
+#include <climits>
+
+#if defined(__linux__)
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+#endif
+
+using namespace rtvi;
+
+#if defined(__linux__)
+static uint32_t* futex_address(std::atomic<uint32_t>& value) {
+    static_assert(
+            sizeof(std::atomic<uint32_t>) == sizeof(uint32_t),
+            "futex requires a plain 32-bit word"
+    );
+    return reinterpret_cast<uint32_t*>(&value);
+}
+#endif
+
+void RTVIEventCount::wait(Key key) {
+#if defined(__linux__)
+    while (_epoch.load(std::memory_order_seq_cst) == key) {
+        syscall(SYS_futex,
+                futex_address(_epoch),
+                FUTEX_WAIT_PRIVATE,
+                key,
+                nullptr,
+                nullptr,
+                0);
+    }
+#else
+    std::unique_lock<std::mutex> lock(_mutex);
+    _condition.wait(lock, [this, key] {
+        return _epoch.load(std::memory_order_seq_cst) != key;
+    });
+#endif
+    _waiters.fetch_sub(1, std::memory_order_seq_cst);
+}
+
+bool RTVIEventCount::wait_until(
+        Key key,
+        std::chrono::steady_clock::time_point deadline
+) {
+    bool notified = true;
+#if defined(__linux__)
+    while (_epoch.load(std::memory_order_seq_cst) == key) {
+        auto now = std::chrono::steady_clock::now();
+        if (now >= deadline) {
+            notified = false;
+            break;
+        }
+        auto timeout = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                deadline - now
+        );
+        timespec ts;
+        ts.tv_sec = timeout.count() / 1000000000;
+        ts.tv_nsec = timeout.count() % 1000000000;
+        syscall(SYS_futex,
+                futex_address(_epoch),
+                FUTEX_WAIT_PRIVATE,
+                key,
+                &ts,
+                nullptr,
+                0);
+    }
+#else
+    std::unique_lock<std::mutex> lock(_mutex);
+    notified = _condition.wait_until(lock, deadline, [this, key] {
+        return _epoch.load(std::memory_order_seq_cst) != key;
+    });
+#endif
+    _waiters.fetch_sub(1, std::memory_order_seq_cst);
+    return notified;
+}
+
+void RTVIEventCount::notify(bool all) {
+    // Pairs with `prepare_wait()`: either the waiter sees the new state when
+    // it checks the condition again, or we see the waiter here.
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (_waiters.load(std::memory_order_seq_cst) == 0) {
+        return;
+    }
+    _epoch.fetch_add(1, std::memory_order_seq_cst);
+    wake(all);
+}
+
+void RTVIEventCount::wake(bool all) {
+#if defined(__linux__)
+    syscall(SYS_futex,
+            futex_address(_epoch),
+            FUTEX_WAKE_PRIVATE,
+            all ? INT_MAX : 1,
+            nullptr,
+            nullptr,
+            0);
+#else
+    // Taking the lock makes sure a waiter can't miss the notification
+    // between checking the epoch and blocking.
+    std::lock_guard<std::mutex> lock(_mutex);
+    if (all) {
+        _condition.notify_all();
+    } else {
+        _condition.notify_one();
+    }
+#endif
+}
@@ -0,0 +1,244 @@
+//
+// Copyright (c) 2024, Daily
+//
+
+#include "rtvi_reactor.h"
+
+#include <algorithm>
+#include <future>
+
+#if defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+using namespace rtvi;
+
+static void pin_thread(std::thread& thread, int cpu) {
+#if defined(__linux__)
+    cpu_set_t cpu_set;
+    CPU_ZERO(&cpu_set);
+    CPU_SET(cpu, &cpu_set);
+    pthread_setaffinity_np(thread.native_handle(), sizeof(cpu_set), &cpu_set);
+#else
+    (void) thread;
+    (void) cpu;
+#endif
+}
+
+RTVIReactor::RTVIReactor(
+        uint32_t index,
+        int cpu,
+        std::chrono::milliseconds timer_resolution
+)
+    : _index(index),
+      _cpu(cpu),
+      _start(std::chrono::steady_clock::now()),
+      _wheel(timer_resolution, 1024, _start),
+      _stopped(false),
+      _num_tasks(0),
+      _num_timers(0),
+      _num_failed(0),
+      _busy_us(0) {
+    _thread = std::thread(&RTVIReactor::run, this);
+    if (_cpu >= 0) {
+        pin_thread(_thread, _cpu);
+    }
+}
+
+RTVIReactor::~RTVIReactor() {
+    stop();
+}
+
+bool RTVIReactor::post(Task task, RTVIReactorLoad* load) {
+    std::unique_lock<std::mutex> lock(_mutex);
+    if (_stopped) {
+        return false;
+    }
+    _tasks.push_back(Entry {std::move(task), load});
+    lock.unlock();
+
+    _condition.notify_one();
+    return true;
+}
+
+RTVITimerId RTVIReactor::schedule(
+        std::chrono::milliseconds delay,
+        Task task,
+        RTVIReactorLoad* load
+) {
+    auto timer = [this, task = std::move(task), load]() mutable {
+        _num_timers.fetch_add(1, std::memory_order_relaxed);
+        run_task(task, load);
+    };
+
+    std::unique_lock<std::mutex> lock(_mutex);
+    if (_stopped) {
+        return RTVI_INVALID_TIMER_ID;
+    }
+    RTVITimerId id = _wheel.schedule(delay, std::move(timer));
+    lock.unlock();
+
+    // The reactor might be waiting for a later timer.
+    _condition.notify_one();
+    return id;
+}
+
+bool RTVIReactor::cancel(RTVITimerId id) {
+    std::lock_guard<std::mutex> lock(_mutex);
+    return _wheel.cancel(id);
+}
+
+void RTVIReactor::run_sync(Task task) {
+    if (in_reactor_thread()) {
+        task();
+        return;
+    }
+
+    // Tasks posted before stopping still run, so this never waits forever.
+    std::promise<void> done;
+    bool posted = post([&task, &done] {
+        try {
+            task();
+            done.set_value();
+        } catch (...) {
+            done.set_exception(std::current_exception());
+        }
+    });
+    if (posted) {
+        done.get_future().get();
+    }
+}
+
+bool RTVIReactor::in_reactor_thread() const {
+    return std::this_thread::get_id() == _thread.get_id();
+}
+
+void RTVIReactor::stop() {
+    std::unique_lock<std::mutex> lock(_mutex);
+    _stopped = true;
+    lock.unlock();
+
+    _condition.notify_all();
+
+    if (_thread.joinable()) {
+        _thread.join();
+    }
+
+    lock.lock();
+    _wheel.clear();
+}
+
+RTVIReactorStats RTVIReactor::stats() const {
+    std::unique_lock<std::mutex> lock(_mutex);
+    size_t queue_depth = _tasks.size();
+    size_t pending_timers = _wheel.size();
+    lock.unlock();
+
+    auto uptime = std::chrono::steady_clock::now() - _start;
+
+    return RTVIReactorStats {
+            .index = _index,
+            .cpu = _cpu,
+            .tasks = _num_tasks.load(),
+            .timers = _num_timers.load(),
+            .failed = _num_failed.load(),
+            .busy_us = _busy_us.load(),
+            .uptime_us = static_cast<uint64_t>(
+                    std::chrono::duration_cast<std::chrono::microseconds>(
+                            uptime
+                    )
+                            .count()
+            ),
+            .queue_depth = queue_depth,
+            .pending_timers = pending_timers,
+    };
+}
+
+std::vector<int> RTVIReactor::available_cpus() {
+    std::vector<int> cpus;
+#if defined(__linux__)
+    cpu_set_t cpu_set;
+    CPU_ZERO(&cpu_set);
+    if (sched_getaffinity(0, sizeof(cpu_set), &cpu_set) == 0) {
+        for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu) {
+            if (CPU_ISSET(cpu, &cpu_set)) {
+                cpus.push_back(cpu);
+            }
+        }
+    }
+#endif
+    if (cpus.empty()) {
+        int num_cpus = std::max(std::thread::hardware_concurrency(), 1u);
+        for (int cpu = 0; cpu < num_cpus; ++cpu) {
+            cpus.push_back(cpu);
+        }
+    }
+    return cpus;
+}
+
+// Private
+
+void RTVIReactor::run() {
+    std::vector<RTVITimerWheel::Callback> expired;
+    std::deque<Entry> tasks;
+
+    std::unique_lock<std::mutex> lock(_mutex);
+    bool stopped = false;
+    while (!stopped) {
+        if (_tasks.empty() && !_stopped) {
+            if (_wheel.empty()) {
+                _condition.wait(lock);
+            } else {
+                _condition.wait_until(lock, _wheel.next_expiry());
+            }
+        }
+
+        // Tasks can't be posted once stopped, so this is the last round.
+        stopped = _stopped;
+        tasks.swap(_tasks);
+        if (!stopped) {
+            _wheel.advance(std::chrono::steady_clock::now(), expired);
+        }
+        lock.unlock();
+
+        for (Entry& entry: tasks) {
+            _num_tasks.fetch_add(1, std::memory_order_relaxed);
+            run_task(entry.task, entry.load);
+        }
+        tasks.clear();
+
+        for (auto& callback: expired) {
+            callback();
+        }
+        expired.clear();
+
+        lock.lock();
+    }
+}
+
+void RTVIReactor::run_task(Task& task, RTVIReactorLoad* load) {
+    auto start = std::chrono::steady_clock::now();
+    bool failed = false;
+    try {
+        task();
+    } catch (...) {
+        failed = true;
+    }
+    auto end = std::chrono::steady_clock::now();
+
+    uint64_t busy_us =
+            std::chrono::duration_cast<std::chrono::microseconds>(end - start)
+                    .count();
+    _busy_us.fetch_add(busy_us, std::memory_order_relaxed);
+    if (failed) {
+        _num_failed.fetch_add(1, std::memory_order_relaxed);
+    }
+    if (load) {
+        load->tasks.fetch_add(1, std::memory_order_relaxed);
+        load->busy_us.fetch_add(busy_us, std::memory_order_relaxed);
+        if (failed) {
+            load->failed.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+}
@@ -0,0 +1,170 @@
+//
+// Copyright (c) 2024, Daily
+//
+
+#include "rtvi_replay_transport.h"
+
+#include "rtvi_exceptions.h"
+
+#include <algorithm>
+
+using namespace rtvi;
+
+RTVIReplayTransport::RTVIReplayTransport(
+        const RTVIReplayTransportOptions& options,
+        RTVITransportMessageObserver* observer
+)
+    : _options(options),
+      _observer(observer),
+      _log(options.path),
+      _bot_audio(static_cast<size_t>(_log.audio_format().sample_rate) *
+                 options.audio_buffer_ms / 1000 *
+                 _log.audio_format().num_channels),
+      _stopped(true),
+      _finished(false),
+      _messages_replayed(0),
+      _bot_audio_frames(0),
+      _bot_audio_dropped(0),
+      _messages_sent(0),
+      _user_audio_frames(0) {
+    if (_options.speed < 0) {
+        throw RTVIException("replay speed must not be negative");
+    }
+}
+
+RTVIReplayTransport::~RTVIReplayTransport() {
+    disconnect();
+}
+
+RTVIReplayStats RTVIReplayTransport::stats() const {
+    return RTVIReplayStats {
+            .messages_replayed = _messages_replayed,
+            .bot_audio_frames = _bot_audio_frames,
+            .bot_audio_dropped = _bot_audio_dropped,
+            .messages_sent = _messages_sent,
+            .user_audio_frames = _user_audio_frames,
+    };
+}
+
+void RTVIReplayTransport::initialize() {}
+
+void RTVIReplayTransport::connect(const nlohmann::json&) {
+    if (!_observer) {
+        throw RTVIException("replay transport has no observer");
+    }
+
+    std::lock_guard<std::mutex> lock(_mutex);
+    if (!_stopped) {
+        return;
+    }
+
+    // Every connection replays the whole session.
+    _log.rewind();
+    _bot_audio.clear();
+    _finished = false;
+    _stopped = false;
+    _thread = std::thread(&RTVIReplayTransport::run, this);
+}
+
+void RTVIReplayTransport::disconnect() {
+    std::unique_lock<std::mutex> lock(_mutex);
+    _stopped = true;
+    lock.unlock();
+
+    _condition.notify_all();
+
+    if (_thread.joinable()) {
+        _thread.join();
+    }
+}
+
+void RTVIReplayTransport::send_message(const nlohmann::json&) {
+    _messages_sent++;
+}
+
+bool RTVIReplayTransport::supports_wire_format(RTVIWireFormat) const {
+    return true;
+}
+
+void RTVIReplayTransport::send_encoded_message(
+        RTVIWireFormat,
+        const uint8_t*,
+        size_t
+) {
+    _messages_sent++;
+}
+
+int32_t RTVIReplayTransport::send_user_audio(
+        const int16_t*,
+        size_t num_frames
+) {
+    _user_audio_frames += num_frames;
+    return static_cast<int32_t>(num_frames);
+}
+
+int32_t RTVIReplayTransport::read_bot_audio(int16_t* data, size_t num_frames) {
+    uint32_t num_channels = _log.audio_format().num_channels;
+    return static_cast<int32_t>(
+            _bot_audio.read(data, num_frames * num_channels) / num_channels
+    );
+}
+
+std::optional<RTVIAudioFormat> RTVIReplayTransport::audio_format() {
+    return _log.audio_format();
+}
+
+// Private
+
+void RTVIReplayTransport::run() {
+    auto start = std::chrono::steady_clock::now();
+
+    RTVISessionRecord record;
+    std::unique_lock<std::mutex> lock(_mutex);
+    while (!_stopped && _log.next(record)) {
+        if (_options.speed > 0) {
+            auto offset = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                    record.time / _options.speed
+            );
+            _condition.wait_until(lock, start + offset, [this] {
+                return _stopped;
+            });
+            if (_stopped) {
+                break;
+            }
+        }
+
+        lock.unlock();
+        switch (record.type) {
+        case RTVISessionRecordType::InboundMessage:
+            _observer->on_transport_encoded_frame(
+                    record.format, record.data, record.size
+            );
+            _messages_replayed++;
+            break;
+        case RTVISessionRecordType::BotAudio:
+            write_bot_audio(record);
+            break;
+        case RTVISessionRecordType::OutboundMessage:
+        case RTVISessionRecordType::UserAudio:
+            // The client being replayed sends its own.
+            break;
+        }
+        lock.lock();
+    }
+
+    _finished = !_stopped;
+}
+
+void RTVIReplayTransport::write_bot_audio(const RTVISessionRecord& record) {
+    uint32_t num_channels = _log.audio_format().num_channels;
+    size_t num_frames = record.num_samples() / num_channels;
+
+    // Audio that doesn't fit is dropped, as if the client didn't read it in
+    // time.
+    size_t to_write =
+            std::min(num_frames, _bot_audio.free_space() / num_channels);
+    _bot_audio.write(record.samples(), to_write * num_channels);
+
+    _bot_audio_frames += to_write;
+    _bot_audio_dropped += num_frames - to_write;
+}
@@ -0,0 +1,134 @@
+//
+// Copyright (c) 2024, Daily
+//
+
+#include "rtvi_session_manager.h"
+
+#include <algorithm>
+#include <vector>
+
+using namespace rtvi;
+
+RTVISessionManager::RTVISessionManager(
+        const RTVISessionManagerOptions& options
+)
+    : _next_id(1) {
+    // Only the CPUs the process may run on (e.g. in a container or under
+    // taskset), since pinning to any other CPU fails.
+    std::vector<int> cpus = RTVIReactor::available_cpus();
+    uint32_t num_reactors = options.num_reactors > 0
+                                    ? options.num_reactors
+                                    : static_cast<uint32_t>(cpus.size());
+
+    for (uint32_t i = 0; i < num_reactors; ++i) {
+        int cpu = options.pin_reactors ? cpus[i % cpus.size()] : -1;
+        _reactors.push_back(std::make_unique<RTVIReactor>(
+                i, cpu, options.timer_resolution
+        ));
+    }
+    _reactor_sessions.resize(num_reactors, 0);
+}
+
+RTVISessionManager::~RTVISessionManager() {
+    // Clients use their reactor until they are destroyed.
+    std::unique_lock<std::mutex> lock(_mutex);
+    std::map<RTVISessionId, Session> sessions;
+    sessions.swap(_sessions);
+    lock.unlock();
+
+    sessions.clear();
+
+    for (auto& reactor: _reactors) {
+        reactor->stop();
+    }
+}
+
+RTVISessionId RTVISessionManager::create_session(
+        const RTVIClientOptions& options,
+        std::unique_ptr<RTVITransport> transport
+) {
+    std::unique_lock<std::mutex> lock(_mutex);
+    auto it = std::min_element(
+            _reactor_sessions.begin(), _reactor_sessions.end()
+    );
+    uint32_t reactor = static_cast<uint32_t>(it - _reactor_sessions.begin());
+    RTVISessionId id = _next_id++;
+    _reactor_sessions[reactor]++;
+    lock.unlock();
+
+    RTVIClientOptions client_options = options;
+    client_options.reactor = _reactors[reactor].get();
+
+    std::shared_ptr<RTVIClient> client;
+    try {
+        client = std::make_shared<RTVIClient>(
+                client_options, std::move(transport)
+        );
+    } catch (...) {
+        lock.lock();
+        _reactor_sessions[reactor]--;
+        throw;
+    }
+
+    lock.lock();
+    _sessions[id] = Session {std::move(client), reactor};
+    return id;
+}
+
+std::shared_ptr<RTVIClient>
+RTVISessionManager::session(RTVISessionId id) const {
+    std::lock_guard<std::mutex> lock(_mutex);
+    auto it = _sessions.find(id);
+    if (it == _sessions.end()) {
+        return nullptr;
+    }
+    return it->second.client;
+}
+
+void RTVISessionManager::destroy_session(RTVISessionId id) {
+    std::unique_lock<std::mutex> lock(_mutex);
+    auto it = _sessions.find(id);
+    if (it == _sessions.end()) {
+        return;
+    }
+    std::shared_ptr<RTVIClient> client = std::move(it->second.client);
+    _reactor_sessions[it->second.reactor]--;
+    _sessions.erase(it);
+    lock.unlock();
+
+    // Destroyed outside the lock, disconnecting might take a while.
+    client.reset();
+}
+
+size_t RTVISessionManager::num_sessions() const {
+    std::lock_guard<std::mutex> lock(_mutex);
+    return _sessions.size();
+}
+
+std::vector<RTVISessionStats> RTVISessionManager::session_stats() const {
+    std::lock_guard<std::mutex> lock(_mutex);
+
+    std::vector<RTVISessionStats> result;
+    result.reserve(_sessions.size());
+    for (const auto& [id, session]: _sessions) {
+        const RTVIReactorLoad& load = session.client->reactor_load();
+        result.push_back(RTVISessionStats {
+                .id = id,
+                .reactor = session.reactor,
+                .connected = session.client->is_connected(),
+                .tasks = load.tasks.load(),
+                .busy_us = load.busy_us.load(),
+                .failed = load.failed.load(),
+        });
+    }
+    return result;
+}
+
+std::vector<RTVIReactorStats> RTVISessionManager::reactor_stats() const {
+    std::vector<RTVIReactorStats> result;
+    result.reserve(_reactors.size());
+    for (const auto& reactor: _reactors) {
+        result.push_back(reactor->stats());
+    }
+    return result;
+}
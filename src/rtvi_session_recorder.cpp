@@ -0,0 +1,301 @@
+//
+// Copyright (c) 2024, Daily
+//
+
+#include "rtvi_session_recorder.h"
+
+#include "rtvi_exceptions.h"
+
+#include <algorithm>
+#include <cstring>
+#include <vector>
+
+#if !defined(_WIN32)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+using namespace rtvi;
+
+// Log layout, in host byte order:
+//
+//   File header (64 bytes): magic, version, header size, start time in Unix
+//   nanoseconds, size of the records (zero until the recorder is destroyed)
+//   and the transport audio format.
+//
+//   Records, each aligned to 8 bytes: a record header followed by the
+//   payload (the encoded message or the audio samples).
+//
+// The file is preallocated with zeros and the record type is written last,
+// so a zero type marks the end of a log that wasn't closed.
+
+namespace {
+
+constexpr char MAGIC[8] = {'R', 'T', 'V', 'I', 'S', 'L', 'O', 'G'};
+constexpr uint32_t VERSION = 1;
+
+struct FileHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t header_size;
+    int64_t start_time_ns;
+    uint64_t data_size;
+    uint32_t sample_rate;
+    uint32_t num_channels;
+    uint8_t reserved[24];
+};
+
+static_assert(sizeof(FileHeader) == 64, "unexpected log header size");
+
+struct RecordHeader {
+    uint8_t type;
+    uint8_t format;
+    uint16_t reserved;
+    uint32_t size;
+    int64_t time_ns;
+};
+
+static_assert(sizeof(RecordHeader) == 16, "unexpected record header size");
+
+constexpr size_t RECORD_ALIGNMENT = 8;
+
+size_t align_record(size_t size) {
+    return (size + RECORD_ALIGNMENT - 1) & ~(RECORD_ALIGNMENT - 1);
+}
+
+bool valid_record_type(uint8_t type) {
+    auto first = static_cast<uint8_t>(RTVISessionRecordType::InboundMessage);
+    auto last = static_cast<uint8_t>(RTVISessionRecordType::BotAudio);
+    return type >= first && type <= last;
+}
+
+}  // namespace
+
+RTVISessionRecorder::RTVISessionRecorder(
+        const RTVISessionRecorderOptions& options,
+        const RTVIAudioFormat& audio_format
+)
+    : _options(options),
+      _audio_format(audio_format),
+      _start(std::chrono::steady_clock::now()),
+      _fd(-1),
+      _data(nullptr),
+      _capacity(align_record(std::max(options.max_size, sizeof(FileHeader)))),
+      _offset(sizeof(FileHeader)),
+      _records(0),
+      _dropped(0) {
+#if defined(_WIN32)
+    throw RTVIException("session recording is not supported on Windows");
+#else
+    _fd = ::open(_options.path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (_fd < 0) {
+        throw RTVIException("unable to create session log " + _options.path);
+    }
+
+    if (::ftruncate(_fd, _capacity) != 0) {
+        ::close(_fd);
+        throw RTVIException("unable to allocate session log " + _options.path);
+    }
+
+    void* data = ::mmap(
+            nullptr, _capacity, PROT_READ | PROT_WRITE, MAP_SHARED, _fd, 0
+    );
+    if (data == MAP_FAILED) {
+        ::close(_fd);
+        throw RTVIException("unable to map session log " + _options.path);
+    }
+    _data = static_cast<uint8_t*>(data);
+
+    FileHeader header = {};
+    std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+    header.version = VERSION;
+    header.header_size = sizeof(FileHeader);
+    header.start_time_ns =
+            std::chrono::duration_cast<std::chrono::nanoseconds>(
+                    std::chrono::system_clock::now().time_since_epoch()
+            )
+                    .count();
+    header.sample_rate = _audio_format.sample_rate;
+    header.num_channels = _audio_format.num_channels;
+    std::memcpy(_data, &header, sizeof(header));
+#endif
+}
+
+RTVISessionRecorder::~RTVISessionRecorder() {
+#if !defined(_WIN32)
+    size_t end = _offset;
+
+    FileHeader* header = reinterpret_cast<FileHeader*>(_data);
+    header->data_size = end - sizeof(FileHeader);
+
+    ::munmap(_data, _capacity);
+    // Drop the preallocated space that wasn't used. If this fails the log is
+    // still readable, just larger.
+    int result = ::ftruncate(_fd, end);
+    (void) result;
+    ::close(_fd);
+#endif
+}
+
+void RTVISessionRecorder::record_message(
+        RTVISessionRecordType type,
+        RTVIWireFormat format,
+        const uint8_t* data,
+        size_t size
+) {
+    append(type, format, data, size);
+}
+
+void RTVISessionRecorder::record_message(
+        RTVISessionRecordType type,
+        const nlohmann::json& message
+) {
+    // Reused, so encoding doesn't allocate once it's grown.
+    static thread_local std::vector<uint8_t> buffer;
+    buffer.clear();
+    encode_message(message, RTVIWireFormat::Json, buffer);
+    append(type, RTVIWireFormat::Json, buffer.data(), buffer.size());
+}
+
+void RTVISessionRecorder::record_audio(
+        RTVISessionRecordType type,
+        const int16_t* frames,
+        size_t num_frames
+) {
+    if (!_options.record_audio || num_frames == 0) {
+        return;
+    }
+    append(type,
+           RTVIWireFormat::Json,
+           reinterpret_cast<const uint8_t*>(frames),
+           num_frames * _audio_format.num_channels * sizeof(int16_t));
+}
+
+// Private
+
+void RTVISessionRecorder::append(
+        RTVISessionRecordType type,
+        RTVIWireFormat format,
+        const uint8_t* data,
+        size_t size
+) {
+    if (size > UINT32_MAX) {
+        _dropped++;
+        return;
+    }
+
+    auto time = std::chrono::steady_clock::now() - _start;
+
+    // Only reserve the space if the record fits, so the offset stays at the
+    // end of the records and later records that fit aren't dropped.
+    size_t record_size = align_record(sizeof(RecordHeader) + size);
+    uint64_t offset = _offset.load(std::memory_order_relaxed);
+    do {
+        if (record_size > _capacity - offset) {
+            _dropped++;
+            return;
+        }
+    } while (!_offset.compare_exchange_weak(
+            offset, offset + record_size, std::memory_order_relaxed
+    ));
+
+    uint8_t* record = _data + offset;
+    RecordHeader* header = reinterpret_cast<RecordHeader*>(record);
+    header->format = static_cast<uint8_t>(format);
+    header->size = static_cast<uint32_t>(size);
+    header->time_ns =
+            std::chrono::duration_cast<std::chrono::nanoseconds>(time).count();
+    std::memcpy(record + sizeof(RecordHeader), data, size);
+
+    std::atomic_thread_fence(std::memory_order_release);
+    header->type = static_cast<uint8_t>(type);
+
+    _records++;
+}
+
+RTVISessionLog::RTVISessionLog(const std::string& path)
+    : _data(nullptr), _size(0), _end(0), _offset(sizeof(FileHeader)) {
+#if defined(_WIN32)
+    throw RTVIException("session logs are not supported on Windows");
+#else
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        throw RTVIException("unable to open session log " + path);
+    }
+
+    struct stat st;
+    if (::fstat(fd, &st) != 0 ||
+        static_cast<size_t>(st.st_size) < sizeof(FileHeader)) {
+        ::close(fd);
+        throw RTVIException("invalid session log " + path);
+    }
+    _size = st.st_size;
+
+    void* data = ::mmap(nullptr, _size, PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (data == MAP_FAILED) {
+        throw RTVIException("unable to map session log " + path);
+    }
+    _data = static_cast<const uint8_t*>(data);
+
+    FileHeader header;
+    std::memcpy(&header, _data, sizeof(header));
+    if (std::memcmp(header.magic, MAGIC, sizeof(MAGIC)) != 0 ||
+        header.version != VERSION ||
+        header.header_size != sizeof(FileHeader)) {
+        ::munmap(const_cast<uint8_t*>(_data), _size);
+        throw RTVIException("invalid session log " + path);
+    }
+
+    _start_time = std::chrono::system_clock::time_point(
+            std::chrono::duration_cast<std::chrono::system_clock::duration>(
+                    std::chrono::nanoseconds(header.start_time_ns)
+            )
+    );
+    _audio_format = RTVIAudioFormat {
+            .sample_rate = header.sample_rate,
+            .num_channels = header.num_channels,
+    };
+
+    // Unless the log was closed, read until the first unwritten record.
+    _end = _size;
+    if (header.data_size > 0) {
+        _end = std::min<uint64_t>(_size, sizeof(FileHeader) + header.data_size);
+    }
+#endif
+}
+
+RTVISessionLog::~RTVISessionLog() {
+#if !defined(_WIN32)
+    ::munmap(const_cast<uint8_t*>(_data), _size);
+#endif
+}
+
+bool RTVISessionLog::next(RTVISessionRecord& record) {
+    if (_offset + sizeof(RecordHeader) > _end) {
+        return false;
+    }
+
+    RecordHeader header;
+    std::memcpy(&header, _data + _offset, sizeof(header));
+    if (!valid_record_type(header.type) ||
+        header.size > _end - _offset - sizeof(RecordHeader)) {
+        return false;
+    }
+
+    record = RTVISessionRecord {
+            .type = static_cast<RTVISessionRecordType>(header.type),
+            .time = std::chrono::nanoseconds(header.time_ns),
+            .format = static_cast<RTVIWireFormat>(header.format),
+            .data = _data + _offset + sizeof(RecordHeader),
+            .size = header.size,
+    };
+    _offset += align_record(sizeof(RecordHeader) + header.size);
+    return true;
+}
+
+void RTVISessionLog::rewind() {
+    _offset = sizeof(FileHeader);
+}
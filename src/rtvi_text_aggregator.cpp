@@ -0,0 +1,231 @@
+//
+// Copyright (c) 2024, Daily
+//
+
+#include "rtvi_text_aggregator.h"
+
+#include <algorithm>
+
+using namespace rtvi;
+
+static bool is_sentence_end(char c) {
+    return c == '.' || c == '!' || c == '?';
+}
+
+static bool is_whitespace(char c) {
+    return c == ' ' || c == '\t' || c == '\r' || c == '\n';
+}
+
+RTVITextAggregator::RTVITextAggregator(
+        const RTVITextAggregatorOptions& options,
+        Callback callback,
+        RTVITextAggregatorTimer timer
+)
+    : _options(options),
+      _callback(std::move(callback)),
+      _timer(std::move(timer)),
+      _ready(0),
+      _taken(0),
+      _end_turn(false),
+      _turn_id(0),
+      _flush_timer(RTVI_INVALID_TIMER_ID),
+      _delivery_turn_id(0) {
+    _turn.reserve(_options.reserve);
+    _delivery.reserve(_options.reserve);
+}
+
+RTVITextAggregator::~RTVITextAggregator() {
+    discard();
+}
+
+void RTVITextAggregator::start() {
+    discard();
+}
+
+void RTVITextAggregator::append(
+        std::string_view text,
+        std::chrono::steady_clock::time_point now
+) {
+    if (text.empty()) {
+        return;
+    }
+
+    std::unique_lock<std::mutex> lock(_mutex);
+
+    if (_ready == _turn.size()) {
+        _pending_since = now;
+    }
+
+    size_t previous_size = _turn.size();
+    _turn.append(text);
+
+    bool coalesce = _options.sentences || _options.window.count() > 0;
+    if (!coalesce) {
+        _ready = _turn.size();
+    }
+
+    if (_options.sentences) {
+        // A sentence end at the end of the previous text is only a boundary
+        // if this text starts with whitespace.
+        size_t from = previous_size > _ready ? previous_size - 1 : _ready;
+        size_t boundary = find_sentence_boundary(from);
+        if (boundary > _ready) {
+            _ready = boundary;
+            if (_ready < _turn.size()) {
+                _pending_since = now;
+            }
+        }
+    }
+
+    if (_options.window.count() > 0 && _ready < _turn.size()) {
+        if (now - _pending_since >= _options.window) {
+            _ready = _turn.size();
+        } else {
+            schedule_flush(now);
+        }
+    }
+
+    bool ready = _ready > _taken;
+    lock.unlock();
+
+    if (ready) {
+        deliver();
+    }
+}
+
+void RTVITextAggregator::stop() {
+    std::unique_lock<std::mutex> lock(_mutex);
+    cancel_flush();
+    if (_turn.empty()) {
+        return;
+    }
+    _ready = _turn.size();
+    _end_turn = true;
+    lock.unlock();
+
+    deliver();
+}
+
+void RTVITextAggregator::discard() {
+    std::lock_guard<std::mutex> lock(_mutex);
+    cancel_flush();
+    _turn.clear();
+    _ready = 0;
+    _taken = 0;
+    _end_turn = false;
+    _turn_id++;
+}
+
+// Private
+
+// Returns the end of the last complete sentence starting the search at
+// `from`, or zero if there's none.
+size_t RTVITextAggregator::find_sentence_boundary(size_t from) const {
+    size_t boundary = 0;
+    for (size_t i = from; i < _turn.size(); ++i) {
+        char c = _turn[i];
+        if (c == '\n') {
+            boundary = i + 1;
+        } else if (is_sentence_end(c) && i + 1 < _turn.size() &&
+                   is_whitespace(_turn[i + 1])) {
+            boundary = i + 1;
+        }
+    }
+    return boundary;
+}
+
+// Called with the aggregator locked.
+void RTVITextAggregator::schedule_flush(
+        std::chrono::steady_clock::time_point now
+) {
+    if (!_timer.schedule || _flush_timer != RTVI_INVALID_TIMER_ID) {
+        return;
+    }
+    auto delay = std::chrono::ceil<std::chrono::milliseconds>(
+            _pending_since + _options.window - now
+    );
+    _flush_timer = _timer.schedule(
+            std::max(delay, std::chrono::milliseconds(0)),
+            [this] { flush(); }
+    );
+}
+
+// Called with the aggregator locked.
+void RTVITextAggregator::cancel_flush() {
+    if (_flush_timer != RTVI_INVALID_TIMER_ID) {
+        _timer.cancel(_flush_timer);
+        _flush_timer = RTVI_INVALID_TIMER_ID;
+    }
+}
+
+void RTVITextAggregator::flush() {
+    auto now = std::chrono::steady_clock::now();
+
+    std::unique_lock<std::mutex> lock(_mutex);
+    _flush_timer = RTVI_INVALID_TIMER_ID;
+    if (_ready == _turn.size()) {
+        return;
+    }
+    // Sentences delivered since the flush was scheduled restart the window.
+    if (now - _pending_since < _options.window) {
+        schedule_flush(now);
+        return;
+    }
+    _ready = _turn.size();
+    lock.unlock();
+
+    deliver();
+}
+
+// Delivers all the ready text. Each chunk is appended to the delivery buffer
+// with both locks held, and the callback is called with only the delivery
+// lock, so the turn can keep growing meanwhile.
+void RTVITextAggregator::deliver() {
+    // Called from the callback. The delivery in progress checks for more
+    // ready text when the callback returns.
+    if (_delivery_thread.load() == std::this_thread::get_id()) {
+        return;
+    }
+
+    std::lock_guard<std::mutex> delivery_lock(_delivery_mutex);
+    _delivery_thread = std::this_thread::get_id();
+
+    std::unique_lock<std::mutex> lock(_mutex);
+    while (_ready > _taken || _end_turn) {
+        if (_delivery_turn_id != _turn_id) {
+            _delivery.clear();
+            _delivery_turn_id = _turn_id;
+        }
+        size_t start = _delivery.size();
+        _delivery.append(_turn, _taken, _ready - _taken);
+        _taken = _ready;
+
+        bool final = _end_turn;
+        if (final) {
+            // Text appended after stop() belongs to the next turn.
+            _turn.erase(0, _ready);
+            _ready = 0;
+            _taken = 0;
+            _end_turn = false;
+            _turn_id++;
+        }
+        lock.unlock();
+
+        std::string_view turn(_delivery);
+        BotAggregatedTextData data = {
+                .text = turn.substr(start),
+                .turn = turn,
+                .final = final,
+        };
+        try {
+            _callback(data);
+        } catch (...) {
+            _delivery_thread = std::thread::id();
+            throw;
+        }
+
+        lock.lock();
+    }
+
+    _delivery_thread = std::thread::id();
+}
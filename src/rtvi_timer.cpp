@@ -0,0 +1,273 @@
+//
+// Copyright (c) 2024, Daily
+//
+
+#include "rtvi_timer.h"
+
+#include <algorithm>
+
+using namespace rtvi;
+
+//
+// RTVITimerWheel
+//
+
+RTVITimerWheel::RTVITimerWheel(
+        std::chrono::milliseconds resolution,
+        size_t num_slots,
+        std::chrono::steady_clock::time_point now
+)
+    : _resolution(std::max(resolution, std::chrono::milliseconds(1))),
+      _start(now),
+      _current_tick(0),
+      _size(0),
+      _slots(std::max<size_t>(num_slots, 1), INVALID_INDEX),
+      _free(INVALID_INDEX) {}
+
+RTVITimerId RTVITimerWheel::schedule(
+        std::chrono::milliseconds delay,
+        Callback callback,
+        std::chrono::steady_clock::time_point now
+) {
+    uint32_t index = _free;
+    if (index != INVALID_INDEX) {
+        _free = _nodes[index].next;
+    } else {
+        index = static_cast<uint32_t>(_nodes.size());
+        _nodes.emplace_back();
+    }
+
+    // Round up, and skip the rest of the current tick, so timers never
+    // expire early.
+    uint64_t ticks = (delay.count() + _resolution.count() - 1) /
+                     _resolution.count();
+
+    Node& node = _nodes[index];
+    node.generation++;
+    node.expires = std::max(tick_at(now), _current_tick) + ticks + 1;
+    node.active = true;
+    node.callback = std::move(callback);
+
+    link(index);
+    _size++;
+
+    return (static_cast<uint64_t>(node.generation) << 32) | index;
+}
+
+bool RTVITimerWheel::cancel(RTVITimerId id) {
+    uint32_t index = static_cast<uint32_t>(id);
+    uint32_t generation = static_cast<uint32_t>(id >> 32);
+
+    if (index >= _nodes.size()) {
+        return false;
+    }
+
+    Node& node = _nodes[index];
+    if (!node.active || node.generation != generation) {
+        return false;
+    }
+
+    unlink(index);
+    release(index);
+    return true;
+}
+
+size_t RTVITimerWheel::advance(
+        std::chrono::steady_clock::time_point now,
+        std::vector<Callback>& expired
+) {
+    size_t count = 0;
+    uint64_t target_tick = tick_at(now);
+
+    while (_current_tick < target_tick) {
+        _current_tick++;
+
+        // Nothing can expire once all timers are gone, so skip ahead.
+        if (_size == 0) {
+            _current_tick = target_tick;
+            break;
+        }
+
+        uint32_t index = _slots[_current_tick % _slots.size()];
+        while (index != INVALID_INDEX) {
+            uint32_t next = _nodes[index].next;
+            if (_nodes[index].expires <= _current_tick) {
+                expired.push_back(std::move(_nodes[index].callback));
+                unlink(index);
+                release(index);
+                count++;
+            }
+            index = next;
+        }
+    }
+
+    return count;
+}
+
+void RTVITimerWheel::clear() {
+    for (uint32_t index = 0; index < _nodes.size(); ++index) {
+        if (_nodes[index].active) {
+            release(index);
+        }
+    }
+    std::fill(_slots.begin(), _slots.end(), INVALID_INDEX);
+}
+
+std::chrono::steady_clock::time_point RTVITimerWheel::next_tick() const {
+    return _start + _resolution * (_current_tick + 1);
+}
+
+std::chrono::steady_clock::time_point RTVITimerWheel::next_expiry() const {
+    uint64_t tick = _current_tick + 1;
+    uint64_t last_tick = _current_tick + _slots.size();
+    while (tick < last_tick && _slots[tick % _slots.size()] == INVALID_INDEX) {
+        tick++;
+    }
+    return _start + _resolution * tick;
+}
+
+// Private
+
+uint64_t
+RTVITimerWheel::tick_at(std::chrono::steady_clock::time_point time) const {
+    if (time < _start) {
+        return 0;
+    }
+    return (time - _start) / _resolution;
+}
+
+void RTVITimerWheel::link(uint32_t index) {
+    Node& node = _nodes[index];
+    uint32_t& head = _slots[node.expires % _slots.size()];
+
+    node.prev = INVALID_INDEX;
+    node.next = head;
+    if (head != INVALID_INDEX) {
+        _nodes[head].prev = index;
+    }
+    head = index;
+}
+
+void RTVITimerWheel::unlink(uint32_t index) {
+    Node& node = _nodes[index];
+
+    if (node.prev != INVALID_INDEX) {
+        _nodes[node.prev].next = node.next;
+    } else {
+        _slots[node.expires % _slots.size()] = node.next;
+    }
+    if (node.next != INVALID_INDEX) {
+        _nodes[node.next].prev = node.prev;
+    }
+}
+
+void RTVITimerWheel::release(uint32_t index) {
+    Node& node = _nodes[index];
+    node.active = false;
+    node.callback = nullptr;
+    node.prev = INVALID_INDEX;
+    node.next = _free;
+    _free = index;
+    _size--;
+}
+
+//
+// RTVITimer
+//
+
+RTVITimer::RTVITimer(std::chrono::milliseconds resolution, size_t num_slots)
+    : _state(std::make_shared<State>(resolution, num_slots)), _running(false) {
+}
+
+RTVITimer::~RTVITimer() {
+    stop();
+}
+
+RTVITimerId RTVITimer::schedule(
+        std::chrono::milliseconds delay,
+        RTVITimerWheel::Callback callback
+) {
+    std::unique_lock<std::mutex> lock(_state->mutex);
+    if (_state->stopped) {
+        return RTVI_INVALID_TIMER_ID;
+    }
+
+    // The wheel doesn't advance while it's empty, so catch up first to make
+    // the delay relative to the current time.
+    if (_state->wheel.empty()) {
+        std::vector<RTVITimerWheel::Callback> expired;
+        _state->wheel.advance(std::chrono::steady_clock::now(), expired);
+    }
+
+    RTVITimerId id = _state->wheel.schedule(delay, std::move(callback));
+
+    if (!_running) {
+        _running = true;
+        _thread = std::thread(&RTVITimer::run, _state);
+    }
+
+    // The thread might be waiting for a later timer. Notified with the lock
+    // held, since a callback could destroy the timer as soon as it's released.
+    _state->condition.notify_one();
+
+    return id;
+}
+
+bool RTVITimer::cancel(RTVITimerId id) {
+    std::lock_guard<std::mutex> lock(_state->mutex);
+    return _state->wheel.cancel(id);
+}
+
+void RTVITimer::stop() {
+    std::unique_lock<std::mutex> lock(_state->mutex);
+    _state->stopped = true;
+    _state->wheel.clear();
+    lock.unlock();
+
+    _state->condition.notify_all();
+
+    if (!_thread.joinable()) {
+        return;
+    }
+    // A callback can't wait for its own thread.
+    if (_thread.get_id() == std::this_thread::get_id()) {
+        _thread.detach();
+    } else {
+        _thread.join();
+    }
+}
+
+// Private
+
+void RTVITimer::run(std::shared_ptr<State> state) {
+    std::vector<RTVITimerWheel::Callback> expired;
+
+    std::unique_lock<std::mutex> lock(state->mutex);
+    while (!state->stopped) {
+        if (state->wheel.empty()) {
+            state->condition.wait(lock);
+            continue;
+        }
+
+        state->condition.wait_until(lock, state->wheel.next_expiry());
+        if (state->stopped) {
+            break;
+        }
+
+        state->wheel.advance(std::chrono::steady_clock::now(), expired);
+        if (expired.empty()) {
+            continue;
+        }
+
+        lock.unlock();
+        for (auto& callback: expired) {
+            // A callback might have stopped the timer.
+            if (state->stopped) {
+                break;
+            }
+            callback();
+        }
+        expired.clear();
+        lock.lock();
+    }
+}
@@ -4,24 +4,62 @@
 
 #include "rtvi_utils.h"
 
+#include <atomic>
 #include <random>
 
-static const size_t ID_LENGTH = 10;
+// IDs are a permutation of a 59-bit counter, which fits in 10 base62 digits
+// (62^10 > 2^59).
+static const uint64_t ID_BITS = 59;
+static const uint64_t ID_MASK = (1ull << ID_BITS) - 1;
 
-std::string rtvi::generate_random_id() {
-    const std::string characters =
-            "0123456789ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz";
-
-    std::random_device rd;
-    std::mt19937 generator(rd());
-    std::uniform_int_distribution<size_t> distribution(
-            0, characters.size() - 1
-    );
-
-    std::string id;
-    for (size_t i = 0; i < ID_LENGTH; ++i) {
-        id += characters[distribution(generator)];
+// Counters are handed out to threads in blocks, so threads only touch the
+// shared counter once every `ID_BLOCK_SIZE` IDs.
+static const uint64_t ID_BLOCK_SIZE = 1024;
+
+static const char ID_CHARACTERS[] =
+        "0123456789ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz";
+
+static std::atomic<uint64_t> id_counter(0);
+
+static uint64_t id_salt() {
+    static const uint64_t salt = [] {
+        std::random_device rd;
+        return ((static_cast<uint64_t>(rd()) << 32) | rd()) & ID_MASK;
+    }();
+    return salt;
+}
+
+// Bijective mix of 59-bit values: additions, xor-shifts and multiplications by
+// odd constants are all invertible modulo 2^59, so different counters always
+// give different IDs, but consecutive counters look unrelated.
+static uint64_t id_permute(uint64_t value) {
+    value = (value + id_salt()) & ID_MASK;
+    value ^= value >> 31;
+    value = (value * 0x7fb5d329728ea185ull) & ID_MASK;
+    value ^= value >> 27;
+    value = (value * 0x81dadef4bc2dd44dull) & ID_MASK;
+    value ^= value >> 33;
+    return value;
+}
+
+void rtvi::generate_random_id(char* buffer) {
+    thread_local uint64_t next = 0;
+    thread_local uint64_t end = 0;
+
+    if (next == end) {
+        next = id_counter.fetch_add(ID_BLOCK_SIZE, std::memory_order_relaxed);
+        end = next + ID_BLOCK_SIZE;
+    }
+
+    uint64_t value = id_permute(next++);
+    for (size_t i = 0; i < RTVI_ID_LENGTH; ++i) {
+        buffer[i] = ID_CHARACTERS[value % 62];
+        value /= 62;
     }
+}
 
-    return id;
+std::string rtvi::generate_random_id() {
+    char buffer[RTVI_ID_LENGTH];
+    generate_random_id(buffer);
+    return std::string(buffer, RTVI_ID_LENGTH);
 }
@@ -0,0 +1,359 @@
+//
+// Copyright (c) 2024, Daily
+//
+
+#include "rtvi_wire_format.h"
+
+#include "rtvi_message_template.h"
+
+#include <charconv>
+#include <clocale>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+using namespace rtvi;
+
+namespace {
+
+template<typename T>
+void write_big_endian(std::vector<uint8_t>& out, T value) {
+    for (int shift = (sizeof(T) - 1) * 8; shift >= 0; shift -= 8) {
+        out.push_back(static_cast<uint8_t>(value >> shift));
+    }
+}
+
+void write_double(std::vector<uint8_t>& out, double value) {
+    uint64_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    write_big_endian(out, bits);
+}
+
+void write_bytes(std::vector<uint8_t>& out, const std::string& value) {
+    const uint8_t* data = reinterpret_cast<const uint8_t*>(value.data());
+    out.insert(out.end(), data, data + value.size());
+}
+
+void write_text(std::vector<uint8_t>& out, std::string_view text) {
+    out.insert(out.end(), text.begin(), text.end());
+}
+
+// `json::dump()` returns a new string every time, so JSON is written here
+// too. The output is compact like `dump()`'s, but strings are copied as they
+// are instead of being checked for valid UTF-8.
+
+template<typename T>
+void write_json_number(std::vector<uint8_t>& out, T value) {
+    char text[32];
+    auto result = std::to_chars(text, text + sizeof(text), value);
+    write_text(out, std::string_view(text, result.ptr - text));
+}
+
+void write_json_double(std::vector<uint8_t>& out, double value) {
+    if (!std::isfinite(value)) {
+        write_text(out, "null");
+        return;
+    }
+
+    // The shortest of these precisions that round-trips, like `dump()`.
+    // Floating-point `std::to_chars()` is missing from older libc++.
+    char text[32];
+    int length = 0;
+    for (int precision = 15; precision <= 17; ++precision) {
+        length = std::snprintf(text, sizeof(text), "%.*g", precision, value);
+        if (std::strtod(text, nullptr) == value) {
+            break;
+        }
+    }
+
+    // `snprintf()` uses the locale decimal point.
+    char decimal_point = *std::localeconv()->decimal_point;
+    bool has_point = false;
+    for (int i = 0; i < length; ++i) {
+        if (text[i] == decimal_point) {
+            text[i] = '.';
+        }
+        has_point = has_point || text[i] == '.' || text[i] == 'e';
+    }
+
+    write_text(out, std::string_view(text, length));
+    // Keep the value a float when it's parsed back.
+    if (!has_point) {
+        write_text(out, ".0");
+    }
+}
+
+void write_json(std::vector<uint8_t>& out, const nlohmann::json& value) {
+    switch (value.type()) {
+    case nlohmann::json::value_t::boolean:
+        if (value.get<bool>()) {
+            write_text(out, "true");
+        } else {
+            write_text(out, "false");
+        }
+        break;
+    case nlohmann::json::value_t::number_integer:
+        write_json_number(out, value.get<int64_t>());
+        break;
+    case nlohmann::json::value_t::number_unsigned:
+        write_json_number(out, value.get<uint64_t>());
+        break;
+    case nlohmann::json::value_t::number_float:
+        write_json_double(out, value.get<double>());
+        break;
+    case nlohmann::json::value_t::string:
+        append_json_string(value.get_ref<const std::string&>(), out);
+        break;
+    case nlohmann::json::value_t::array: {
+        out.push_back('[');
+        bool first = true;
+        for (const auto& element: value) {
+            if (!first) {
+                out.push_back(',');
+            }
+            first = false;
+            write_json(out, element);
+        }
+        out.push_back(']');
+        break;
+    }
+    case nlohmann::json::value_t::object: {
+        out.push_back('{');
+        bool first = true;
+        for (auto it = value.begin(); it != value.end(); ++it) {
+            if (!first) {
+                out.push_back(',');
+            }
+            first = false;
+            append_json_string(it.key(), out);
+            out.push_back(':');
+            write_json(out, it.value());
+        }
+        out.push_back('}');
+        break;
+    }
+    default:
+        write_text(out, "null");
+        break;
+    }
+}
+
+// The binary writers of nlohmann::json copy every object key into a
+// temporary json value, so MessagePack and CBOR are written here instead.
+// Both use the smallest encoding of each value, like nlohmann::json does.
+
+void write_msgpack_unsigned(std::vector<uint8_t>& out, uint64_t value) {
+    if (value < 128) {
+        out.push_back(static_cast<uint8_t>(value));
+    } else if (value <= UINT8_MAX) {
+        out.push_back(0xcc);
+        write_big_endian(out, static_cast<uint8_t>(value));
+    } else if (value <= UINT16_MAX) {
+        out.push_back(0xcd);
+        write_big_endian(out, static_cast<uint16_t>(value));
+    } else if (value <= UINT32_MAX) {
+        out.push_back(0xce);
+        write_big_endian(out, static_cast<uint32_t>(value));
+    } else {
+        out.push_back(0xcf);
+        write_big_endian(out, value);
+    }
+}
+
+void write_msgpack_integer(std::vector<uint8_t>& out, int64_t value) {
+    if (value >= 0) {
+        write_msgpack_unsigned(out, static_cast<uint64_t>(value));
+    } else if (value >= -32) {
+        out.push_back(static_cast<uint8_t>(value));
+    } else if (value >= INT8_MIN) {
+        out.push_back(0xd0);
+        write_big_endian(out, static_cast<uint8_t>(value));
+    } else if (value >= INT16_MIN) {
+        out.push_back(0xd1);
+        write_big_endian(out, static_cast<uint16_t>(value));
+    } else if (value >= INT32_MIN) {
+        out.push_back(0xd2);
+        write_big_endian(out, static_cast<uint32_t>(value));
+    } else {
+        out.push_back(0xd3);
+        write_big_endian(out, static_cast<uint64_t>(value));
+    }
+}
+
+// Header of strings, arrays and maps, which have a compact "fix" form and
+// 8 (strings only), 16 and 32-bit length forms.
+void write_msgpack_length(
+        std::vector<uint8_t>& out,
+        size_t length,
+        uint8_t fix,
+        size_t fix_max,
+        uint8_t first_type
+) {
+    if (length <= fix_max) {
+        out.push_back(static_cast<uint8_t>(fix | length));
+    } else if (first_type == 0xd9 && length <= UINT8_MAX) {
+        out.push_back(0xd9);
+        write_big_endian(out, static_cast<uint8_t>(length));
+    } else if (length <= UINT16_MAX) {
+        out.push_back(first_type == 0xd9 ? 0xda : first_type);
+        write_big_endian(out, static_cast<uint16_t>(length));
+    } else {
+        out.push_back(first_type == 0xd9 ? 0xdb : first_type + 1);
+        write_big_endian(out, static_cast<uint32_t>(length));
+    }
+}
+
+void write_msgpack_string(std::vector<uint8_t>& out, const std::string& value) {
+    write_msgpack_length(out, value.size(), 0xa0, 31, 0xd9);
+    write_bytes(out, value);
+}
+
+void write_msgpack(std::vector<uint8_t>& out, const nlohmann::json& value) {
+    switch (value.type()) {
+    case nlohmann::json::value_t::boolean:
+        out.push_back(value.get<bool>() ? 0xc3 : 0xc2);
+        break;
+    case nlohmann::json::value_t::number_integer:
+        write_msgpack_integer(out, value.get<int64_t>());
+        break;
+    case nlohmann::json::value_t::number_unsigned:
+        write_msgpack_unsigned(out, value.get<uint64_t>());
+        break;
+    case nlohmann::json::value_t::number_float:
+        out.push_back(0xcb);
+        write_double(out, value.get<double>());
+        break;
+    case nlohmann::json::value_t::string:
+        write_msgpack_string(out, value.get_ref<const std::string&>());
+        break;
+    case nlohmann::json::value_t::array:
+        write_msgpack_length(out, value.size(), 0x90, 15, 0xdc);
+        for (const auto& element: value) {
+            write_msgpack(out, element);
+        }
+        break;
+    case nlohmann::json::value_t::object:
+        write_msgpack_length(out, value.size(), 0x80, 15, 0xde);
+        for (auto it = value.begin(); it != value.end(); ++it) {
+            write_msgpack_string(out, it.key());
+            write_msgpack(out, it.value());
+        }
+        break;
+    default:
+        out.push_back(0xc0);
+        break;
+    }
+}
+
+void write_cbor_head(std::vector<uint8_t>& out, uint8_t major, uint64_t value) {
+    major <<= 5;
+    if (value < 24) {
+        out.push_back(static_cast<uint8_t>(major | value));
+    } else if (value <= UINT8_MAX) {
+        out.push_back(major | 24);
+        write_big_endian(out, static_cast<uint8_t>(value));
+    } else if (value <= UINT16_MAX) {
+        out.push_back(major | 25);
+        write_big_endian(out, static_cast<uint16_t>(value));
+    } else if (value <= UINT32_MAX) {
+        out.push_back(major | 26);
+        write_big_endian(out, static_cast<uint32_t>(value));
+    } else {
+        out.push_back(major | 27);
+        write_big_endian(out, value);
+    }
+}
+
+void write_cbor_string(std::vector<uint8_t>& out, const std::string& value) {
+    write_cbor_head(out, 3, value.size());
+    write_bytes(out, value);
+}
+
+void write_cbor(std::vector<uint8_t>& out, const nlohmann::json& value) {
+    switch (value.type()) {
+    case nlohmann::json::value_t::boolean:
+        out.push_back(value.get<bool>() ? 0xf5 : 0xf4);
+        break;
+    case nlohmann::json::value_t::number_integer: {
+        int64_t integer = value.get<int64_t>();
+        if (integer >= 0) {
+            write_cbor_head(out, 0, static_cast<uint64_t>(integer));
+        } else {
+            // Negative integers are encoded as -1 - n.
+            write_cbor_head(out, 1, ~static_cast<uint64_t>(integer));
+        }
+        break;
+    }
+    case nlohmann::json::value_t::number_unsigned:
+        write_cbor_head(out, 0, value.get<uint64_t>());
+        break;
+    case nlohmann::json::value_t::number_float:
+        out.push_back(0xfb);
+        write_double(out, value.get<double>());
+        break;
+    case nlohmann::json::value_t::string:
+        write_cbor_string(out, value.get_ref<const std::string&>());
+        break;
+    case nlohmann::json::value_t::array:
+        write_cbor_head(out, 4, value.size());
+        for (const auto& element: value) {
+            write_cbor(out, element);
+        }
+        break;
+    case nlohmann::json::value_t::object:
+        write_cbor_head(out, 5, value.size());
+        for (auto it = value.begin(); it != value.end(); ++it) {
+            write_cbor_string(out, it.key());
+            write_cbor(out, it.value());
+        }
+        break;
+    default:
+        out.push_back(0xf6);
+        break;
+    }
+}
+
+}  // namespace
+
+void rtvi::encode_message(
+        const nlohmann::json& message,
+        RTVIWireFormat format,
+        std::vector<uint8_t>& out
+) {
+    size_t size = out.size();
+
+    try {
+        switch (format) {
+        case RTVIWireFormat::Json:
+            write_json(out, message);
+            break;
+        case RTVIWireFormat::MessagePack:
+            write_msgpack(out, message);
+            break;
+        case RTVIWireFormat::Cbor:
+            write_cbor(out, message);
+            break;
+        }
+    } catch (...) {
+        // Don't leave a partial message behind.
+        out.resize(size);
+        throw;
+    }
+}
+
+nlohmann::json rtvi::decode_message(
+        RTVIWireFormat format,
+        const uint8_t* data,
+        size_t size
+) {
+    switch (format) {
+    case RTVIWireFormat::MessagePack:
+        return nlohmann::json::from_msgpack(data, data + size);
+    case RTVIWireFormat::Cbor:
+        return nlohmann::json::from_cbor(data, data + size);
+    case RTVIWireFormat::Json:
+    default:
+        return nlohmann::json::parse(data, data + size);
+    }
+}
@@ -0,0 +1,77 @@
+//
+// Copyright (c) 2024, Daily
+//
+
+#include "rtvi_test.h"
+
+#include <atomic>
+#include <cstdio>
+#include <exception>
+#include <vector>
+
+using namespace rtvi;
+
+namespace {
+
+struct TestCase {
+    const char* name;
+    RTVITestFunction function;
+};
+
+std::vector<TestCase>& test_cases() {
+    static std::vector<TestCase> cases;
+    return cases;
+}
+
+// Checks can fail on any thread.
+std::atomic<size_t> num_failures(0);
+
+}  // namespace
+
+RTVITestRegistrar::RTVITestRegistrar(
+        const char* name,
+        RTVITestFunction function
+) {
+    test_cases().push_back(TestCase {name, function});
+}
+
+void rtvi::rtvi_test_fail(
+        const char* file,
+        int line,
+        const std::string& message
+) {
+    std::fprintf(
+            stderr,
+            "%s:%d: check failed: %s\n",
+            file,
+            line,
+            message.c_str()
+    );
+    num_failures++;
+}
+
+int main() {
+    size_t num_failed = 0;
+    for (const TestCase& test: test_cases()) {
+        size_t failures = num_failures;
+        try {
+            test.function();
+        } catch (const std::exception& e) {
+            std::fprintf(stderr, "%s: exception: %s\n", test.name, e.what());
+            num_failures++;
+        }
+
+        bool passed = num_failures == failures;
+        std::printf("%s %s\n", passed ? "PASS" : "FAIL", test.name);
+        if (!passed) {
+            num_failed++;
+        }
+    }
+
+    std::printf(
+            "%zu of %zu tests passed\n",
+            test_cases().size() - num_failed,
+            test_cases().size()
+    );
+    return num_failed > 0 ? 1 : 0;
+}
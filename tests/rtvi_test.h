@@ -0,0 +1,75 @@
+//
+// Copyright (c) 2024, Daily
+//
+
+#ifndef RTVI_TEST_H
+#define RTVI_TEST_H
+
+#include <sstream>
+#include <string>
+
+namespace rtvi {
+
+// Minimal test harness, so the tests don't need any dependency. Test cases
+// are registered with `RTVI_TEST()` and run by the shared `main()` in
+// rtvi_test.cpp. Failed checks are reported but don't stop the test case.
+
+typedef void (*RTVITestFunction)();
+
+class RTVITestRegistrar {
+   public:
+    RTVITestRegistrar(const char* name, RTVITestFunction function);
+};
+
+void rtvi_test_fail(const char* file, int line, const std::string& message);
+
+template<typename A, typename B>
+void rtvi_test_check_eq(
+        const A& a,
+        const B& b,
+        const char* expression,
+        const char* file,
+        int line
+) {
+    if (!(a == b)) {
+        std::ostringstream message;
+        message << expression << " (" << a << " != " << b << ")";
+        rtvi_test_fail(file, line, message.str());
+    }
+}
+
+}  // namespace rtvi
+
+#define RTVI_TEST(name)                                                     \
+    static void name();                                                     \
+    static rtvi::RTVITestRegistrar name##_registrar(#name, name);           \
+    static void name()
+
+#define RTVI_CHECK(expression)                                              \
+    do {                                                                    \
+        if (!(expression)) {                                                \
+            rtvi::rtvi_test_fail(__FILE__, __LINE__, #expression);          \
+        }                                                                   \
+    } while (0)
+
+#define RTVI_CHECK_EQ(a, b)                                                 \
+    rtvi::rtvi_test_check_eq((a), (b), #a " == " #b, __FILE__, __LINE__)
+
+#define RTVI_CHECK_THROWS(expression, exception)                            \
+    do {                                                                    \
+        bool thrown = false;                                                \
+        try {                                                               \
+            (void) (expression);                                            \
+        } catch (const exception&) {                                        \
+            thrown = true;                                                  \
+        }                                                                   \
+        if (!thrown) {                                                      \
+            rtvi::rtvi_test_fail(                                           \
+                    __FILE__,                                               \
+                    __LINE__,                                               \
+                    #expression " doesn't throw " #exception                \
+            );                                                              \
+        }                                                                   \
+    } while (0)
+
+#endif
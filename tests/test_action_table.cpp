@@ -0,0 +1,194 @@
+//
+// Copyright (c) 2024, Daily
+//
+
+#include "rtvi_action_table.h"
+
+#include "rtvi_test.h"
+
+#include <algorithm>
+#include <map>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace rtvi;
+
+namespace {
+
+// Same hash as the table (64-bit FNV-1a), to pick IDs with a given home
+// slot.
+uint64_t hash_id(const std::string& id) {
+    uint64_t result = 14695981039346656037ull;
+    for (char c: id) {
+        result ^= static_cast<uint8_t>(c);
+        result *= 1099511628211ull;
+    }
+    return result;
+}
+
+// Finds an ID, not in `used`, whose home slot is `slot` in a table with the
+// given number of slots per shard.
+std::string id_with_home(
+        size_t slot,
+        size_t num_slots,
+        std::vector<std::string>& used
+) {
+    for (int i = 0;; ++i) {
+        std::string id = "action-" + std::to_string(i);
+        if ((hash_id(id) & (num_slots - 1)) != slot) {
+            continue;
+        }
+        if (std::find(used.begin(), used.end(), id) == used.end()) {
+            used.push_back(id);
+            return id;
+        }
+    }
+}
+
+bool contains(RTVIActionTable<int>& table, const std::string& id, int value) {
+    int found = -1;
+    table.update(id, [&found](int& v) { found = v; });
+    return found == value;
+}
+
+}  // namespace
+
+RTVI_TEST(test_insert_update_remove) {
+    RTVIActionTable<int> table(16, 4);
+
+    RTVI_CHECK(table.insert("a", 1));
+    RTVI_CHECK(table.insert("b", 2));
+    RTVI_CHECK(!table.insert("a", 3));
+    RTVI_CHECK_EQ(table.size(), 2u);
+
+    RTVI_CHECK(table.update("a", [](int& value) { value = 10; }));
+    RTVI_CHECK(!table.update("c", [](int&) {}));
+    RTVI_CHECK(contains(table, "a", 10));
+
+    RTVI_CHECK_EQ(table.remove("a").value_or(-1), 10);
+    RTVI_CHECK(!table.remove("a").has_value());
+    RTVI_CHECK_EQ(table.size(), 1u);
+
+    std::vector<int> values;
+    table.remove_all(values);
+    RTVI_CHECK_EQ(values.size(), 1u);
+    RTVI_CHECK_EQ(table.size(), 0u);
+}
+
+RTVI_TEST(test_capacity) {
+    RTVIActionTable<int> table(8, 1);
+    for (int i = 0; i < 8; ++i) {
+        RTVI_CHECK(table.insert(std::to_string(i), i));
+    }
+    RTVI_CHECK(!table.insert("full", 8));
+    RTVI_CHECK_EQ(table.size(), 8u);
+
+    RTVI_CHECK(table.remove("3").has_value());
+    RTVI_CHECK(table.insert("full", 8));
+}
+
+RTVI_TEST(test_long_ids) {
+    RTVIActionTable<int> table(8, 2);
+    std::string inline_id(RTVI_ACTION_ID_INLINE_LENGTH, 'x');
+    std::string long_id = inline_id + "y";
+    std::string uuid = "8f5a1c3e-2b4d-4f6a-9c8e-1d2b3c4d5e6f";
+
+    RTVI_CHECK(table.insert(inline_id, 1));
+    RTVI_CHECK(table.insert(long_id, 2));
+    RTVI_CHECK(table.insert(uuid, 3));
+    RTVI_CHECK(!table.insert(uuid, 4));
+
+    RTVI_CHECK(contains(table, inline_id, 1));
+    RTVI_CHECK(contains(table, long_id, 2));
+    RTVI_CHECK(!table.remove(long_id + "z").has_value());
+    RTVI_CHECK_EQ(table.remove(uuid).value_or(-1), 3);
+    RTVI_CHECK_EQ(table.remove(long_id).value_or(-1), 2);
+    RTVI_CHECK_EQ(table.size(), 1u);
+}
+
+RTVI_TEST(test_erase_in_wrapped_probe_chains) {
+    // A single shard with room for 8 entries has 32 slots.
+    constexpr size_t NUM_SLOTS = 32;
+
+    // Entries whose home is one of the last slots probe past the end, so
+    // they end up in the first slots:
+    //
+    //   slot: 29 30 31  0  1  2  3
+    //   home: 29 30 30 31 29  0  0
+    std::vector<std::string> used;
+    std::vector<std::pair<std::string, int>> entries;
+    for (size_t home: {29, 30, 30, 31, 29, 0, 0}) {
+        std::string id = id_with_home(home, NUM_SLOTS, used);
+        entries.emplace_back(id, static_cast<int>(entries.size()));
+    }
+
+    // Remove the entries in every rotation of the insertion order, so each
+    // one is erased with the chain wrapped around it.
+    for (size_t first = 0; first < entries.size(); ++first) {
+        RTVIActionTable<int> table(8, 1);
+        for (auto& [id, value]: entries) {
+            RTVI_CHECK(table.insert(id, value));
+        }
+
+        for (size_t i = 0; i < entries.size(); ++i) {
+            auto& [id, value] = entries[(first + i) % entries.size()];
+            RTVI_CHECK_EQ(table.remove(id).value_or(-1), value);
+
+            // Everything not removed yet must still be found.
+            for (size_t j = i + 1; j < entries.size(); ++j) {
+                auto& [other_id, other_value] =
+                        entries[(first + j) % entries.size()];
+                RTVI_CHECK(contains(table, other_id, other_value));
+            }
+        }
+        RTVI_CHECK_EQ(table.size(), 0u);
+    }
+}
+
+RTVI_TEST(test_random_operations) {
+    RTVIActionTable<int> table(64, 2);
+    std::map<std::string, int> expected;
+    std::mt19937 random(1234);
+
+    // A small pool of IDs, some of them too long to be stored inline, so
+    // inserts and removes keep hitting the same probe chains.
+    std::vector<std::string> ids;
+    for (int i = 0; i < 96; ++i) {
+        std::string id = std::to_string(i);
+        if (i % 3 == 0) {
+            id += std::string(RTVI_ACTION_ID_INLINE_LENGTH, '-');
+        }
+        ids.push_back(id);
+    }
+
+    for (int i = 0; i < 100000; ++i) {
+        const std::string& id = ids[random() % ids.size()];
+        if (random() % 2 == 0) {
+            // Each shard has room for the whole table, so inserting only
+            // fails if the table is full or has the ID.
+            bool inserted = table.insert(id, i);
+            RTVI_CHECK_EQ(
+                    inserted,
+                    expected.size() < table.capacity() &&
+                            expected.count(id) == 0
+            );
+            if (inserted) {
+                expected[id] = i;
+            }
+        } else {
+            auto it = expected.find(id);
+            std::optional<int> value = table.remove(id);
+            RTVI_CHECK_EQ(value.has_value(), it != expected.end());
+            if (it != expected.end()) {
+                RTVI_CHECK_EQ(value.value_or(-1), it->second);
+                expected.erase(it);
+            }
+        }
+        RTVI_CHECK_EQ(table.size(), expected.size());
+    }
+
+    for (auto& [id, value]: expected) {
+        RTVI_CHECK(contains(table, id, value));
+    }
+}
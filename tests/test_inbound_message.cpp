@@ -0,0 +1,162 @@
+//
+// Copyright (c) 2024, Daily
+//
+
+#include "rtvi_inbound_message.h"
+
+#include "rtvi_exceptions.h"
+
+#include "rtvi_test.h"
+
+#include <string>
+#include <vector>
+
+using namespace rtvi;
+using namespace std::string_literals;
+
+RTVI_TEST(test_top_level_fields) {
+    RTVIInboundMessage message(
+            R"( { "label" : "rtvi-ai", "type" : "bot-ready", "id" : "42", )"
+            R"("data" : { "version" : "0.3.0", "ok" : true } } )"s
+    );
+    RTVI_CHECK_EQ(message.type(), "bot-ready");
+    RTVI_CHECK_EQ(message.id(), "42");
+    RTVI_CHECK_EQ(message.data_string("version").value_or(""), "0.3.0");
+    RTVI_CHECK_EQ(message.data_bool("ok").value_or(false), true);
+    RTVI_CHECK(!message.has_json());
+
+    RTVI_CHECK_EQ(message.data()["version"], "0.3.0");
+    RTVI_CHECK_EQ(message.json()["label"], "rtvi-ai");
+}
+
+RTVI_TEST(test_missing_and_mistyped_fields) {
+    RTVIInboundMessage message(R"({"type":1,"data":{"text":2,"ok":"true"}})"s);
+    RTVI_CHECK_EQ(message.type(), "");
+    RTVI_CHECK_EQ(message.id(), "");
+    RTVI_CHECK(!message.data_string("text").has_value());
+    RTVI_CHECK(!message.data_string("missing").has_value());
+    RTVI_CHECK(!message.data_bool("ok").has_value());
+
+    RTVIInboundMessage no_data(R"({"type":"bot-ready"})"s);
+    RTVI_CHECK(!no_data.data_string("text").has_value());
+    RTVI_CHECK(no_data.data().is_null());
+
+    RTVIInboundMessage empty("{}"s);
+    RTVI_CHECK_EQ(empty.type(), "");
+}
+
+RTVI_TEST(test_escapes) {
+    RTVIInboundMessage message(
+            R"({"type":"bot-llm-text","data":{"text":)"
+            R"("a\"b\\c\/d\b\f\n\r\t \u00e9\u20AC\ud83d\ude00"}})"s
+    );
+    RTVI_CHECK_EQ(
+            message.data_string("text").value_or(""),
+            "a\"b\\c/d\b\f\n\r\t \xc3\xa9\xe2\x82\xac\xf0\x9f\x98\x80"
+    );
+
+    // Escaped keys match their decoded names.
+    RTVIInboundMessage keys(R"({"\u0074ype":"bot-ready","d\u0061ta":{}})"s);
+    RTVI_CHECK_EQ(keys.type(), "bot-ready");
+    RTVI_CHECK(keys.data().is_object());
+
+    // Invalid escapes make the value unavailable rather than wrong.
+    std::vector<std::string> invalid = {
+            R"({"data":{"text":"\q"}})",
+            R"({"data":{"text":"\u00g0"}})",
+            R"({"data":{"text":"\ud83d"}})",
+            R"({"data":{"text":"\ude00"}})",
+            R"({"data":{"text":"\ud83dA"}})",
+    };
+    for (const std::string& frame: invalid) {
+        RTVIInboundMessage invalid_message(frame);
+        RTVI_CHECK(!invalid_message.data_string("text").has_value());
+    }
+}
+
+RTVI_TEST(test_arena) {
+    RTVIArena arena;
+    RTVIInboundMessage message(R"({"type":"a\nb","data":{"text":"\"x\""}})"s);
+    message.set_arena(&arena);
+    RTVI_CHECK_EQ(message.type(), "a\nb");
+    RTVI_CHECK_EQ(message.data_string("text").value_or(""), "\"x\"");
+}
+
+RTVI_TEST(test_nesting) {
+    // Only top-level fields count, and brackets and quotes inside strings
+    // don't end nested values.
+    RTVIInboundMessage message(
+            R"({"data":{"type":"inner","nested":{"id":"no","list":[{"a":[]}]},)"
+            R"("text":"}]\"{[","id":"data-id"},)"
+            R"("extra":[1,{"type":"no"},"]"],"type":"outer","id":"1"})"s
+    );
+    RTVI_CHECK_EQ(message.type(), "outer");
+    RTVI_CHECK_EQ(message.id(), "1");
+    RTVI_CHECK_EQ(message.data_string("type").value_or(""), "inner");
+    RTVI_CHECK_EQ(message.data_string("id").value_or(""), "data-id");
+    RTVI_CHECK_EQ(message.data_string("text").value_or(""), "}]\"{[");
+    RTVI_CHECK(!message.data_string("nested").has_value());
+    RTVI_CHECK(!message.data_string("a").has_value());
+}
+
+RTVI_TEST(test_numbers_and_literals) {
+    RTVIInboundMessage message(
+            R"({"n":-1.5e+10,"m":2E-3,"z":null,"t":true,"f":false,)"
+            R"("type":"t","data":{"x":0,"b":false,"s":"s"}})"s
+    );
+    RTVI_CHECK_EQ(message.type(), "t");
+    RTVI_CHECK_EQ(message.data_bool("b").value_or(true), false);
+    RTVI_CHECK_EQ(message.data_string("s").value_or(""), "s");
+}
+
+RTVI_TEST(test_malformed_frames) {
+    std::vector<std::string> frames = {
+            "",
+            "   ",
+            "[]",
+            "\"type\"",
+            "{",
+            R"({"type")",
+            R"({"type":)",
+            R"({"type":"bot-ready")",
+            R"({"type":"bot-ready",})",
+            R"({"type" "bot-ready"})",
+            R"({"type":"bot-ready" "id":"1"})",
+            R"({type:"bot-ready"})",
+            R"({"type":"unterminated})",
+            R"({"type":"trailing backslash\"})",
+            "{\"type\":\"control\x01\"}",
+            R"({"data":{"text":"x"})",
+            R"({"data":[1,2})",
+            R"({"data":})",
+    };
+    for (const std::string& frame: frames) {
+        RTVI_CHECK_THROWS(RTVIInboundMessage(frame), RTVIException);
+    }
+
+    // Nested values are only validated when they are parsed.
+    RTVIInboundMessage message(R"({"type":"t","data":{"text":"x","n":01}})"s);
+    RTVI_CHECK_EQ(message.type(), "t");
+    RTVI_CHECK_EQ(message.data_string("text").value_or(""), "x");
+    RTVI_CHECK_THROWS(message.data(), nlohmann::json::parse_error);
+}
+
+RTVI_TEST(test_json_messages) {
+    nlohmann::json json = {
+            {"type", "bot-ready"},
+            {"id", "1"},
+            {"data", {{"text", "hi"}, {"ok", true}}},
+    };
+
+    RTVIInboundMessage message(json);
+    RTVI_CHECK(message.has_json());
+    RTVI_CHECK_EQ(message.type(), "bot-ready");
+    RTVI_CHECK_EQ(message.data_string("text").value_or(""), "hi");
+    RTVI_CHECK_EQ(message.data_bool("ok").value_or(false), true);
+
+    RTVIInboundMessage borrowed = RTVIInboundMessage::borrow(json);
+    RTVI_CHECK_EQ(borrowed.id(), "1");
+    borrowed.detach();
+    json["id"] = "2";
+    RTVI_CHECK_EQ(borrowed.id(), "1");
+}
@@ -0,0 +1,160 @@
+//
+// Copyright (c) 2024, Daily
+//
+
+#include "rtvi_mpmc_queue.h"
+
+#include "rtvi_test.h"
+
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <vector>
+
+using namespace rtvi;
+
+RTVI_TEST(test_capacity_is_rounded_up) {
+    RTVIMpmcQueue<int> queue(5);
+    RTVI_CHECK_EQ(queue.capacity(), 8u);
+
+    for (int i = 0; i < 8; ++i) {
+        RTVI_CHECK(queue.try_push(i));
+    }
+    RTVI_CHECK(!queue.try_push(8));
+    RTVI_CHECK_EQ(queue.size(), 8u);
+}
+
+RTVI_TEST(test_wraparound) {
+    RTVIMpmcQueue<int> queue(4);
+
+    // Keep the queue almost full while the positions go around it many
+    // times, so every slot is reused with a different sequence.
+    int next_push = 0;
+    int next_pop = 0;
+    for (int i = 0; i < 3; ++i) {
+        RTVI_CHECK(queue.try_push(next_push++));
+    }
+    for (int i = 0; i < 1000; ++i) {
+        RTVI_CHECK(queue.try_push(next_push++));
+        RTVI_CHECK(!queue.try_push(-1));
+
+        std::optional<int> value = queue.try_pop();
+        RTVI_CHECK(value.has_value());
+        RTVI_CHECK_EQ(value.value_or(-1), next_pop++);
+    }
+    RTVI_CHECK_EQ(queue.size(), 3u);
+
+    while (auto value = queue.try_pop()) {
+        RTVI_CHECK_EQ(*value, next_pop++);
+    }
+    RTVI_CHECK_EQ(next_pop, next_push);
+    RTVI_CHECK(!queue.try_pop().has_value());
+}
+
+RTVI_TEST(test_batch_claims_across_the_end) {
+    RTVIMpmcQueue<int> queue(8);
+
+    // Move the positions close to the end of the slots.
+    for (int i = 0; i < 6; ++i) {
+        RTVI_CHECK(queue.try_push(-1));
+        RTVI_CHECK(queue.try_pop().has_value());
+    }
+
+    // Only 8 of the 10 values fit, wrapping after the first two.
+    std::vector<int> values = {0, 1, 2, 3, 4, 5, 6, 7, 8, 9};
+    RTVI_CHECK_EQ(queue.try_push_batch(values.data(), values.size()), 8u);
+    RTVI_CHECK_EQ(queue.try_push_batch(values.data() + 8, 2), 0u);
+
+    int popped[16];
+    RTVI_CHECK_EQ(queue.try_pop_batch(popped, 3), 3u);
+    for (int i = 0; i < 3; ++i) {
+        RTVI_CHECK_EQ(popped[i], i);
+    }
+
+    // Claims as many slots as are free.
+    RTVI_CHECK_EQ(queue.try_push_batch(values.data() + 8, 2), 2u);
+    RTVI_CHECK_EQ(queue.try_pop_batch(popped, 16), 7u);
+    for (int i = 0; i < 7; ++i) {
+        RTVI_CHECK_EQ(popped[i], i + 3);
+    }
+    RTVI_CHECK_EQ(queue.try_pop_batch(popped, 16), 0u);
+}
+
+RTVI_TEST(test_values_are_destroyed) {
+    auto counter = std::make_shared<int>(0);
+    {
+        RTVIMpmcQueue<std::shared_ptr<int>> queue(4);
+        for (int i = 0; i < 4; ++i) {
+            RTVI_CHECK(queue.try_push(counter));
+        }
+        RTVI_CHECK(queue.try_pop().has_value());
+        RTVI_CHECK_EQ(counter.use_count(), 4);
+    }
+    // The queue destroys the values it still holds.
+    RTVI_CHECK_EQ(counter.use_count(), 1);
+}
+
+RTVI_TEST(test_stop_wakes_up_consumers) {
+    RTVIMpmcQueue<int> queue(4);
+
+    std::thread consumer([&queue] {
+        RTVI_CHECK(!queue.pop().has_value());
+    });
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    queue.stop();
+    consumer.join();
+
+    // Values can still be popped after stopping.
+    RTVI_CHECK(queue.try_push(1));
+    RTVI_CHECK_EQ(queue.pop().value_or(-1), 1);
+}
+
+static constexpr int NUM_THREADS = 4;
+static constexpr int NUM_VALUES = 20000;
+static constexpr int BATCH_SIZE = 7;
+
+RTVI_TEST(test_concurrent_batches) {
+    RTVIMpmcQueue<int> queue(64);
+    std::vector<std::atomic<int>> seen(NUM_THREADS * NUM_VALUES);
+    std::atomic<int> num_popped(0);
+
+    std::vector<std::thread> threads;
+    for (int t = 0; t < NUM_THREADS; ++t) {
+        threads.emplace_back([&queue, t] {
+            int batch[BATCH_SIZE];
+            int next = 0;
+            while (next < NUM_VALUES) {
+                int count = std::min(BATCH_SIZE, NUM_VALUES - next);
+                for (int i = 0; i < count; ++i) {
+                    batch[i] = t * NUM_VALUES + next + i;
+                }
+                next += queue.try_push_batch(batch, count);
+            }
+        });
+        threads.emplace_back([&] {
+            int batch[BATCH_SIZE];
+            while (true) {
+                size_t count = queue.pop_batch(batch, BATCH_SIZE);
+                if (count == 0) {
+                    return;
+                }
+                for (size_t i = 0; i < count; ++i) {
+                    seen[batch[i]].fetch_add(1);
+                }
+                if (num_popped.fetch_add(count) + count ==
+                    NUM_THREADS * NUM_VALUES) {
+                    queue.stop();
+                }
+            }
+        });
+    }
+    for (auto& thread: threads) {
+        thread.join();
+    }
+
+    RTVI_CHECK_EQ(num_popped.load(), NUM_THREADS * NUM_VALUES);
+    for (auto& count: seen) {
+        RTVI_CHECK_EQ(count.load(), 1);
+    }
+}
@@ -0,0 +1,129 @@
+//
+// Copyright (c) 2024, Daily
+//
+
+#include "rtvi_ring_buffer.h"
+
+#include "rtvi_test.h"
+
+#include <algorithm>
+#include <thread>
+#include <vector>
+
+using namespace rtvi;
+
+RTVI_TEST(test_capacity_is_rounded_up) {
+    RTVIRingBuffer<int> buffer(100);
+    RTVI_CHECK_EQ(buffer.capacity(), 128u);
+    RTVI_CHECK_EQ(buffer.size(), 0u);
+    RTVI_CHECK_EQ(buffer.free_space(), 128u);
+}
+
+RTVI_TEST(test_partial_writes_and_reads) {
+    RTVIRingBuffer<int> buffer(8);
+    std::vector<int> values = {0, 1, 2, 3, 4, 5, 6, 7, 8, 9};
+
+    // Only what fits is written.
+    RTVI_CHECK_EQ(buffer.write(values.data(), values.size()), 8u);
+    RTVI_CHECK_EQ(buffer.write(values.data(), 1), 0u);
+    RTVI_CHECK_EQ(buffer.free_space(), 0u);
+
+    // Only what's available is read.
+    int read[16];
+    RTVI_CHECK_EQ(buffer.read(read, 16), 8u);
+    for (int i = 0; i < 8; ++i) {
+        RTVI_CHECK_EQ(read[i], i);
+    }
+    RTVI_CHECK_EQ(buffer.read(read, 16), 0u);
+}
+
+RTVI_TEST(test_wraparound) {
+    RTVIRingBuffer<int> buffer(8);
+
+    // Writes and reads of a size that doesn't divide the capacity, so they
+    // are split at the end of the buffer at every possible offset.
+    int next_write = 0;
+    int next_read = 0;
+    for (int i = 0; i < 1000; ++i) {
+        int values[5];
+        for (int j = 0; j < 5; ++j) {
+            values[j] = next_write + j;
+        }
+        RTVI_CHECK_EQ(buffer.write(values, 5), 5u);
+        next_write += 5;
+
+        int read[5];
+        RTVI_CHECK_EQ(buffer.read(read, 5), 5u);
+        for (int j = 0; j < 5; ++j) {
+            RTVI_CHECK_EQ(read[j], next_read++);
+        }
+    }
+    RTVI_CHECK_EQ(buffer.size(), 0u);
+}
+
+RTVI_TEST(test_peek_and_discard) {
+    RTVIRingBuffer<int> buffer(8);
+
+    // Move the indices close to the end first.
+    int values[] = {0, 1, 2, 3, 4, 5};
+    int read[8];
+    RTVI_CHECK_EQ(buffer.write(values, 6), 6u);
+    RTVI_CHECK_EQ(buffer.discard(6), 6u);
+
+    RTVI_CHECK_EQ(buffer.write(values, 6), 6u);
+    RTVI_CHECK_EQ(buffer.peek(read, 4), 4u);
+    RTVI_CHECK_EQ(read[3], 3);
+    RTVI_CHECK_EQ(buffer.size(), 6u);
+
+    RTVI_CHECK_EQ(buffer.discard(3), 3u);
+    RTVI_CHECK_EQ(buffer.read(read, 1), 1u);
+    RTVI_CHECK_EQ(read[0], 3);
+
+    // Discarding more than what's available only drops what's there.
+    RTVI_CHECK_EQ(buffer.discard(10), 2u);
+    RTVI_CHECK_EQ(buffer.size(), 0u);
+
+    RTVI_CHECK_EQ(buffer.write(values, 6), 6u);
+    buffer.clear();
+    RTVI_CHECK_EQ(buffer.size(), 0u);
+    RTVI_CHECK_EQ(buffer.free_space(), 8u);
+}
+
+RTVI_TEST(test_producer_and_consumer_threads) {
+    constexpr size_t NUM_VALUES = 200000;
+    RTVIRingBuffer<uint32_t> buffer(64);
+
+    std::thread producer([&buffer] {
+        uint32_t values[13];
+        uint32_t next = 0;
+        while (next < NUM_VALUES) {
+            for (uint32_t i = 0; i < 13; ++i) {
+                values[i] = next + i;
+            }
+            size_t count = std::min<size_t>(13, NUM_VALUES - next);
+            size_t written = buffer.write(values, count);
+            if (written == 0) {
+                std::this_thread::yield();
+            }
+            next += written;
+        }
+    });
+
+    uint32_t values[17];
+    uint32_t next = 0;
+    bool in_order = true;
+    while (next < NUM_VALUES) {
+        size_t count = buffer.read(values, 17);
+        if (count == 0) {
+            std::this_thread::yield();
+        }
+        for (size_t i = 0; i < count; ++i) {
+            in_order = in_order && values[i] == next;
+            next++;
+        }
+    }
+    producer.join();
+
+    RTVI_CHECK(in_order);
+    RTVI_CHECK_EQ(buffer.size(), 0u);
+}
@@ -0,0 +1,168 @@
+//
+// Copyright (c) 2024, Daily
+//
+
+#include "rtvi_session_recorder.h"
+
+#include "rtvi_test.h"
+
+#include <cstdio>
+#include <string>
+#include <sys/stat.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+using namespace rtvi;
+
+namespace {
+
+std::string log_path(const char* name) {
+    return "/tmp/pipecat_" + std::string(name) + "_" +
+           std::to_string(::getpid()) + ".log";
+}
+
+size_t file_size(const std::string& path) {
+    struct stat st;
+    return ::stat(path.c_str(), &st) == 0 ? st.st_size : 0;
+}
+
+}  // namespace
+
+RTVI_TEST(test_messages_and_audio) {
+    std::string path = log_path("messages");
+    RTVIAudioFormat format = {.sample_rate = 16000, .num_channels = 1};
+    {
+        RTVISessionRecorderOptions options;
+        options.path = path;
+        RTVISessionRecorder recorder(options, format);
+
+        nlohmann::json message = {{"type", "bot-ready"}, {"id", "1"}};
+        recorder.record_message(
+                RTVISessionRecordType::OutboundMessage, message
+        );
+
+        std::vector<uint8_t> encoded = {0x81, 0xa1, 0x61, 0x01};
+        recorder.record_message(
+                RTVISessionRecordType::InboundMessage,
+                RTVIWireFormat::MessagePack,
+                encoded.data(),
+                encoded.size()
+        );
+
+        int16_t samples[160] = {1, 2, 3};
+        recorder.record_audio(RTVISessionRecordType::UserAudio, samples, 160);
+        RTVI_CHECK_EQ(recorder.records(), 3u);
+    }
+
+    RTVISessionLog log(path);
+    RTVI_CHECK_EQ(log.audio_format().sample_rate, 16000u);
+
+    RTVISessionRecord record;
+    RTVI_CHECK(log.next(record));
+    RTVI_CHECK(record.type == RTVISessionRecordType::OutboundMessage);
+    RTVI_CHECK(record.format == RTVIWireFormat::Json);
+    RTVI_CHECK_EQ(
+            nlohmann::json::parse(record.data, record.data + record.size),
+            nlohmann::json({{"type", "bot-ready"}, {"id", "1"}})
+    );
+
+    RTVI_CHECK(log.next(record));
+    RTVI_CHECK(record.format == RTVIWireFormat::MessagePack);
+    RTVI_CHECK_EQ(record.size, 4u);
+
+    RTVI_CHECK(log.next(record));
+    RTVI_CHECK(record.type == RTVISessionRecordType::UserAudio);
+    RTVI_CHECK_EQ(record.num_samples(), 160u);
+    RTVI_CHECK_EQ(record.samples()[2], 3);
+    RTVI_CHECK(record.time.count() >= 0);
+
+    RTVI_CHECK(!log.next(record));
+    std::remove(path.c_str());
+}
+
+RTVI_TEST(test_records_that_dont_fit) {
+    std::string path = log_path("full");
+    {
+        RTVISessionRecorderOptions options;
+        options.path = path;
+        options.max_size = 64 + 128;
+        RTVISessionRecorder recorder(options, RTVIAudioFormat());
+
+        std::vector<uint8_t> data(200, 'x');
+        auto record = [&](size_t size) {
+            recorder.record_message(
+                    RTVISessionRecordType::InboundMessage,
+                    RTVIWireFormat::Json,
+                    data.data(),
+                    size
+            );
+        };
+
+        // A record that doesn't fit doesn't use up the space left, so
+        // smaller records are still recorded after it.
+        record(40);
+        record(200);
+        record(40);
+        record(40);
+        RTVI_CHECK_EQ(recorder.records(), 2u);
+        RTVI_CHECK_EQ(recorder.dropped(), 2u);
+    }
+
+    // The log is truncated to the records written.
+    RTVI_CHECK_EQ(file_size(path), 64u + 2 * 56);
+
+    RTVISessionLog log(path);
+    RTVISessionRecord record;
+    RTVI_CHECK(log.next(record));
+    RTVI_CHECK(log.next(record));
+    RTVI_CHECK_EQ(record.size, 40u);
+    RTVI_CHECK(!log.next(record));
+    std::remove(path.c_str());
+}
+
+RTVI_TEST(test_concurrent_records) {
+    std::string path = log_path("concurrent");
+    constexpr int NUM_THREADS = 4;
+    constexpr int NUM_RECORDS = 1000;
+    {
+        RTVISessionRecorderOptions options;
+        options.path = path;
+        // Room for exactly half of the records.
+        options.max_size = 64 + NUM_THREADS * NUM_RECORDS * 32 / 2;
+        RTVISessionRecorder recorder(options, RTVIAudioFormat());
+
+        // Every other record is too large to ever fit.
+        std::vector<uint8_t> data(options.max_size);
+
+        std::vector<std::thread> threads;
+        for (int t = 0; t < NUM_THREADS; ++t) {
+            threads.emplace_back([&recorder, &data] {
+                for (int i = 0; i < NUM_RECORDS; ++i) {
+                    recorder.record_message(
+                            RTVISessionRecordType::InboundMessage,
+                            RTVIWireFormat::Json,
+                            data.data(),
+                            i % 2 == 0 ? 16 : data.size()
+                    );
+                }
+            });
+        }
+        for (auto& thread: threads) {
+            thread.join();
+        }
+
+        RTVI_CHECK_EQ(recorder.records(), NUM_THREADS * NUM_RECORDS / 2u);
+        RTVI_CHECK_EQ(recorder.dropped(), NUM_THREADS * NUM_RECORDS / 2u);
+    }
+
+    RTVISessionLog log(path);
+    RTVISessionRecord record;
+    size_t count = 0;
+    while (log.next(record)) {
+        RTVI_CHECK_EQ(record.size, 16u);
+        count++;
+    }
+    RTVI_CHECK_EQ(count, NUM_THREADS * NUM_RECORDS / 2u);
+    std::remove(path.c_str());
+}
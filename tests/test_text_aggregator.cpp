@@ -0,0 +1,175 @@
+//
+// Copyright (c) 2024, Daily
+//
+
+#include "rtvi_text_aggregator.h"
+
+#include "rtvi_test.h"
+
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace rtvi;
+
+namespace {
+
+struct Chunk {
+    std::string text;
+    std::string turn;
+    bool final;
+};
+
+struct Recorder {
+    std::mutex mutex;
+    std::vector<Chunk> chunks;
+
+    RTVITextAggregator::Callback callback() {
+        return [this](const BotAggregatedTextData& data) {
+            std::lock_guard<std::mutex> lock(mutex);
+            chunks.push_back(Chunk {
+                    std::string(data.text),
+                    std::string(data.turn),
+                    data.final
+            });
+        };
+    }
+
+    size_t size() {
+        std::lock_guard<std::mutex> lock(mutex);
+        return chunks.size();
+    }
+};
+
+}  // namespace
+
+RTVI_TEST(test_sentences) {
+    Recorder recorder;
+    RTVITextAggregator aggregator(
+            RTVITextAggregatorOptions(), recorder.callback()
+    );
+
+    aggregator.start();
+    for (const char* token: {"Hello", " there.", " How", " are", " you?"}) {
+        aggregator.append(token);
+    }
+    RTVI_CHECK_EQ(recorder.chunks.size(), 1u);
+    aggregator.append(" Fine.\n");
+    aggregator.stop();
+
+    RTVI_CHECK_EQ(recorder.chunks.size(), 3u);
+    RTVI_CHECK_EQ(recorder.chunks[0].text, "Hello there.");
+    RTVI_CHECK_EQ(recorder.chunks[1].text, " How are you? Fine.\n");
+    RTVI_CHECK_EQ(recorder.chunks[1].turn, "Hello there. How are you? Fine.\n");
+    RTVI_CHECK(!recorder.chunks[1].final);
+    RTVI_CHECK_EQ(recorder.chunks[2].text, "");
+    RTVI_CHECK(recorder.chunks[2].final);
+
+    // A new turn starts with an empty delivery buffer.
+    aggregator.start();
+    aggregator.append("Next. ");
+    RTVI_CHECK_EQ(recorder.chunks.back().turn, "Next.");
+}
+
+RTVI_TEST(test_every_token) {
+    Recorder recorder;
+    RTVITextAggregatorOptions options;
+    options.sentences = false;
+    RTVITextAggregator aggregator(options, recorder.callback());
+
+    aggregator.append("a");
+    aggregator.append("b");
+    aggregator.stop();
+    RTVI_CHECK_EQ(recorder.chunks.size(), 3u);
+    RTVI_CHECK_EQ(recorder.chunks[1].text, "b");
+    RTVI_CHECK_EQ(recorder.chunks[1].turn, "ab");
+}
+
+RTVI_TEST(test_window_checked_on_append) {
+    Recorder recorder;
+    RTVITextAggregatorOptions options;
+    options.window = std::chrono::milliseconds(100);
+    RTVITextAggregator aggregator(options, recorder.callback());
+
+    auto now = std::chrono::steady_clock::now();
+    aggregator.append("no sentence end", now);
+    aggregator.append(" yet", now + std::chrono::milliseconds(50));
+    RTVI_CHECK_EQ(recorder.chunks.size(), 0u);
+    aggregator.append(" now", now + std::chrono::milliseconds(100));
+    RTVI_CHECK_EQ(recorder.chunks.size(), 1u);
+    RTVI_CHECK_EQ(recorder.chunks[0].text, "no sentence end yet now");
+}
+
+RTVI_TEST(test_window_flushed_by_timer) {
+    RTVITimer timer(std::chrono::milliseconds(1));
+    RTVITextAggregatorTimer aggregator_timer;
+    aggregator_timer.schedule = [&timer](auto delay, auto task) {
+        return timer.schedule(delay, std::move(task));
+    };
+    aggregator_timer.cancel = [&timer](RTVITimerId id) { timer.cancel(id); };
+
+    Recorder recorder;
+    RTVITextAggregatorOptions options;
+    options.window = std::chrono::milliseconds(20);
+    RTVITextAggregator aggregator(
+            options, recorder.callback(), aggregator_timer
+    );
+
+    // No more text arrives, but the text still doesn't wait much longer
+    // than the window.
+    auto start = std::chrono::steady_clock::now();
+    aggregator.append("waiting for more");
+    while (recorder.size() == 0 &&
+           std::chrono::steady_clock::now() - start <
+                   std::chrono::seconds(1)) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    auto elapsed = std::chrono::steady_clock::now() - start;
+
+    RTVI_CHECK_EQ(recorder.size(), 1u);
+    RTVI_CHECK(elapsed >= std::chrono::milliseconds(20));
+    RTVI_CHECK(elapsed < std::chrono::milliseconds(500));
+    RTVI_CHECK_EQ(recorder.chunks[0].text, "waiting for more");
+
+    // Stopping cancels the flush.
+    aggregator.append("stopped");
+    aggregator.stop();
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    RTVI_CHECK_EQ(recorder.size(), 2u);
+    RTVI_CHECK(recorder.chunks[1].final);
+
+    aggregator.discard();
+}
+
+RTVI_TEST(test_callback_can_use_the_aggregator) {
+    std::vector<Chunk> chunks;
+    RTVITextAggregator* aggregator_ptr = nullptr;
+
+    RTVITextAggregator aggregator(
+            RTVITextAggregatorOptions(),
+            [&](const BotAggregatedTextData& data) {
+                chunks.push_back(Chunk {
+                        std::string(data.text),
+                        std::string(data.turn),
+                        data.final
+                });
+                // Delivered when this callback returns.
+                if (chunks.size() == 1) {
+                    aggregator_ptr->append("More. Rest");
+                } else if (chunks.size() == 2) {
+                    aggregator_ptr->stop();
+                }
+            }
+    );
+    aggregator_ptr = &aggregator;
+
+    aggregator.append("First. ");
+    RTVI_CHECK_EQ(chunks.size(), 3u);
+    RTVI_CHECK_EQ(chunks[0].text, "First.");
+    RTVI_CHECK_EQ(chunks[1].text, " More.");
+    RTVI_CHECK_EQ(chunks[1].turn, "First. More.");
+    RTVI_CHECK(!chunks[1].final);
+    RTVI_CHECK_EQ(chunks[2].text, " Rest");
+    RTVI_CHECK_EQ(chunks[2].turn, "First. More. Rest");
+    RTVI_CHECK(chunks[2].final);
+}